@@ -27,6 +27,8 @@
  * If no command is arrived in an interval of 0,5s the accounting is done
  * for all users who need a update. The interval is 0,5s because every second
  * a user can connect with an unknown interval, so this interval must be shorter.
+ * The start packet of a new user is submitted to the radius client, the loop
+ * reads the next command at once and finishes the user when the start is answered.
  * @param context The plugin context as object from the class PluginContext.
  */
 
@@ -34,17 +36,46 @@ void AccountingProcess::Accounting(PluginContext * context)
 {
   UserAcct              *user = NULL; // The user for acconting.
   int                   command,      // The command from foreground process.
+                        requestid,    // The request id of the command.
                         result;       // The result from the socket.
   string                    key;        //The unique key.
+  IpcMessage                msg;        //The command from the foreground process.
   AcctScheduler             scheduler;  //The scheduler for the accounting.
   fd_set                set;        //A set for the select function.
   struct timeval            tv;         //A timeinterval for the
                                         //select function.
+  AcctStartCallback     *start;       // The start of a new user.
+  map<string, AcctStartCallback *>::iterator startiter;
   StdLogger log("RADIUS-PLUGIN [PLUGIN-ACCT-LOOP]", context->getVerbosity());
   log.debug() << "  Starting...\n";
 
+  this->context=context;
+  this->startedpipe[0]=-1;
+  this->startedpipe[1]=-1;
+  pthread_mutex_init(&this->mutexstarted, NULL);
+
   //Tell the parent everythink is ok.
   try {
+    //the answered start tickets wake up the event loop
+    if (pipe(this->startedpipe)!=0)
+    {
+      log() << " pipe for the start tickets could not be created: " << strerror(errno) << "\n";
+      this->startedpipe[0]=-1;
+      this->startedpipe[1]=-1;
+      context->acctsocketforegr.send(RESPONSE_INIT_FAILED);
+      goto done;
+    }
+    fcntl(this->startedpipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(this->startedpipe[1], F_SETFL, O_NONBLOCK);
+
+    //start the radius client, it keeps the sockets to the radius servers
+    if (context->radiusclient.start(context->radiusconf.getRadiusServer(true), RADIUS_CLIENT_ACCT,
+                                       context->radiusconf.getBalance(true), context->radiusconf.getMaxOutstanding(true))!=0)
+    {
+      log() << " radius client could not be started.\n";
+      context->acctsocketforegr.send(RESPONSE_INIT_FAILED);
+      goto done;
+    }
     context->acctsocketforegr.send(RESPONSE_INIT_SUCCEEDED);
     log() << " Started, RESPONSE_INIT_SUCCEEDED was sent to Foreground Process.\n";
   }
@@ -74,45 +105,75 @@ void AccountingProcess::Accounting(PluginContext * context)
     tv.tv_sec = 0;
     tv.tv_usec = 500000;    //wait 0,5s
     FD_ZERO(&set);          // clear out the set
-    FD_SET(context->acctsocketforegr.getSocket(), &set); // wait only on the socket from the foreground process
+    FD_SET(context->acctsocketforegr.getReadFd(), &set); // wait on the socket from the foreground process
+    FD_SET(this->startedpipe[0], &set);                    // and on the answered start tickets
     result = select(FD_SETSIZE, &set, NULL, NULL, &tv);
 
+    //finish the users whose start ticket is answered
+    if (result>0 && FD_ISSET(this->startedpipe[0], &set))
+    {
+      char buf[64];
+      while (read(this->startedpipe[0], buf, sizeof(buf)) > 0);
+      try
+      {
+        while (this->takeStarted(&start))
+        {
+          this->finishStart(start, scheduler);
+        }
+      }
+      catch (Exception &e)
+      {
+        log() << "failed to send the response of a start ticket: " << e << "!\n";
+        //close the background process, if the ipc socket is bad
+        if (e.getErrnum()==Exception::SOCKETSEND || e.getErrnum()==Exception::SOCKETRECV)
+        {
+          log() << "Error in socket!\n";
+          goto done;
+        }
+      }
+    }
+
     //if there is a data on the socket
-    if (result>0)
+    if (result>0 && FD_ISSET(context->acctsocketforegr.getReadFd(), &set))
     {
       // get a command from foreground process
-      command = context->acctsocketforegr.recvInt();
+      context->acctsocketforegr.recv(msg);
+      command = msg.getInt();
       log.debug() << " Got command: '" << command << "'\n";
 
       switch (command)
       {
         //add a new user to the scheduler
       case ADD_USER:
+        requestid=0;
+        start=NULL;
         try
         {
           log.debug() << " New User.\n";
+          //get the request id, the response carries it
+          requestid=msg.getInt();
 
           // if accounting errors are non fatal return success and proceed with accounting
           if(context->conf.getNonFatalAccounting()==true) {
             log() << "send nonfatal success response\n";
-            context->acctsocketforegr.send(RESPONSE_SUCCEEDED);
+            this->sendResponse(context, requestid, RESPONSE_SUCCEEDED);
           }
-          UserAcct new_user;
-          user = &new_user;
+          start = new AcctStartCallback(this, requestid);
+          user = &start->user;
           //get the information from the foreground process
           try {
-            user->setUsername(context->acctsocketforegr.recvStr());
-            user->setSessionId(context->acctsocketforegr.recvStr()) ;
-            user->setPortnumber(context->acctsocketforegr.recvInt());
-            user->setCallingStationId(context->acctsocketforegr.recvStr());
-            user->setFramedIp(context->acctsocketforegr.recvStr());
-            user->setCommonname(context->acctsocketforegr.recvStr());
-            user->setAcctInterimInterval(context->acctsocketforegr.recvInt());
-            user->setFramedRoutes(context->acctsocketforegr.recvStr());
-            user->setKey(context->acctsocketforegr.recvStr());
-            user->setStatusFileKey(context->acctsocketforegr.recvStr());
-            user->setUntrustedPort(context->acctsocketforegr.recvStr());
-            context->acctsocketforegr.recvBuf(user);
+            user->setUsername(msg.getStr());
+            user->setSessionId(msg.getStr()) ;
+            user->setPortnumber(msg.getInt());
+            user->setCallingStationId(msg.getStr());
+            user->setFramedIp(msg.getStr());
+            user->setCommonname(msg.getStr());
+            user->setAcctInterimInterval(msg.getInt());
+            user->setFramedRoutes(msg.getStr());
+            user->setKey(msg.getStr());
+            user->setStatusFileKey(msg.getStr());
+            user->setUntrustedPort(msg.getStr());
+            msg.getBuf(user);
             log.debug() << "New user acct: username: "
                         << user->getUsername() << ", interval: " << user->getAcctInterimInterval()
                         << ", calling station: " << user->getCallingStationId() << ", commonname: "
@@ -134,51 +195,19 @@ void AccountingProcess::Accounting(PluginContext * context)
             log() << "got acct interim interval = " << user->getAcctInterimInterval() << "\n";
           }
 
-          //send the start packet
-          if (user->sendStartPacket(context)==0)
-          {
-            log.debug() << " Start packet sent.\n";
-            log.debug() << "RADIUS-PLUGIN: BACKGROUND ACCT: User was added to accounting scheduler.\n";
-
-            //set the system routes
-            user->addSystemRoutes(context);
-
-
-            string script = context->conf.getVsaScript();
-            //execute vendor specific attribute script
-            if (script.length() > 0)
-            {
-              log.debug() << " Call vendor specific attribute script: '" << script << "'.\n";
-              if (callVsaScript(context, user, 1, 0) != 0) {
-                log() << " Vendor specific script failed to execute (fatal)!" << "\n";
-                throw Exception("Vendor specific attribute script failed.\n");
-              }
-            }
-
-            //add the user to the scheduler
-            scheduler.addUser(*user);
-            //send the ok to the parent process
-            if(context->conf.getNonFatalAccounting()==false) {
-              log() << "send non nonfatal success response\n";
-              context->acctsocketforegr.send(RESPONSE_SUCCEEDED);
-            }
-          }
-          else
-          {
-            //delete the ccd file which was created at authentication
-            //user->deleteCcdFile(context);
-            //tell the parent parent process something is wrong
-            log() << " Failed to send start ticket (fatal)!" << "\n";
-            throw Exception("Accounting failed.\n");
-          }
-          // free the user, he was copied to the accounting scheduler list
+          //submit the start packet, the user is finished by finishStart() when it is answered
+          this->starting[user->getKey()]=start;
+          user->submitStartPacket(context, &start->packet, start);
+          start=NULL;
+          log.debug() << " Start packet submitted.\n";
         }
         catch (Exception &e)
         {
           log() << "failed while do add user command: " << e << "!\n";
+          delete start;
           if(context->conf.getNonFatalAccounting()==false) {
             log() << " send non nonfatal fail response\n";
-            context->acctsocketforegr.send(RESPONSE_FAILED);
+            this->sendResponse(context, requestid, RESPONSE_FAILED);
           }
           //close the background process, if the ipc socket is bad
           if (e.getErrnum()==Exception::SOCKETSEND || e.getErrnum()==Exception::SOCKETRECV)
@@ -189,15 +218,17 @@ void AccountingProcess::Accounting(PluginContext * context)
         }
         catch (std::exception &e) {
           log() << "failed while do add user command: " << e.what() << "!\n";
+          delete start;
           if(context->conf.getNonFatalAccounting()==false) {
             log() << "send non nonfatal fail response\n";
-            context->acctsocketforegr.send(RESPONSE_FAILED);
+            this->sendResponse(context, requestid, RESPONSE_FAILED);
           }
         }
         catch (...) {
+          delete start;
           if(context->conf.getNonFatalAccounting()==false) {
             log() << "send non nonfatal fail response\n";
-            context->acctsocketforegr.send(RESPONSE_FAILED);
+            this->sendResponse(context, requestid, RESPONSE_FAILED);
           }
           log() << "Unknown Exception!\n";
         }
@@ -207,15 +238,24 @@ void AccountingProcess::Accounting(PluginContext * context)
       case DEL_USER:
         log.debug() << "Deleting user from accounting...\n";
 
+        //get the request id, the response carries it
+        try {
+          requestid=msg.getInt();
+        }
+        catch (Exception &e) {
+          log() << " fail while read request id from socket: "<< e << "!\n";
+          goto done;
+        }
+
         // if accounting errors are non fatal return success
         if(context->conf.getNonFatalAccounting()==true) {
           log() << " send nonfatal success response\n";
-          context->acctsocketforegr.send(RESPONSE_SUCCEEDED);
+          this->sendResponse(context, requestid, RESPONSE_SUCCEEDED);
         }
 
         //receive the information
         try {
-          key=context->acctsocketforegr.recvStr();
+          key=msg.getStr();
         }
         catch (Exception &e) {
           log() << " fail while read user key from socket: "<< e << "!\n";
@@ -270,7 +310,7 @@ void AccountingProcess::Accounting(PluginContext * context)
             //send the parent process the ok
             if(context->conf.getNonFatalAccounting()==false) {
               log() << "send non nonfatal success response\n";
-              context->acctsocketforegr.send(RESPONSE_SUCCEEDED);
+              this->sendResponse(context, requestid, RESPONSE_SUCCEEDED);
             }
           }
           catch (Exception &e) {
@@ -284,11 +324,21 @@ void AccountingProcess::Accounting(PluginContext * context)
             log() << " Unknown Exception while do dele user cmd!\n";
           }
         }
+        else if ((startiter=this->starting.find(key)) != this->starting.end())
+        {
+          //the start is not answered so far, the user is stopped when it is
+          log() << " Start ticket of the user with key " << key << " is not answered so far, the user is stopped later.\n";
+          startiter->second->cancelled=true;
+          if(context->conf.getNonFatalAccounting()==false) {
+            log() << "send non nonfatal success response\n";
+            this->sendResponse(context, requestid, RESPONSE_SUCCEEDED);
+          }
+        }
         else {
           log() << "No user with this key "<< key <<".\n";
           if(context->conf.getNonFatalAccounting()==false) {
             log() << "send non nonfatal fail response\n";
-            context->acctsocketforegr.send(RESPONSE_FAILED);
+            this->sendResponse(context, requestid, RESPONSE_FAILED);
           }
         }
         break;
@@ -326,12 +376,147 @@ void AccountingProcess::Accounting(PluginContext * context)
 done:
   //end the process
   log() << "doing end acct loop!\n";
+  //wait for the start tickets which are not answered so far, the users are stopped
+  context->radiusclient.flush();
+  for (startiter=this->starting.begin(); startiter != this->starting.end(); startiter++)
+  {
+    startiter->second->cancelled=true;
+  }
+  while (this->takeStarted(&start))
+  {
+    try {
+      this->finishStart(start, scheduler);
+    }
+    catch (Exception &e) {
+      log() << "failed to send the response of a start ticket: " << e << "!\n";
+    }
+  }
   if (1)
     scheduler.delallUsers(context);
+  //wait for the stop tickets which are not answered so far
+  context->radiusclient.flush();
+  context->radiusclient.stop();
+  if (this->startedpipe[0] >= 0)
+  {
+    close(this->startedpipe[0]);
+    close(this->startedpipe[1]);
+  }
+  pthread_mutex_destroy(&this->mutexstarted);
   log() << "EXIT\n";
   return;
 }
 
+/** The method hands an answered start to the event loop. It is called
+ * from the thread of the radius client, so it only queues the start.
+ * @param start The answered start.
+ */
+void AccountingProcess::addStarted(AcctStartCallback * start)
+{
+  pthread_mutex_lock(&this->mutexstarted);
+  this->started.push_back(start);
+  pthread_mutex_unlock(&this->mutexstarted);
+  if (write(this->startedpipe[1], "x", 1) < 0)
+  {
+    //the pipe is full, the event loop wakes up anyway
+  }
+}
+
+/** The method takes the next answered start.
+ * @param start The start is written into it.
+ * @return False if no start is answered.
+ */
+bool AccountingProcess::takeStarted(AcctStartCallback ** start)
+{
+  bool found=false;
+  pthread_mutex_lock(&this->mutexstarted);
+  if (!this->started.empty())
+  {
+    *start=this->started.front();
+    this->started.pop_front();
+    found=true;
+  }
+  pthread_mutex_unlock(&this->mutexstarted);
+  return found;
+}
+
+/** The method finishes a new user when his start ticket is answered. If the start
+ * succeeded the system routes are set, the vendor specific attribute script is called
+ * and the user is added to the scheduler. A user who was deleted before the start was
+ * answered is stopped at once. Then the response is sent to the foreground process.
+ * @param start The answered start, it is deleted.
+ * @param scheduler The scheduler of the event loop.
+ */
+void AccountingProcess::finishStart(AcctStartCallback * start, AcctScheduler &scheduler)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-ACCT-LOOP]", context->getVerbosity());
+  UserAcct * user = &start->user;
+  const int requestid = start->requestid;
+  int status = RESPONSE_FAILED;
+
+  map<string, AcctStartCallback *>::iterator iter=this->starting.find(user->getKey());
+  if (iter != this->starting.end() && iter->second == start)
+  {
+    this->starting.erase(iter);
+  }
+
+  try
+  {
+    if (start->result < 0 || start->packet.getCode() != ACCOUNTING_RESPONSE)
+    {
+      //delete the ccd file which was created at authentication
+      //user->deleteCcdFile(context);
+      //tell the parent parent process something is wrong
+      log() << " Failed to send start ticket (fatal)!" << "\n";
+      throw Exception("Accounting failed.\n");
+    }
+    log.debug() << " Start packet sent.\n";
+
+    if (start->cancelled)
+    {
+      //the routes and the script are not set up, only the stop ticket is sent
+      log() << " User with key " << user->getKey() << " was deleted before the start ticket was answered, send the stop ticket.\n";
+      user->submitStopPacket(context);
+      throw Exception("User was deleted.\n");
+    }
+
+    //set the system routes
+    user->addSystemRoutes(context);
+
+    string script = context->conf.getVsaScript();
+    //execute vendor specific attribute script
+    if (script.length() > 0)
+    {
+      log.debug() << " Call vendor specific attribute script: '" << script << "'.\n";
+      if (callVsaScript(context, user, 1, 0) != 0) {
+        log() << " Vendor specific script failed to execute (fatal)!" << "\n";
+        throw Exception("Vendor specific attribute script failed.\n");
+      }
+    }
+
+    //add the user to the scheduler
+    scheduler.addUser(*user);
+    log.debug() << "RADIUS-PLUGIN: BACKGROUND ACCT: User was added to accounting scheduler.\n";
+    status = RESPONSE_SUCCEEDED;
+  }
+  catch (Exception &e)
+  {
+    log() << "failed while do add user command: " << e << "!\n";
+  }
+  catch (std::exception &e) {
+    log() << "failed while do add user command: " << e.what() << "!\n";
+  }
+  catch (...) {
+    log() << "Unknown Exception!\n";
+  }
+  delete start;
+
+  //send the result to the parent process
+  if(context->conf.getNonFatalAccounting()==false) {
+    log() << "send non nonfatal " << (status == RESPONSE_SUCCEEDED ? "success" : "fail") << " response\n";
+    this->sendResponse(context, requestid, status);
+  }
+}
+
 /** This method executes the program for the vendor specific attributes and pass
  * attributes to the program and vendor specific attributes as a buffer
  * to the program.
@@ -543,4 +728,40 @@ int AccountingProcess::callVsaScript(PluginContext * context, User * user, unsig
   return 0;
 }
 
+/** The constructor.
+ * @param process The process which finishes the start.
+ * @param requestid The request id of the ADD_USER command.
+ */
+AcctStartCallback::AcctStartCallback(AccountingProcess * process, int requestid):packet(ACCOUNTING_REQUEST)
+{
+  this->process=process;
+  this->requestid=requestid;
+  this->result=NO_RESPONSE;
+  this->cancelled=false;
+}
 
+/** The method is called by the radius client when the start packet is answered
+ * or all servers failed. The start is handed to the event loop.
+ * @param packet The start packet with the response.
+ * @param result 0 if a response was received.
+ */
+void AcctStartCallback::complete(RadiusPacket * packet, int result)
+{
+  this->result=result;
+  this->process->addStarted(this);
+}
+
+/** The method sends a response to the foreground process. The response
+ * carries the request id of the command, so the foreground process does not
+ * need to wait for it.
+ * @param context The plugin context as an object from the class PluginContext.
+ * @param requestid The request id of the command.
+ * @param status RESPONSE_SUCCEEDED or RESPONSE_FAILED.
+ */
+void AccountingProcess::sendResponse(PluginContext * context, int requestid, int status)
+{
+  IpcMessage response;
+  response.add(requestid);
+  response.add(status);
+  context->acctsocketforegr.send(response);
+}
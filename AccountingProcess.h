@@ -27,13 +27,52 @@
 #include "UserAcct.h"
 #include "AcctScheduler.h"
 #include "radiusplugin.h"
+#include <pthread.h>
+#include <list>
+#include <map>
 
-/** The class represents the background process for accounting. */
+class AccountingProcess;
+
+/** The callback for the accounting start packet of a new user. The radius client
+ * calls it from its thread, it hands itself to the event loop of the accounting
+ * process, which sets up the user in AccountingProcess::finishStart().*/
+class AcctStartCallback : public RadiusRequestCallback
+{
+	friend class AccountingProcess;
+private:
+	AccountingProcess * process;	/**<The process which finishes the start.*/
+	int requestid;				/**<The request id of the ADD_USER command.*/
+	UserAcct user;				/**<The new user.*/
+	RadiusPacket packet;			/**<The start packet, the response is written into it.*/
+	int result;				/**<The result of the request.*/
+	bool cancelled;				/**<Set by the event loop if the user was deleted before the start finished.*/
+
+public:
+	AcctStartCallback(AccountingProcess *, int);
+	void complete(RadiusPacket *, int);
+};
+
+/** The class represents the background process for accounting. The event loop
+ * never waits on a radius server, the start, update and stop packets are submitted
+ * to the radius client. */
 class AccountingProcess
 {
+private:
+	PluginContext * context;		/**<The context of the background process.*/
+	map<string, AcctStartCallback *> starting;	/**<The new users whose start packet is not answered so far, by key.
+						Only used by the event loop.*/
+	list<AcctStartCallback *> started;	/**<The starts which are answered, the event loop finishes them.*/
+	pthread_mutex_t mutexstarted;		/**<Protects the list of the answered starts.*/
+	int startedpipe[2];			/**<A pipe to wake up the event loop when a start is answered.*/
+
+	bool takeStarted(AcctStartCallback **);
+	void finishStart(AcctStartCallback *, AcctScheduler &);
+
 public:
 	void Accounting(PluginContext *);
 	int callVsaScript(PluginContext *, User *, unsigned int , unsigned int);
+	void sendResponse(PluginContext *, int, int);
+	void addStarted(AcctStartCallback *);
 };
 
 #endif //_ACCOUNTINGPROCESS_H_
@@ -65,7 +65,8 @@ void AcctScheduler::addUser(const UserAcct &user)
 
 /** The method deletes an user from the user lists. Before
  * the user is deleted the status file is parsed for the sent and received bytes
- * and the stop accounting ticket is send to the server.
+ * and the stop accounting ticket is submitted to the radius client. The method
+ * doesn't wait for the response of the server.
  * @param context The plugin context as an object from the class PluginContext.
  * @param user A pointer to an object from the class UserAcct
  */
@@ -87,9 +88,9 @@ void AcctScheduler::delUser(PluginContext * context, UserAcct *user)
                 << " in: " << user->getBytesIn()
                 << " out: " << user->getBytesOut() << "\n";
 
-    //send the stop ticket
-    if (user->sendStopPacket(context)==0) {
-      log.debug() << "Stop packet was sent. CN: " << user->getCommonname() << ".\n";
+    //send the stop ticket, the result is logged when the response arrives
+    if (user->submitStopPacket(context)==0) {
+      log.debug() << "Stop packet was submitted. CN: " << user->getCommonname() << ".\n";
     }
     else {
       log() << "Error on sending stop packet.\n";
@@ -120,15 +121,16 @@ void AcctScheduler::delallUsers(PluginContext * context)
     iter2=activeuserlist.end();
 
     while (iter1!=iter2) {
+      //delUser erases the user from the map
+      map<string, UserAcct>::iterator user=iter1++;
       try {
-        this->delUser(context,&(iter1->second));
+        this->delUser(context,&(user->second));
       } catch (std::exception &e) {
         log() << "Got error while deleting user: " << e.what() << "\n";
       }
       catch (...) {
         log() << "Got error while deleting user\n";
       }
-      ++iter1;
     }
     log.debug() << "done\n";
 }
@@ -155,6 +157,7 @@ void AcctScheduler::doAccounting(PluginContext * context)
 
     time_t start_time;
     time(&start_time);
+    bool submitted=false;
     while (iter1!=iter2)
     {
         //get the time
@@ -162,7 +165,7 @@ void AcctScheduler::doAccounting(PluginContext * context)
 
         if((t - start_time) > iter1->second.getAcctInterimInterval()) {
           log() << "Update ticket loop interrupted (to avoid progressive delay)\n";
-          return;
+          break;
         }
         //if the user needs an update
         if ( t>=iter1->second.getNextUpdate())
@@ -176,8 +179,10 @@ void AcctScheduler::doAccounting(PluginContext * context)
             iter1->second.setGigaIn(bytesin >> 32);
             iter1->second.setGigaOut(bytesout >> 32);
 
-            if(iter1->second.sendUpdatePacket(context) == 0) {
-              log.debug() << "Sent update packet for User " << iter1->second.getUsername()
+            //the packets of one tick are signed and sent together by the radius client
+            if(iter1->second.submitUpdatePacket(context, false) == 0) {
+              submitted=true;
+              log.debug() << "Submitted update packet for User " << iter1->second.getUsername()
                           << " (" << iter1->second.getStatusFileKey() << ")\n";
             } else {
               log() << "Fail while send update packet for User " << iter1->second.getUsername()
@@ -190,6 +195,10 @@ void AcctScheduler::doAccounting(PluginContext * context)
         }
         iter1++;
     }
+    //the radius client takes all packets of the tick at once
+    if (submitted) {
+      context->radiusclient.wakeUp();
+    }
 }
 
 
@@ -0,0 +1,168 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+#include "AuthCache.h"
+#include <gcrypt.h>
+#include <string.h>
+#include <iostream>
+
+using namespace std;
+
+/** The constructor. The cache is disabled until a ttl is set.*/
+AuthCache::AuthCache(void)
+{
+    this->ttl=0;
+    this->salted=false;
+    memset(this->salt, 0, AUTHCACHE_SALT_LEN);
+    pthread_mutex_init(&this->mutex, NULL);
+}
+
+/** The destructor clears the entries.*/
+AuthCache::~AuthCache(void)
+{
+    this->entries.clear();
+    pthread_mutex_destroy(&this->mutex);
+}
+
+/** The getter method for the lifetime of the entries.
+ * @return The lifetime in seconds, 0 if the cache is disabled.
+ */
+int AuthCache::getTtl(void)
+{
+    return this->ttl;
+}
+
+/** The setter method for the lifetime of the entries.
+ * @param t The lifetime in seconds, 0 disables the cache.
+ */
+void AuthCache::setTtl(int t)
+{
+    this->ttl=t;
+}
+
+/** The method calculates the salted digest of username and password.
+ * The salt is generated at the first call.
+ * @param username The username.
+ * @param password The password.
+ * @return The digest, it is empty if the cache is disabled or the digest could not be calculated.
+ */
+string AuthCache::digest(const string &username, const string &password)
+{
+    gcry_md_hd_t context;
+    unsigned char *msg_dig;
+    string result;
+
+    if (this->ttl <= 0)
+    {
+        return result;
+    }
+
+    pthread_mutex_lock(&this->mutex);
+    if (!this->salted)
+    {
+        if(!gcry_control(GCRYCTL_ANY_INITIALIZATION_P))
+        {
+            gcry_check_version(NULL);
+            gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
+            gcry_control(GCRYCTL_INITIALIZATION_FINISHED);
+        }
+        gcry_randomize(this->salt, AUTHCACHE_SALT_LEN, GCRY_STRONG_RANDOM);
+        this->salted=true;
+    }
+    pthread_mutex_unlock(&this->mutex);
+
+    if (gcry_md_open(&context, GCRY_MD_SHA256, 0) != 0)
+    {
+        cerr << "RADIUS-PLUGIN: AuthCache: gcry_md_open failed.\n";
+        return result;
+    }
+    gcry_md_write(context, this->salt, AUTHCACHE_SALT_LEN);
+    //the username is written with the terminating zero, so username and password can't be shifted
+    gcry_md_write(context, username.c_str(), username.length()+1);
+    gcry_md_write(context, password.c_str(), password.length());
+    msg_dig = gcry_md_read(context, GCRY_MD_SHA256);
+    if (msg_dig)
+    {
+        result.assign((const char *) msg_dig, AUTHCACHE_DIGEST_LEN);
+    }
+    gcry_md_close(context);
+    return result;
+}
+
+/** The method adds a successful authentication to the cache.
+ * @param key The key of the user.
+ * @param digest The digest of username and password which were accepted.
+ */
+void AuthCache::add(const string &key, const string &digest)
+{
+    AuthCacheEntry entry;
+
+    if (this->ttl <= 0 || digest.empty())
+    {
+        return;
+    }
+    entry.digest=digest;
+    entry.expires=time(NULL)+this->ttl;
+    pthread_mutex_lock(&this->mutex);
+    this->entries[key]=entry;
+    pthread_mutex_unlock(&this->mutex);
+}
+
+/** The method searches a successful authentication in the cache. An
+ * expired entry is removed.
+ * @param key The key of the user.
+ * @param digest The digest of username and password of the renegotiation.
+ * @return True if the authentication is cached and not expired.
+ */
+bool AuthCache::find(const string &key, const string &digest)
+{
+    bool found=false;
+
+    if (this->ttl <= 0 || digest.empty())
+    {
+        return false;
+    }
+    pthread_mutex_lock(&this->mutex);
+    map<string, AuthCacheEntry>::iterator iter=this->entries.find(key);
+    if (iter != this->entries.end())
+    {
+        if (iter->second.expires <= time(NULL))
+        {
+            this->entries.erase(iter);
+        }
+        else
+        {
+            found = (iter->second.digest == digest);
+        }
+    }
+    pthread_mutex_unlock(&this->mutex);
+    return found;
+}
+
+/** The method removes the entry of a user.
+ * @param key The key of the user.
+ */
+void AuthCache::remove(const string &key)
+{
+    pthread_mutex_lock(&this->mutex);
+    this->entries.erase(key);
+    pthread_mutex_unlock(&this->mutex);
+}
@@ -0,0 +1,70 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+#ifndef _AUTHCACHE_H_
+#define _AUTHCACHE_H_
+#include <time.h>
+#include <pthread.h>
+#include <map>
+#include <string>
+
+using std::map;
+using std::string;
+
+#define AUTHCACHE_SALT_LEN 16 /**<The length of the salt for the password digests.*/
+#define AUTHCACHE_DIGEST_LEN 32 /**<The length of a SHA-256 digest.*/
+
+/** An entry of the authentication cache.*/
+struct AuthCacheEntry
+{
+    string digest;      /**<The salted digest of username and password which were accepted.*/
+    time_t expires;     /**<The time when the entry expires.*/
+};
+
+/** The class caches successful authentications in the foreground process.
+ * A renegotiation of a known user with the same username and password is
+ * answered from the cache until the entry expires, so the radius server is not asked again.
+ * The passwords are not stored, the entries hold a salted SHA-256 digest of
+ * username and password. The salt is random for every process.
+ */
+class AuthCache
+{
+private:
+    map<string, AuthCacheEntry> entries;    /**<The entries by the key of the user.*/
+    int ttl;                                /**<The lifetime of an entry in seconds, 0 disables the cache.*/
+    unsigned char salt[AUTHCACHE_SALT_LEN]; /**<The salt for the digests.*/
+    bool salted;                            /**<True if the salt was generated.*/
+    pthread_mutex_t mutex;                  /**<Protects the entries.*/
+
+public:
+    AuthCache(void);
+    ~AuthCache(void);
+
+    int getTtl(void);
+    void setTtl(int);
+
+    string digest(const string &, const string &);
+    void add(const string &, const string &);
+    bool find(const string &, const string &);
+    void remove(const string &);
+};
+
+#endif //_AUTHCACHE_H_
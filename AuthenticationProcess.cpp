@@ -21,13 +21,17 @@
 
 
 
+
 #include "AuthenticationProcess.h"
 
 /** This method is the background process for authentication.
  * After it is called it is in a endless loop until it get's an EXIT-command.
  * Otherwise it waits the command COMMAND_VERIFY to authenticate
- * an user. It authenticates the user with the radius protocol and
- * sends the result back to the foreground process. If the response
+ * an user. Every COMMAND_VERIFY carries a request id, the user is queued
+ * for the worker threads and the loop reads the next command at once.
+ * The workers authenticate the users with the radius protocol and
+ * send the results back to the foreground process, tagged with the request id
+ * and in the order the radius server answers. If the response
  * is an access accept ticket,
  * it parses the response from the radius server for the following attributes and
  * send them to the foregroundprocess too.:
@@ -42,12 +46,47 @@ void AuthenticationProcess::Authentication(PluginContext * context)
 {
     UserAuth *      user;       /**<The user to authenticate.*/
     int             command;    /**<A command from the parent process.*/
+    int             requestid;  /**<The request id of a verification.*/
+    IpcMessage      msg;        /**<A command from the parent process.*/
+    vector<pthread_t> workers;  /**<The worker threads.*/
+    int             i;
 
     StdLogger log("RADIUS-PLUGIN [PLUGIN-AUTH-LOOP]", context->getVerbosity());
     log.debug() << "Auth starting...\n";
+
+    this->context=context;
+    this->stopworkers=false;
+    pthread_mutex_init(&this->mutexrequests, NULL);
+    pthread_cond_init(&this->condrequests, NULL);
+
+    //start the radius client, it keeps the sockets to the radius servers
+    if (context->radiusclient.start(context->radiusconf.getRadiusServer(false), RADIUS_CLIENT_AUTH,
+                                       context->radiusconf.getBalance(false), context->radiusconf.getMaxOutstanding(false))!=0)
+    {
+      log() << "radius client could not be started.\n";
+    }
+
+    //start the workers
+    for (i=0; context->radiusclient.isRunning() && i<context->conf.getMaxAuthRequests(); i++)
+    {
+      pthread_t thread;
+      if (pthread_create(&thread, NULL, &AuthenticationProcess::worker, (void *) this) != 0)
+      {
+        log() << "failed to create auth worker thread " << i << "\n";
+        break;
+      }
+      workers.push_back(thread);
+    }
+    log.debug() << workers.size() << " auth worker threads started.\n";
+
     //Tell the parent everythink is ok.
     try {
-        context->authsocketforegr.send(RESPONSE_INIT_SUCCEEDED);
+      if (workers.empty())
+      {
+        context->authsocketforegr.send(RESPONSE_INIT_FAILED);
+        goto done;
+      }
+      context->authsocketforegr.send(RESPONSE_INIT_SUCCEEDED);
     }
     catch(Exception &e) {
       log() << "fail while send init success responce to parent process: " << e <<"\n";
@@ -62,7 +101,16 @@ void AuthenticationProcess::Authentication(PluginContext * context)
     while (1)
     {
         // get a command from foreground process
-        command = context->authsocketforegr.recvInt();
+        try
+        {
+          context->authsocketforegr.recv(msg);
+          command = msg.getInt();
+        }
+        catch (Exception &e)
+        {
+          log() << " read error on command channel: " << e << "\n";
+          goto done;
+        }
 
         log() << "got command: '" << command << "'\n";
 
@@ -70,85 +118,54 @@ void AuthenticationProcess::Authentication(PluginContext * context)
         {
         //authenticate the user
         case COMMAND_VERIFY:
+            user=NULL;
             try
             {
               log.debug() << " verifying user\n";
-              UserAuth new_user;
-              user = &new_user;
-                //get the user informations
-                user->setUsername(context->authsocketforegr.recvStr());
-                user->setPassword(context->authsocketforegr.recvStr());
-                user->setPortnumber(context->authsocketforegr.recvInt());
-                user->setSessionId(context->authsocketforegr.recvStr());
-                user->setCallingStationId(context->authsocketforegr.recvStr());
-                user->setCommonname(context->authsocketforegr.recvStr());
+              user = new UserAuth;
+                //get the request id and the user informations
+                requestid=msg.getInt();
+                user->setUsername(msg.getStr());
+                user->setPassword(msg.getStr());
+                user->setPortnumber(msg.getInt());
+                user->setSessionId(msg.getStr());
+                user->setCallingStationId(msg.getStr());
+                user->setCommonname(msg.getStr());
                 // framed-ip is an @IP if we're renegotiating, "" otherwise
-                user->setFramedIp(context->authsocketforegr.recvStr());
-
-                if(user->getFramedIp().empty()) {
-                  log.debug() << " New user auth: user: " << user->getUsername()
-                              << ", host: " << user->getCallingStationId()
-                              << ", port: " << user->getPortnumber()
-                              << ", SID: " << user->getSessionId()
-                              << ", frame ip: " << user->getFramedIp() << "\n";
-                  //<< ", CN: " << user->getCommonname() << ".\n";
-                } else {
-                  log.debug() << " Old user ReAuth: username: " << user->getUsername()
-                       << ", calling station: " << user->getCallingStationId()
-                       << ", commonname: " << user->getCommonname() << ".\n";
-                }
+                user->setFramedIp(msg.getStr());
 
-                //send the AcceptRequestPacket
-                if (user->sendAcceptRequestPacket(context)==0) /* Succeeded */
+                //hand the user to the workers, if the queue is full the verification fails at once
+                pthread_mutex_lock(&this->mutexrequests);
+                if ((int) this->requests.size() < context->conf.getMaxAuthRequests()*AUTH_QUEUE_PER_WORKER)
                 {
-                    //if the authentication succeeded
-                    //create the user configuration file
-                    //Unless this is a renegotiation (ie: if FramedIP is already set)
-                    if (user->createCcdFile(context)>0 && (user->getFramedIp().compare("") == 0)) {
-                      log() << " couldn't create ccd file (fatal)\n";
-                      throw Exception ("Ccd-file could not created for user with commonname: " +
-                                       user->getCommonname()+"!");
-                    }
-
-                    //tell the parent process
-                    context->authsocketforegr.send(RESPONSE_SUCCEEDED);
-
-                    //send the routes to the parent process
-                    context->authsocketforegr.send(user->getFramedRoutes());
-
-                    //send the framed ip to the parent process
-                    context->authsocketforegr.send(user->getFramedIp());
-
-                    if(user->getAcctInterimInterval() != 60) {
-                      log.debug() << " acct interim interval = " << user->getAcctInterimInterval() << "\n";
-                    }
-                    //send the interval to the parent process
-                    context->authsocketforegr.send(user->getAcctInterimInterval());
-
-                    //send the vsa buffer
-                    context->authsocketforegr.send(user->getVsaBuf(), user->getVsaBufLen());
-
-                    //free user_context_auth
-                    log.debug() << " Auth succeeded in radius_server().\n";
+                  this->requests.push_back(make_pair(requestid, user));
+                  pthread_cond_signal(&this->condrequests);
+                  pthread_mutex_unlock(&this->mutexrequests);
                 }
-                else /* Failed */ {
-                  log() << " failed send accept request (fatal)\n";
-                  context->authsocketforegr.send(RESPONSE_FAILED);
-                  throw Exception("Auth failed!");
+                else
+                {
+                  pthread_mutex_unlock(&this->mutexrequests);
+                  log() << " request queue is full, verification failed for user: " << user->getUsername() << "\n";
+                  delete user;
+                  user=NULL;
+                  this->sendFailed(requestid);
                 }
             }
             catch (Exception &e) {
-                log() << " failed while verify user: " << e << "\n";
+                log() << " failed while receive user: " << e << "\n";
+                delete user;
                 if (e.getErrnum()==Exception::SOCKETSEND || e.getErrnum()==Exception::SOCKETRECV) {
-                    log() << " socket error while verify user(critical)\n";
+                    log() << " socket error while receive user(critical)\n";
                     goto done;
                 }
             }
             catch (std::exception &e) {
-              log() << " failed while verify user: " << e.what() << "\n";
+              log() << " failed while receive user: " << e.what() << "\n";
+              delete user;
             }
             catch (...) {
-                log() << "unknown exception while verify user\n";
+                log() << "unknown exception while receive user\n";
+                delete user;
                 goto done;
             }
 
@@ -169,8 +186,158 @@ void AuthenticationProcess::Authentication(PluginContext * context)
         }
     }
  done:
+    //let the workers finish the queued requests and wait for them
+    pthread_mutex_lock(&this->mutexrequests);
+    this->stopworkers=true;
+    pthread_cond_broadcast(&this->condrequests);
+    pthread_mutex_unlock(&this->mutexrequests);
+    for (i=0; i<(int)workers.size(); i++)
+    {
+      pthread_join(workers[i], NULL);
+    }
+    pthread_cond_destroy(&this->condrequests);
+    pthread_mutex_destroy(&this->mutexrequests);
+    context->radiusclient.stop();
 
     log() << " EXIT\n";
     return;
 }
 
+/** The worker thread of the authentication process. It takes
+ * the queued verifications one after another until the
+ * event loop stops the workers and the queue is empty.
+ * @param p A pointer to the AuthenticationProcess object.
+ */
+void * AuthenticationProcess::worker(void * p)
+{
+    AuthenticationProcess * auth = (AuthenticationProcess *) p;
+    pair<int, UserAuth *> request;
+
+    //the signals are handled by the event loop
+    sigset_t signal_mask;
+    sigfillset(&signal_mask);
+    pthread_sigmask(SIG_BLOCK, &signal_mask, NULL);
+
+    while (1)
+    {
+      pthread_mutex_lock(&auth->mutexrequests);
+      while (auth->requests.empty() && auth->stopworkers == false)
+      {
+        pthread_cond_wait(&auth->condrequests, &auth->mutexrequests);
+      }
+      if (auth->requests.empty())
+      {
+        pthread_mutex_unlock(&auth->mutexrequests);
+        break;
+      }
+      request=auth->requests.front();
+      auth->requests.pop_front();
+      pthread_mutex_unlock(&auth->mutexrequests);
+
+      auth->verifyUser(request.first, request.second);
+      delete request.second;
+    }
+    return NULL;
+}
+
+/** The method authenticates one user at the radius server and sends
+ * the response with the request id to the foreground process.
+ * @param requestid The request id of the COMMAND_VERIFY.
+ * @param user The user to authenticate.
+ */
+void AuthenticationProcess::verifyUser(int requestid, UserAuth * user)
+{
+    StdLogger log("RADIUS-PLUGIN [PLUGIN-AUTH-WORKER]", context->getVerbosity());
+
+    if(user->getFramedIp().empty()) {
+      log.debug() << " New user auth: user: " << user->getUsername()
+                  << ", host: " << user->getCallingStationId()
+                  << ", port: " << user->getPortnumber()
+                  << ", SID: " << user->getSessionId()
+                  << ", frame ip: " << user->getFramedIp()
+                  << ", request: " << requestid << "\n";
+    } else {
+      log.debug() << " Old user ReAuth: username: " << user->getUsername()
+                  << ", calling station: " << user->getCallingStationId()
+                  << ", commonname: " << user->getCommonname()
+                  << ", request: " << requestid << ".\n";
+    }
+
+    try
+    {
+      //send the AcceptRequestPacket
+      if (user->sendAcceptRequestPacket(context)==0) /* Succeeded */
+      {
+        //if the authentication succeeded
+        //create the user configuration file
+        //Unless this is a renegotiation (ie: if FramedIP is already set)
+        if (user->createCcdFile(context)>0 && (user->getFramedIp().compare("") == 0)) {
+          log() << " couldn't create ccd file (fatal)\n";
+          throw Exception ("Ccd-file could not created for user with commonname: " +
+                           user->getCommonname()+"!");
+        }
+
+        if(user->getAcctInterimInterval() != 60) {
+          log.debug() << " acct interim interval = " << user->getAcctInterimInterval() << "\n";
+        }
+
+        //the response is one message, so it is not interleaved with the response of another worker
+        IpcMessage response;
+        response.add(requestid);
+        response.add(RESPONSE_SUCCEEDED);
+
+        //the routes, the framed ip, the interval and the vsa buffer
+        response.add(user->getFramedRoutes());
+        response.add(user->getFramedIp());
+        response.add(user->getAcctInterimInterval());
+        response.add(user->getVsaBuf(), user->getVsaBufLen());
+
+        //tell the parent process
+        context->authsocketforegr.send(response);
+
+        log.debug() << " Auth succeeded in radius_server().\n";
+      }
+      else /* Failed */ {
+        log() << " failed send accept request (fatal)\n";
+        throw Exception("Auth failed!");
+      }
+    }
+    catch (Exception &e) {
+      log() << " failed while verify user: " << e << "\n";
+      if (e.getErrnum()==Exception::SOCKETSEND || e.getErrnum()==Exception::SOCKETRECV) {
+        log() << " socket error while verify user(critical)\n";
+        //wake up the event loop, the foreground process is gone
+        context->authsocketforegr.shutdown();
+        return;
+      }
+      this->sendFailed(requestid);
+    }
+    catch (std::exception &e) {
+      log() << " failed while verify user: " << e.what() << "\n";
+      this->sendFailed(requestid);
+    }
+    catch (...) {
+      log() << "unknown exception while verify user\n";
+      this->sendFailed(requestid);
+    }
+}
+
+/** The method sends RESPONSE_FAILED for a request to the foreground process.
+ * @param requestid The request id of the COMMAND_VERIFY.
+ */
+void AuthenticationProcess::sendFailed(int requestid)
+{
+    StdLogger log("RADIUS-PLUGIN [PLUGIN-AUTH]", context->getVerbosity());
+    IpcMessage response;
+    try
+    {
+      response.add(requestid);
+      response.add(RESPONSE_FAILED);
+      context->authsocketforegr.send(response);
+    }
+    catch (Exception &e)
+    {
+      log() << " failed to send the response: " << e << "\n";
+      context->authsocketforegr.shutdown();
+    }
+}
@@ -24,11 +24,33 @@
 #include "PluginContext.h"
 #include "UserAuth.h"
 #include "radiusplugin.h"
+#include <pthread.h>
+#include <list>
+#include <vector>
+#include <utility>
 
-/**The class represents the background process for authentication.*/
+#define AUTH_QUEUE_PER_WORKER 8 /**<The queued verifications per worker (maxauthrequests), further ones fail at once.*/
+
+class UserAuth;
+
+/**The class represents the background process for authentication.
+ * The commands are read by the event loop, the verifications run in a pool of
+ * worker threads, so many requests to the radius server can be in flight at the same time.*/
 
 class AuthenticationProcess
 {
+private:
+	PluginContext * context;		/**<The context of the background process.*/
+	list< pair<int, UserAuth *> > requests;	/**<The verifications (request id and user) which wait for a free worker, at most
+						maxauthrequests*AUTH_QUEUE_PER_WORKER.*/
+	pthread_mutex_t mutexrequests;		/**<Protects the request list and the stop flag.*/
+	pthread_cond_t condrequests;		/**<Signals new requests to the workers.*/
+	bool stopworkers;			/**<Set if the workers should exit after the last request.*/
+	
+	static void * worker(void *);
+	void verifyUser(int, UserAuth *);
+	void sendFailed(int);
+	
 public:
 	void Authentication(PluginContext *);
 };
@@ -35,6 +35,13 @@ Config::Config(void)
         this->useauthcontrolfile=false;
 	this->accountingonly=false;
 	this->nonfatalaccounting=false;
+	this->maxauthrequests=32;
+	this->deferredclientconnect=false;
+	this->authcachettl=0;
+	this->failmaxattempts=0;
+	this->failwindow=60;
+	this->failcooldown=300;
+	this->shmipc=false;
 	this->ccdPath="";
 	this->openvpnconfig="";
 	this->vsanamedpipe="";
@@ -63,6 +70,13 @@ Config::Config(char * configfile)
         this->useauthcontrolfile=false;
 	this->accountingonly=false;
 	this->nonfatalaccounting=false;
+	this->maxauthrequests=32;
+	this->deferredclientconnect=false;
+	this->authcachettl=0;
+	this->failmaxattempts=0;
+	this->failwindow=60;
+	this->failcooldown=300;
+	this->shmipc=false;
 	this->parseConfigFile(configfile);
 	
 }
@@ -167,6 +181,71 @@ int Config::parseConfigFile(const char * configfile)
 					else return BAD_FILE;
 						
 				}
+				if (strncmp(line.c_str(),"maxauthrequests=",16)==0)
+				{
+					
+					string stmp=line.substr(16,line.size()-16);
+					deletechars(&stmp);
+					this->maxauthrequests=atoi(stmp.c_str());
+					if (this->maxauthrequests < 1) return BAD_FILE;
+						
+				}
+				if (strncmp(line.c_str(),"deferredclientconnect=",22)==0)
+				{
+					
+					string stmp=line.substr(22,line.size()-22);
+					deletechars(&stmp);
+					if(stmp == "true") this->deferredclientconnect=true;
+					else if (stmp =="false") this->deferredclientconnect=false;
+					else return BAD_FILE;
+						
+				}
+				if (strncmp(line.c_str(),"authcachettl=",13)==0)
+				{
+					
+					string stmp=line.substr(13,line.size()-13);
+					deletechars(&stmp);
+					this->authcachettl=atoi(stmp.c_str());
+					if (this->authcachettl < 0) return BAD_FILE;
+						
+				}
+				if (strncmp(line.c_str(),"failmaxattempts=",16)==0)
+				{
+					
+					string stmp=line.substr(16,line.size()-16);
+					deletechars(&stmp);
+					this->failmaxattempts=atoi(stmp.c_str());
+					if (this->failmaxattempts < 0) return BAD_FILE;
+						
+				}
+				if (strncmp(line.c_str(),"failwindow=",11)==0)
+				{
+					
+					string stmp=line.substr(11,line.size()-11);
+					deletechars(&stmp);
+					this->failwindow=atoi(stmp.c_str());
+					if (this->failwindow < 1) return BAD_FILE;
+						
+				}
+				if (strncmp(line.c_str(),"failcooldown=",13)==0)
+				{
+					
+					string stmp=line.substr(13,line.size()-13);
+					deletechars(&stmp);
+					this->failcooldown=atoi(stmp.c_str());
+					if (this->failcooldown < 1) return BAD_FILE;
+						
+				}
+				if (strncmp(line.c_str(),"ipctransport=",13)==0)
+				{
+					
+					string stmp=line.substr(13,line.size()-13);
+					deletechars(&stmp);
+					if(stmp == "shm") this->shmipc=true;
+					else if (stmp =="socket") this->shmipc=false;
+					else return BAD_FILE;
+						
+				}
 			}
 			
 		}
@@ -537,3 +616,121 @@ void Config::setNonFatalAccounting(bool b)
 {
  this->nonfatalaccounting=b; 
 }
+
+
+/** The getter method for the maximum number of authentications
+ * which are in flight at the same time in the background process.
+ * @return The maximum number of concurrent authentications.
+ */
+int Config::getMaxAuthRequests(void)
+{
+ return this->maxauthrequests; 
+}
+
+/** The setter method for the maximum number of concurrent authentications.
+ * @param num The maximum number, it must be at least 1.
+ */
+void Config::setMaxAuthRequests(int num)
+{
+ this->maxauthrequests=num; 
+}
+
+
+/** The getter method for the deferred client connect.
+ * @return True if the client connect is deferred.
+ */
+bool Config::getDeferredClientConnect(void)
+{
+ return this->deferredclientconnect; 
+}
+
+/** The setter method for the deferred client connect.
+ * @param b True if the client connect is deferred.
+ */
+void Config::setDeferredClientConnect(bool b)
+{
+ this->deferredclientconnect=b; 
+}
+
+
+/** The getter method for the lifetime of cached authentications.
+ * @return The lifetime in seconds, 0 if the cache is disabled.
+ */
+int Config::getAuthCacheTtl(void)
+{
+ return this->authcachettl; 
+}
+
+/** The setter method for the lifetime of cached authentications.
+ * @param t The lifetime in seconds, 0 disables the cache.
+ */
+void Config::setAuthCacheTtl(int t)
+{
+ this->authcachettl=t; 
+}
+
+
+/** The getter method for the number of failed logins which block a username or a source address.
+ * @return The number of failed logins, 0 if the throttle is disabled.
+ */
+int Config::getFailMaxAttempts(void)
+{
+ return this->failmaxattempts; 
+}
+
+/** The setter method for the number of failed logins which block a username or a source address.
+ * @param n The number of failed logins, 0 disables the throttle.
+ */
+void Config::setFailMaxAttempts(int n)
+{
+ this->failmaxattempts=n; 
+}
+
+/** The getter method for the window of the failed logins.
+ * @return The window in seconds.
+ */
+int Config::getFailWindow(void)
+{
+ return this->failwindow; 
+}
+
+/** The setter method for the window of the failed logins.
+ * @param t The window in seconds.
+ */
+void Config::setFailWindow(int t)
+{
+ this->failwindow=t; 
+}
+
+/** The getter method for the time a username or a source address is blocked.
+ * @return The time in seconds.
+ */
+int Config::getFailCooldown(void)
+{
+ return this->failcooldown; 
+}
+
+/** The setter method for the time a username or a source address is blocked.
+ * @param t The time in seconds.
+ */
+void Config::setFailCooldown(int t)
+{
+ this->failcooldown=t; 
+}
+
+
+/** The getter method for the transport between the foreground process and the background processes.
+ * @return True if the messages are sent through shared memory, false if they are sent through sockets.
+ */
+bool Config::getShmIpc(void)
+{
+ return this->shmipc; 
+}
+
+/** The setter method for the transport between the foreground process and the background processes.
+ * @param b True if the messages are sent through shared memory, false if they are sent through sockets.
+ */
+void Config::setShmIpc(bool b)
+{
+ this->shmipc=b; 
+}
@@ -25,6 +25,7 @@
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 
 #include "RadiusClass/error.h"
 
@@ -52,6 +53,13 @@ private:
         bool useauthcontrolfile;                /**<If true and the OpenVPN version supports auth control files, the acf is used.*/
         bool accountingonly;			/**<Only the accounting is done by the plugin.*/
 	bool nonfatalaccounting;		/**<If errors during the accounting occurs, the users can still connect.*/
+	int maxauthrequests;			/**<The maximum number of authentications the background process runs at the same time.*/
+	bool deferredclientconnect;		/**<If true the plugin uses the deferred client connect of OpenVPN, so OpenVPN doesn't wait for the accounting.*/
+	int authcachettl;			/**<The time in seconds a successful authentication is used for renegotiations, 0 disables the cache.*/
+	int failmaxattempts;			/**<The number of failed logins in the window which block a username or a source address, 0 disables the throttle.*/
+	int failwindow;				/**<The window for the failed logins in seconds.*/
+	int failcooldown;			/**<The time in seconds a username or a source address is blocked.*/
+	bool shmipc;				/**<If true the messages to the background processes are sent through shared memory instead of sockets.*/
 	void deletechars(string * );
 	
 public:
@@ -101,6 +109,25 @@ public:
 	bool getNonFatalAccounting(void);
 	void setNonFatalAccounting(bool);
 	
+	int getMaxAuthRequests(void);
+	void setMaxAuthRequests(int);
+	
+	bool getDeferredClientConnect(void);
+	void setDeferredClientConnect(bool);
+	
+	int getAuthCacheTtl(void);
+	void setAuthCacheTtl(int);
+	
+	int getFailMaxAttempts(void);
+	void setFailMaxAttempts(int);
+	int getFailWindow(void);
+	void setFailWindow(int);
+	int getFailCooldown(void);
+	void setFailCooldown(int);
+	
+	bool getShmIpc(void);
+	void setShmIpc(bool);
+	
 	string getOpenVPNConfig(void);
 	void setOpenVPNConfig(string);
 };
@@ -0,0 +1,431 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication
+ *					and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Benchmark of the ADD_USER round trip between the foreground process and
+ * the accounting background process. A child process plays the background
+ * process, it decodes the command into a User and answers it.
+ * - fields:  the old protocol, one write() per integer and two per string
+ *            or buffer (length, bytes), and as many read()s with a new
+ *            buffer for every string on the other side.
+ * - message: the command is one IpcMessage, one datagram on the socket.
+ * - ring:    the command is one IpcMessage in the IpcRing in shared memory.
+ *
+ * Build and run it with: make bench
+ * Usage: IpcBench [round trips]
+ */
+
+#include "IpcSocket.h"
+#include "IpcMessage.h"
+#include "IpcRing.h"
+#include "User.h"
+#include "Exception.h"
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define BENCH_ADD_USER 3 /**<The command, like ADD_USER of the plugin.*/
+#define BENCH_EXIT 5 /**<The command which ends the child.*/
+#define BENCH_VSA_LEN 48 /**<The length of the vendor specific attributes of the user.*/
+
+static long fieldcalls; /**<The system calls of the old protocol in the foreground process.*/
+
+/** Writes a value with the old protocol, the length and the bytes separately.
+ * @param fd The socket.
+ * @param value The bytes.
+ * @param len The length.
+ */
+static void fieldSend(int fd, const void * value, ssize_t len)
+{
+	if (write(fd, &len, sizeof(ssize_t)) != sizeof(ssize_t))
+	{
+		throw Exception(Exception::SOCKETSEND);
+	}
+	fieldcalls++;
+	if (len > 0)
+	{
+		if (write(fd, value, len) != len)
+		{
+			throw Exception(Exception::SOCKETSEND);
+		}
+		fieldcalls++;
+	}
+}
+
+/** Writes an integer with the old protocol.
+ * @param fd The socket.
+ * @param num The integer.
+ */
+static void fieldSendInt(int fd, int num)
+{
+	if (write(fd, &num, sizeof(int)) != sizeof(int))
+	{
+		throw Exception(Exception::SOCKETSEND);
+	}
+	fieldcalls++;
+}
+
+/** Reads an integer with the old protocol.
+ * @param fd The socket.
+ * @return The integer.
+ */
+static int fieldRecvInt(int fd)
+{
+	int num;
+	if (read(fd, &num, sizeof(int)) != sizeof(int))
+	{
+		throw Exception(Exception::SOCKETRECV);
+	}
+	fieldcalls++;
+	return num;
+}
+
+/** Reads a string with the old protocol, into a new buffer like IpcSocket::recvStr() did.
+ * @param fd The socket.
+ * @return The string.
+ */
+static string fieldRecvStr(int fd)
+{
+	ssize_t len;
+	char * buffer;
+	string str;
+
+	if (read(fd, &len, sizeof(ssize_t)) != sizeof(ssize_t))
+	{
+		throw Exception(Exception::SOCKETRECV);
+	}
+	fieldcalls++;
+	if (len > 0)
+	{
+		buffer=new char[len+1];
+		memset(buffer, 0, len+1);
+		if (read(fd, buffer, len) != len)
+		{
+			delete [] buffer;
+			throw Exception(Exception::SOCKETRECV);
+		}
+		fieldcalls++;
+		str=buffer;
+		delete [] buffer;
+	}
+	return str;
+}
+
+/** Reads the vendor specific attributes with the old protocol.
+ * @param fd The socket.
+ * @param user The user, the buffer is set.
+ */
+static void fieldRecvBuf(int fd, User * user)
+{
+	ssize_t len;
+
+	if (read(fd, &len, sizeof(ssize_t)) != sizeof(ssize_t))
+	{
+		throw Exception(Exception::SOCKETRECV);
+	}
+	fieldcalls++;
+	delete [] user->getVsaBuf();
+	user->setVsaBuf(NULL);
+	user->setVsaBufLen(len);
+	if (len > 0)
+	{
+		user->setVsaBuf(new Octet[len]);
+		if (read(fd, user->getVsaBuf(), len) != len)
+		{
+			throw Exception(Exception::SOCKETRECV);
+		}
+		fieldcalls++;
+	}
+}
+
+/** Fills the user like OPENVPN_PLUGIN_CLIENT_CONNECT does.
+ * @param user The user.
+ */
+static void fillUser(User * user)
+{
+	user->setUsername("user1@example.org");
+	user->setSessionId("00000000000000000000000000000001");
+	user->setPortnumber(17);
+	user->setCallingStationId("192.0.2.55");
+	user->setFramedIp("10.8.0.6");
+	user->setCommonname("client1.example.org");
+	user->setAcctInterimInterval(300);
+	user->setFramedRoutes("192.168.101.0/26 10.8.0.1/32 1;192.168.111.0/24 10.8.0.1/32 1");
+	user->setKey("client1.example.org,192.0.2.55:49152");
+	user->setStatusFileKey("client1.example.org,192.0.2.55:49152");
+	user->setUntrustedPort("49152");
+	user->setVsaBufLen(BENCH_VSA_LEN);
+	user->setVsaBuf(new Octet[BENCH_VSA_LEN]);
+	memset(user->getVsaBuf(), 0x1a, BENCH_VSA_LEN);
+}
+
+/** Sends ADD_USER with the old protocol.
+ * @param fd The socket.
+ * @param user The user.
+ */
+static void fieldAddUser(int fd, User * user)
+{
+	fieldSendInt(fd, BENCH_ADD_USER);
+	fieldSend(fd, user->getUsername().c_str(), user->getUsername().size());
+	fieldSend(fd, user->getSessionId().c_str(), user->getSessionId().size());
+	fieldSendInt(fd, user->getPortnumber());
+	fieldSend(fd, user->getCallingStationId().c_str(), user->getCallingStationId().size());
+	fieldSend(fd, user->getFramedIp().c_str(), user->getFramedIp().size());
+	fieldSend(fd, user->getCommonname().c_str(), user->getCommonname().size());
+	fieldSendInt(fd, user->getAcctInterimInterval());
+	fieldSend(fd, user->getFramedRoutes().c_str(), user->getFramedRoutes().size());
+	fieldSend(fd, user->getKey().c_str(), user->getKey().size());
+	fieldSend(fd, user->getStatusFileKey().c_str(), user->getStatusFileKey().size());
+	fieldSend(fd, user->getUntrustedPort().c_str(), user->getUntrustedPort().size());
+	fieldSend(fd, user->getVsaBuf(), user->getVsaBufLen());
+}
+
+/** The background process of the old protocol, it decodes every ADD_USER and answers it.
+ * @param fd The socket.
+ */
+static void fieldBackground(int fd)
+{
+	User user;
+	while (fieldRecvInt(fd) == BENCH_ADD_USER)
+	{
+		user.setUsername(fieldRecvStr(fd));
+		user.setSessionId(fieldRecvStr(fd));
+		user.setPortnumber(fieldRecvInt(fd));
+		user.setCallingStationId(fieldRecvStr(fd));
+		user.setFramedIp(fieldRecvStr(fd));
+		user.setCommonname(fieldRecvStr(fd));
+		user.setAcctInterimInterval(fieldRecvInt(fd));
+		user.setFramedRoutes(fieldRecvStr(fd));
+		user.setKey(fieldRecvStr(fd));
+		user.setStatusFileKey(fieldRecvStr(fd));
+		user.setUntrustedPort(fieldRecvStr(fd));
+		fieldRecvBuf(fd, &user);
+		fieldSendInt(fd, user.getPortnumber() == 17 ? 0 : 1);
+	}
+}
+
+/** Builds ADD_USER as one message like acct_add_user().
+ * @param msg The message.
+ * @param requestid The request id.
+ * @param user The user.
+ */
+static void messageAddUser(IpcMessage &msg, int requestid, User * user)
+{
+	msg.clear();
+	msg.add(BENCH_ADD_USER);
+	msg.add(requestid);
+	msg.add(user->getUsername());
+	msg.add(user->getSessionId());
+	msg.add(user->getPortnumber());
+	msg.add(user->getCallingStationId());
+	msg.add(user->getFramedIp());
+	msg.add(user->getCommonname());
+	msg.add(user->getAcctInterimInterval());
+	msg.add(user->getFramedRoutes());
+	msg.add(user->getKey());
+	msg.add(user->getStatusFileKey());
+	msg.add(user->getUntrustedPort());
+	msg.add(user->getVsaBuf(), user->getVsaBufLen());
+}
+
+/** The background process of the messages, it decodes every ADD_USER and
+ * answers it with the request id and the status like AccountingProcess.
+ * @param sock The socket or the rings.
+ */
+static void messageBackground(IpcSocket &sock)
+{
+	IpcMessage msg, response;
+	User user;
+	int requestid;
+
+	while (1)
+	{
+		sock.recv(msg);
+		if (msg.getInt() != BENCH_ADD_USER)
+		{
+			break;
+		}
+		requestid=msg.getInt();
+		user.setUsername(msg.getStr());
+		user.setSessionId(msg.getStr());
+		user.setPortnumber(msg.getInt());
+		user.setCallingStationId(msg.getStr());
+		user.setFramedIp(msg.getStr());
+		user.setCommonname(msg.getStr());
+		user.setAcctInterimInterval(msg.getInt());
+		user.setFramedRoutes(msg.getStr());
+		user.setKey(msg.getStr());
+		user.setStatusFileKey(msg.getStr());
+		user.setUntrustedPort(msg.getStr());
+		msg.getBuf(&user);
+		response.clear();
+		response.add(requestid);
+		response.add(user.getPortnumber() == 17 ? 0 : 1);
+		sock.send(response);
+	}
+}
+
+/** Returns the time in nanoseconds.*/
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+/** Prints the result of a mode.
+ * @param mode The name of the mode.
+ * @param n The number of round trips.
+ * @param ns The time of all round trips.
+ * @param calls The system calls of the foreground process per round trip.
+ */
+static void report(const char * mode, int n, double ns, double calls)
+{
+	printf("%-8s %8d round trips  %8.0f ns/round trip  %9.0f round trips/s  %5.1f syscalls/round trip (foreground)\n",
+		   mode, n, ns/n, n/(ns/1e9), calls);
+}
+
+int main(int argc, char ** argv)
+{
+	const int n=(argc > 1) ? atoi(argv[1]) : 100000;
+	int fd[2], i, status;
+	pid_t pid;
+	double start;
+	User user;
+	IpcMessage msg;
+
+	fillUser(&user);
+	try
+	{
+		//the old protocol, one system call per field
+		if (socketpair(PF_UNIX, SOCK_DGRAM, 0, fd) == -1)
+		{
+			perror("IpcBench: socketpair");
+			return 1;
+		}
+		pid=fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			fieldBackground(fd[1]);
+			_exit(0);
+		}
+		close(fd[1]);
+		fieldcalls=0;
+		start=now();
+		for (i=0; i<n; i++)
+		{
+			fieldAddUser(fd[0], &user);
+			if (fieldRecvInt(fd[0]) != 0)
+			{
+				throw Exception("IpcBench: Wrong response.\n");
+			}
+		}
+		report("fields", n, now()-start, (double) fieldcalls/n);
+		fieldSendInt(fd[0], BENCH_EXIT);
+		close(fd[0]);
+		waitpid(pid, &status, 0);
+
+		//one datagram per command
+		if (socketpair(PF_UNIX, SOCK_DGRAM, 0, fd) == -1)
+		{
+			perror("IpcBench: socketpair");
+			return 1;
+		}
+		pid=fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			IpcSocket background(fd[1]);
+			messageBackground(background);
+			_exit(0);
+		}
+		close(fd[1]);
+		{
+			IpcSocket foreground(fd[0]);
+			start=now();
+			for (i=0; i<n; i++)
+			{
+				messageAddUser(msg, i, &user);
+				foreground.send(msg);
+				foreground.recv(msg);
+				if (msg.getInt() != i || msg.getInt() != 0)
+				{
+					throw Exception("IpcBench: Wrong response.\n");
+				}
+			}
+			report("message", n, now()-start, 2);
+			foreground.send(BENCH_EXIT);
+		}
+		waitpid(pid, &status, 0);
+
+		//one message in shared memory per command, the socket is only kept
+		IpcRing * rings[2]={new IpcRing(), new IpcRing()};
+		if (rings[0]->create() != 0 || rings[1]->create() != 0 ||
+			socketpair(PF_UNIX, SOCK_DGRAM, 0, fd) == -1)
+		{
+			cerr << "IpcBench: The rings could not be created.\n";
+			return 1;
+		}
+		pid=fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			IpcSocket background(fd[1]);
+			rings[1]->setPeer(getppid());
+			background.setRings(rings[1], rings[0]);
+			messageBackground(background);
+			_exit(0);
+		}
+		close(fd[1]);
+		{
+			IpcSocket foreground(fd[0]);
+			rings[0]->setPeer(pid);
+			foreground.setRings(rings[0], rings[1]);
+			start=now();
+			for (i=0; i<n; i++)
+			{
+				messageAddUser(msg, i, &user);
+				foreground.send(msg);
+				foreground.recv(msg);
+				if (msg.getInt() != i || msg.getInt() != 0)
+				{
+					throw Exception("IpcBench: Wrong response.\n");
+				}
+			}
+			//one write() on the eventfd to signal and one read() to wait
+			report("ring", n, now()-start, 2);
+			foreground.send(BENCH_EXIT);
+		}
+		waitpid(pid, &status, 0);
+	}
+	catch (Exception &e)
+	{
+		cerr << "IpcBench: " << e << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include "IpcMessage.h"
+
+
+/** The constructor creates an empty message.*/
+IpcMessage::IpcMessage()
+{
+    this->length=0;
+    this->position=0;
+}
+
+/** The method empties the message, so it can be used for the next command.*/
+void IpcMessage::clear(void)
+{
+    this->length=0;
+    this->position=0;
+}
+
+/** The method returns the buffer of the message.
+ * @return The buffer, it has a size of IPC_MESSAGE_MAX.
+ */
+Octet * IpcMessage::getBuffer(void)
+{
+    return this->buffer;
+}
+
+/** The method returns the length of the message.
+ * @return The length.
+ */
+ssize_t IpcMessage::getLength(void)
+{
+    return this->length;
+}
+
+/** The method sets the length of a received message, the fields
+ * are read from the beginning.
+ * @param len The length.
+ */
+void IpcMessage::setLength(ssize_t len)
+{
+    this->length=len;
+    this->position=0;
+}
+
+/** The method appends bytes to the message.
+ * @param value The bytes.
+ * @param len The number of bytes.
+ * @throws Exception::SOCKETSEND if the message gets longer than IPC_MESSAGE_MAX.
+ */
+void IpcMessage::append(const void * value, ssize_t len)
+{
+    if (len < 0 || len > IPC_MESSAGE_MAX - this->length)
+    {
+        throw Exception(Exception::SOCKETSEND);
+    }
+    memcpy(this->buffer + this->length, value, len);
+    this->length+=len;
+}
+
+/** The method checks if a field with len bytes follows in the message.
+ * @param len The number of bytes.
+ * @return The position of the field.
+ * @throws Exception::SOCKETRECV if the message is too short.
+ */
+ssize_t IpcMessage::remaining(ssize_t len)
+{
+    ssize_t pos=this->position;
+    if (len < 0 || len > this->length - pos)
+    {
+        throw Exception(Exception::SOCKETRECV);
+    }
+    this->position+=len;
+    return pos;
+}
+
+/** The method adds an integer to the message.
+ * @param num The integer.
+ */
+void IpcMessage::add(int num)
+{
+    this->append(&num, sizeof(int));
+}
+
+/** The method adds a string with its length to the message.
+ * @param str The string.
+ */
+void IpcMessage::add(const string &str)
+{
+    ssize_t len = str.size();
+    this->append(&len, sizeof(ssize_t));
+    this->append(str.data(), len);
+}
+
+/** The method adds a buffer with its length to the message.
+ * @param value The buffer.
+ * @param len The length of the buffer.
+ */
+void IpcMessage::add(const Octet * value, ssize_t len)
+{
+    if (value == NULL)
+    {
+        len=0;
+    }
+    this->append(&len, sizeof(ssize_t));
+    this->append(value, len);
+}
+
+/** The method reads the next integer from the message.
+ * @return The integer.
+ * @throws Exception::SOCKETRECV if the message is too short.
+ */
+int IpcMessage::getInt(void)
+{
+    int num;
+    memcpy(&num, this->buffer + this->remaining(sizeof(int)), sizeof(int));
+    return num;
+}
+
+/** The method reads the next string from the message. The string is
+ * copied from the message without a temporary buffer.
+ * @return The string.
+ * @throws Exception::SOCKETRECV if the message is too short.
+ */
+string IpcMessage::getStr(void)
+{
+    ssize_t len;
+    memcpy(&len, this->buffer + this->remaining(sizeof(ssize_t)), sizeof(ssize_t));
+    //the old format ended a string at the first zero, keep it
+    const char * str=(const char *) (this->buffer + this->remaining(len));
+    return string(str, strnlen(str, len));
+}
+
+/** The method reads the next buffer from the message into the
+ * vendor specific attribute buffer of the user.
+ * @param user The user.
+ * @throws Exception::SOCKETRECV if the message is too short.
+ */
+void IpcMessage::getBuf(User * user)
+{
+    ssize_t len;
+    memcpy(&len, this->buffer + this->remaining(sizeof(ssize_t)), sizeof(ssize_t));
+    const Octet * value=this->buffer + this->remaining(len);
+    delete [] user->getVsaBuf();
+    user->setVsaBuf(NULL);
+    user->setVsaBufLen(len);
+    if (len > 0)
+    {
+      user->setVsaBuf(new Octet[len]);
+      memcpy(user->getVsaBuf(), value, len);
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+ 
+#ifndef _IPCMESSAGE_H_
+#define _IPCMESSAGE_H_
+
+#include <string>
+#include <cstring>
+#include <sys/types.h>
+#include "User.h"
+#include "Exception.h"
+
+using namespace std;
+
+typedef unsigned char Octet;
+
+#define IPC_MESSAGE_MAX 65536 /**<The maximum length of a message.*/
+
+/** This class represents a message between the foreground process and
+ * a background process. All fields of a command or a response are written
+ * into one buffer, which is sent as one datagram with IpcSocket::send(IpcMessage &).
+ * The receiver decodes the fields in the same order from the buffer, without
+ * further system calls.
+ * An integer is stored as it is, a string or a buffer is stored with its length
+ * (ssize_t) before the bytes.
+ */
+class IpcMessage
+{
+private:
+	Octet buffer[IPC_MESSAGE_MAX];	/**<The message.*/
+	ssize_t length;			/**<The length of the message.*/
+	ssize_t position;		/**<The position of the next field which is read.*/
+	
+	void append(const void *, ssize_t);
+	ssize_t remaining(ssize_t);
+	
+public:
+	IpcMessage();
+	
+	void clear(void);
+	
+	Octet * getBuffer(void);
+	ssize_t getLength(void);
+	void setLength(ssize_t);
+	
+	void add(int);
+	void add(const string &);
+	void add(const Octet *, ssize_t);
+	
+	int getInt(void);
+	string getStr(void);
+	void getBuf(User *);
+};
+
+#endif //_IPCMESSAGE_H_
@@ -0,0 +1,285 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include "IpcRing.h"
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#define IPC_RING_WRAP ((int64_t) -1) /**<The length which marks the rest of the data as unused, the next message starts at the beginning.*/
+
+/** The length of a record with a message of len bytes, the records are aligned to 8 bytes.*/
+#define IPC_RING_RECORD(len) ((sizeof(int64_t) + (len) + 7) & ~((uint64_t) 7))
+
+/** The constructor. The ring must be created with create() before it is used.*/
+IpcRing::IpcRing()
+{
+    this->header=NULL;
+    this->data=NULL;
+    this->eventfd=-1;
+    this->spacefd=-1;
+    this->peer=0;
+    pthread_mutex_init(&this->mutex, NULL);
+}
+
+/** The destructor unmaps the shared memory and closes the eventfds of this process.*/
+IpcRing::~IpcRing()
+{
+    if (this->header != NULL)
+    {
+        munmap(this->header, sizeof(IpcRingHeader) + IPC_RING_SIZE);
+    }
+    if (this->eventfd != -1)
+    {
+        ::close(this->eventfd);
+    }
+    if (this->spacefd != -1)
+    {
+        ::close(this->spacefd);
+    }
+    pthread_mutex_destroy(&this->mutex);
+}
+
+/** The method creates the shared memory and the eventfds. It must be called before the fork.
+ * @return 0 on success, -1 if the memory or the eventfds could not be created.
+ */
+int IpcRing::create(void)
+{
+    void * mem = mmap(NULL, sizeof(IpcRingHeader) + IPC_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        return -1;
+    }
+    this->eventfd = ::eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
+    this->spacefd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->eventfd == -1 || this->spacefd == -1)
+    {
+        if (this->eventfd != -1)
+        {
+            ::close(this->eventfd);
+        }
+        if (this->spacefd != -1)
+        {
+            ::close(this->spacefd);
+        }
+        this->eventfd=-1;
+        this->spacefd=-1;
+        munmap(mem, sizeof(IpcRingHeader) + IPC_RING_SIZE);
+        return -1;
+    }
+    this->header=(IpcRingHeader *) mem;
+    this->data=(Octet *) mem + sizeof(IpcRingHeader);
+    memset(this->header, 0, sizeof(IpcRingHeader));
+    return 0;
+}
+
+/** The method returns the eventfd, it is readable if a message is in the ring.
+ * @return The eventfd.
+ */
+int IpcRing::getEventFd(void)
+{
+    return this->eventfd;
+}
+
+/** The method returns the eventfd on which a producer waits for space.
+ * @return The eventfd.
+ */
+int IpcRing::getSpaceFd(void)
+{
+    return this->spacefd;
+}
+
+/** The method sets the process at the other end of the ring, it must be
+ * called after the fork. A producer which waits for space checks if it is alive.
+ * @param pid The process id of the child in the parent, of the parent in the child.
+ */
+void IpcRing::setPeer(pid_t pid)
+{
+    this->peer=pid;
+}
+
+/** The method increments the eventfd for one message.*/
+void IpcRing::signal(void)
+{
+    uint64_t one=1;
+    while (write(this->eventfd, &one, sizeof(one)) == -1 && errno == EINTR);
+}
+
+/** The method wakes up the producer which waits for space.*/
+void IpcRing::signalSpace(void)
+{
+    uint64_t one=1;
+    while (write(this->spacefd, &one, sizeof(one)) == -1 && errno == EINTR);
+}
+
+/** The method checks if the process at the other end of the ring is alive.
+ * A child which exited is found with waitid() without reaping it, so the
+ * plugin can still wait for it. If the parent exited, the child gets another parent.
+ * @return False if the peer exited.
+ */
+bool IpcRing::isPeerAlive(void)
+{
+    siginfo_t info;
+
+    if (this->peer <= 0)
+    {
+        return true;
+    }
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PID, this->peer, &info, WEXITED | WNOHANG | WNOWAIT) == 0)
+    {
+        return info.si_pid != this->peer;
+    }
+    //the peer is not a child, so it is the parent
+    return getppid() == this->peer;
+}
+
+/** The method writes a message into the ring. If the ring is full it
+ * waits on the spacefd until the consumer read enough messages.
+ * @param value The message.
+ * @param len The length of the message.
+ * @throws Exception::SOCKETSEND If the ring is closed, the peer exited or the message is too long.
+ */
+void IpcRing::put(const Octet * value, ssize_t len)
+{
+    uint64_t head, tail, need, count;
+    int64_t reclen=len;
+    struct pollfd p;
+
+    if (len < 0 || IPC_RING_RECORD(len) > IPC_RING_SIZE/2)
+    {
+        throw Exception(Exception::SOCKETSEND);
+    }
+    pthread_mutex_lock(&this->mutex);
+    tail=this->header->tail;
+    //a message is not split, if it doesn't fit at the end it starts at the beginning
+    need=IPC_RING_RECORD(len);
+    if (tail % IPC_RING_SIZE + need > IPC_RING_SIZE)
+    {
+        need+=IPC_RING_SIZE - tail % IPC_RING_SIZE;
+    }
+    while (1)
+    {
+        head=__atomic_load_n(&this->header->head, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&this->header->closed, __ATOMIC_ACQUIRE))
+        {
+            pthread_mutex_unlock(&this->mutex);
+            throw Exception(Exception::SOCKETSEND);
+        }
+        if (IPC_RING_SIZE - (tail - head) >= need)
+        {
+            break;
+        }
+        //the consumer signals only if it sees the flag, so the head is read again after it is set
+        if (!__atomic_load_n(&this->header->waiting, __ATOMIC_SEQ_CST))
+        {
+            __atomic_store_n(&this->header->waiting, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        p.fd=this->spacefd;
+        p.events=POLLIN;
+        if (poll(&p, 1, IPC_RING_PEER_CHECK) == 0 && !this->isPeerAlive())
+        {
+            pthread_mutex_unlock(&this->mutex);
+            throw Exception(Exception::SOCKETSEND);
+        }
+        //reset the eventfd, a signal for an earlier wait only costs one more check
+        while (read(this->spacefd, &count, sizeof(count)) == -1 && errno == EINTR);
+    }
+    if (tail % IPC_RING_SIZE + IPC_RING_RECORD(len) > IPC_RING_SIZE)
+    {
+        int64_t wrap=IPC_RING_WRAP;
+        memcpy(this->data + tail % IPC_RING_SIZE, &wrap, sizeof(int64_t));
+        tail+=IPC_RING_SIZE - tail % IPC_RING_SIZE;
+    }
+    memcpy(this->data + tail % IPC_RING_SIZE, &reclen, sizeof(int64_t));
+    memcpy(this->data + tail % IPC_RING_SIZE + sizeof(int64_t), value, len);
+    __atomic_store_n(&this->header->tail, tail + IPC_RING_RECORD(len), __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&this->mutex);
+    this->signal();
+}
+
+/** The method waits for a message and reads it from the ring.
+ * @param value The buffer for the message.
+ * @param max The size of the buffer.
+ * @return The length of the message.
+ * @throws Exception::SOCKETRECV If the ring is closed and empty or the message is longer than the buffer.
+ */
+ssize_t IpcRing::get(Octet * value, ssize_t max)
+{
+    uint64_t count, head, tail;
+    int64_t reclen;
+
+    //one count per message
+    while (read(this->eventfd, &count, sizeof(count)) == -1)
+    {
+        if (errno != EINTR)
+        {
+            throw Exception(Exception::SOCKETRECV);
+        }
+    }
+    head=this->header->head;
+    tail=__atomic_load_n(&this->header->tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+    {
+        //the count of close(), keep it for the next call
+        this->signal();
+        throw Exception(Exception::SOCKETRECV);
+    }
+    memcpy(&reclen, this->data + head % IPC_RING_SIZE, sizeof(int64_t));
+    if (reclen == IPC_RING_WRAP)
+    {
+        head+=IPC_RING_SIZE - head % IPC_RING_SIZE;
+        memcpy(&reclen, this->data, sizeof(int64_t));
+    }
+    if (reclen < 0 || reclen > max)
+    {
+        throw Exception(Exception::SOCKETRECV);
+    }
+    memcpy(value, this->data + head % IPC_RING_SIZE + sizeof(int64_t), reclen);
+    __atomic_store_n(&this->header->head, head + IPC_RING_RECORD(reclen), __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&this->header->waiting, 0, __ATOMIC_SEQ_CST))
+    {
+        this->signalSpace();
+    }
+    return reclen;
+}
+
+/** The method closes the ring for both processes. A waiting consumer
+ * gets the messages which are in the ring and then an exception, a
+ * waiting producer gets an exception.
+ */
+void IpcRing::close(void)
+{
+    if (this->header == NULL)
+    {
+        return;
+    }
+    __atomic_store_n(&this->header->closed, 1, __ATOMIC_RELEASE);
+    this->signal();
+    this->signalSpace();
+}
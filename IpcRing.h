@@ -0,0 +1,89 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+ 
+#ifndef _IPCRING_H_
+#define _IPCRING_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "Exception.h"
+
+typedef unsigned char Octet;
+
+#define IPC_RING_SIZE (1024*1024) /**<The size of the data of a ring in bytes.*/
+#define IPC_RING_PEER_CHECK 1000 /**<The time in milliseconds after which a producer which waits for space checks if the consumer is alive.*/
+
+/** The part of a ring which is shared between the processes.
+ * The positions count the bytes which were written and read, they are
+ * never wrapped. The position of a byte in the data is the count modulo
+ * IPC_RING_SIZE. The positions are on different cache lines.
+ */
+struct IpcRingHeader
+{
+    volatile uint64_t	head;		/**<The read position, only the consumer writes it.*/
+    char		pad1[56];
+    volatile uint64_t	tail;		/**<The write position, only the producer writes it.*/
+    char		pad2[56];
+    volatile int	closed;		/**<Set if the ring is closed.*/
+    volatile int	waiting;	/**<Set if the producer waits for space, the consumer signals the spacefd.*/
+};
+
+/** This class implements a ring buffer in shared memory for messages in one
+ * direction between the foreground process and a background process.
+ * The memory and an eventfd are created before the fork, so both processes use them.
+ * The producer writes a message (length and bytes) into the ring and
+ * increments the eventfd, the consumer waits on the eventfd and reads one message per
+ * count (the eventfd is a semaphore). So a message costs no copy through the kernel.
+ * The threads of one process which produce are serialized by a mutex, there is one
+ * consumer. If the ring is full the producer waits on a second eventfd, which the
+ * consumer signals after it read a message.
+ */
+class IpcRing
+{
+private:
+	IpcRingHeader * header;	/**<The shared header.*/
+	Octet * data;		/**<The shared data.*/
+	int eventfd;		/**<The eventfd, it counts the messages in the ring.*/
+	int spacefd;		/**<The eventfd which is signaled if a waiting producer has space again.*/
+	pid_t peer;		/**<The process at the other end of the ring, 0 if unknown.*/
+	pthread_mutex_t mutex;	/**<Serializes the producers of this process.*/
+	
+	void signal(void);
+	void signalSpace(void);
+	bool isPeerAlive(void);
+	
+public:
+	IpcRing();
+	~IpcRing();
+	
+	int create(void);
+	int getEventFd(void);
+	int getSpaceFd(void);
+	void setPeer(pid_t);
+	
+	void put(const Octet *, ssize_t);
+	ssize_t get(Octet *, ssize_t);
+	void close(void);
+};
+
+#endif //_IPCRING_H_
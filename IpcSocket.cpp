@@ -27,6 +27,8 @@
 IpcSocket::IpcSocket()
 {
     this->socket=-1;
+    this->sendring=NULL;
+    this->recvring=NULL;
 }
 
 /** The constructor sets the socket number.
@@ -35,10 +37,12 @@ IpcSocket::IpcSocket()
 IpcSocket::IpcSocket(int s)
 {
     this->socket=s;
+    this->sendring=NULL;
+    this->recvring=NULL;
 }
 
 /** The destructor closes the socket
- * if it is not equal -1.
+ * if it is not equal -1 and frees the rings.
  */
 IpcSocket::~IpcSocket()
 {
@@ -47,6 +51,8 @@ IpcSocket::~IpcSocket()
         close (this->socket);
     }
     this->socket=-1;
+    delete this->sendring;
+    delete this->recvring;
 }
 
 /** The method sets the socket to s.
@@ -65,59 +71,75 @@ int IpcSocket::getSocket(void)
     return this->socket;
 }
 
+/** The method sets the rings in shared memory, the messages are sent
+ * through them instead of the socket. The object frees the rings.
+ * @param send The ring for the sent messages.
+ * @param recv The ring for the received messages.
+ */
+void IpcSocket::setRings(IpcRing * send, IpcRing * recv)
+{
+    this->sendring=send;
+    this->recvring=recv;
+}
 
-/**The method sends a string via the
- * socket. First the length of the string is sent
- * and then the string itself.
- * @param str The string to send.
- * @throws Exception::SOCKETSEND if the length or the string could not send
- * correctly.
+/** The method checks if a file descriptor is used by the object.
+ * @param fd The file descriptor.
+ * @return True if fd is the socket or an eventfd of the rings.
  */
-void IpcSocket::send(string str)
+bool IpcSocket::usesFd(int fd)
 {
-    ssize_t len = str.size();
-    ssize_t size=0;
-    //send the length of the string
-        size = write(this->socket, &len, sizeof(ssize_t));
-    if (size != sizeof(ssize_t))
+    return fd == this->socket ||
+           (this->sendring != NULL && (fd == this->sendring->getEventFd() || fd == this->sendring->getSpaceFd())) ||
+           (this->recvring != NULL && (fd == this->recvring->getEventFd() || fd == this->recvring->getSpaceFd()));
+}
+
+/** The method returns the file descriptor which is readable if
+ * a message is waiting, e.g. for select().
+ * @return The socket or the eventfd of the ring for the received messages.
+ */
+int IpcSocket::getReadFd(void)
+{
+    if (this->recvring != NULL)
     {
-        throw Exception(Exception::SOCKETSEND);
+        return this->recvring->getEventFd();
+    }
+    return this->socket;
+}
+
+/** The method shuts down the communication in both directions. A thread
+ * which waits for a message gets an exception, the other process too.
+ */
+void IpcSocket::shutdown(void)
+{
+    if (this->sendring != NULL)
+    {
+        this->sendring->close();
+    }
+    if (this->recvring != NULL)
+    {
+        this->recvring->close();
     }
-        if(len > 0)
-        {
-          //send the string
-          size = write(this->socket, str.c_str(), len);
-          if (size != len)
-          {
-            throw Exception(Exception::SOCKETSEND);
-          }
-        }
+    ::shutdown(this->socket, SHUT_RDWR);
 }
 
-/**The method sends a buffer via the
- * socket. First the length of the buffer is sent
- * and then the buffer itself.
- * @param value The buffer to send.
- * @throws Exception::SOCKETSEND if the length or the buffer could not send
+
+/**The method sends a message via the socket. The message
+ * is sent as one datagram.
+ * @param msg The message to send.
+ * @throws Exception::SOCKETSEND if the message could not send
  * correctly.
  */
-void IpcSocket::send(Octet * value, ssize_t len)
+void IpcSocket::send(IpcMessage &msg)
 {
-    ssize_t size=0;
-    //send the length of the string
-    size = write (this->socket, &len, sizeof(ssize_t));
-    if (size != sizeof(ssize_t))
+    if (this->sendring != NULL)
     {
-        throw Exception(Exception::SOCKETSEND);
+        this->sendring->put(msg.getBuffer(), msg.getLength());
+        return;
     }
-        if (len > 0)
+    const ssize_t size = ::send(this->socket, msg.getBuffer(), msg.getLength(), 0);
+    if (size != msg.getLength())
     {
-        //send the buffer
-        size = write (this->socket, value, len);
-        if (size != len)
-        {
-            throw Exception(Exception::SOCKETSEND);
-        }
+        throw Exception(Exception::SOCKETSEND);
     }
 }
 
@@ -129,6 +151,13 @@ void IpcSocket::send(Octet * value, ssize_t len)
  */
 void IpcSocket::send(int num)
 {
+    if (this->sendring != NULL)
+    {
+        IpcMessage msg;
+        msg.add(num);
+        this->send(msg);
+        return;
+    }
 
     const ssize_t size = write (this->socket, &num, sizeof(int));
     if (size != sizeof(int))
@@ -148,6 +177,12 @@ int IpcSocket::recvInt(void)
 {
     int num;
     ssize_t size;
+    if (this->recvring != NULL)
+    {
+        IpcMessage msg;
+        this->recv(msg);
+        return msg.getInt();
+    }
         size = read(this->socket, &num, sizeof(int));
     if (size != sizeof(int))
     {
@@ -159,82 +194,33 @@ int IpcSocket::recvInt(void)
 
 
 
-/**The method receives a string from the socket.
- * First it receives the length, then
- * creates a buffer with the length and writes
- * the bytes from the socket into the buffer.
- * The buffer is copied in a string and the string is returned.
- * @return string : A string with the received value.
- * @throws Exception::SOCKETRECV If the received length
- * of the integer for the length or the length of the received string is wrong.
+/**The method receives a message from the socket. The
+ * fields are read from the message afterwards.
+ * @param msg The message, the received datagram is written into it.
+ * @throws Exception::SOCKETRECV If nothing could be received or the
+ * datagram is longer than IPC_MESSAGE_MAX.
  */
-string IpcSocket::recvStr(void)
+void IpcSocket::recv(IpcMessage &msg)
 {
-    ssize_t len;
-    char * buffer;
+    struct msghdr hdr;
+    struct iovec iov;
     ssize_t size;
-    string str;
-    size = read(this->socket,&len,sizeof(ssize_t));
-    if (size!=sizeof(ssize_t))
+
+    if (this->recvring != NULL)
     {
-      throw Exception(Exception::SOCKETRECV);
+        msg.setLength(this->recvring->get(msg.getBuffer(), IPC_MESSAGE_MAX));
+        return;
     }
-        if(len > 0)
-        {
-          try{
-        buffer=new char[len+1];
-      }
-      catch(...)
-      {
-        cerr << "RADIUS-PLUGIN: BACKGROUND ACCT: New failed for buffer in IpcSocket::recvStr." << endl;
-        return "";
-      }
-          memset (buffer, 0, len+1);
-          size = read (this->socket, buffer, len);
-          if (size!=len)
-          {
-            throw Exception(Exception::SOCKETRECV);
-          }
-          str=buffer;
-          delete [] buffer;
-        }
-    return str;
-}
 
-/**The method receives a buffer from the socket.
- * First it receives the length, then
- * creates a buffer with the length and writes
- * the bytes from the socket into the buffer.
- * @return unsigned int : Length of the buffer.
- * @throws Exception::SOCKETRECV If the received length
- * of the integer for the length or the length of the received buffer is wrong.
- */
-void IpcSocket::recvBuf(User * user)
-{
-    ssize_t len;
-        ssize_t size;
-    size = read (this->socket,&len,sizeof(ssize_t));
-    if (size!=sizeof(ssize_t))
+    iov.iov_base=msg.getBuffer();
+    iov.iov_len=IPC_MESSAGE_MAX;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov=&iov;
+    hdr.msg_iovlen=1;
+    size = recvmsg(this->socket, &hdr, 0);
+    if (size <= 0 || (hdr.msg_flags & MSG_TRUNC))
     {
         throw Exception(Exception::SOCKETRECV);
     }
-    user->setVsaBufLen(len);
-    if (len > 0)
-    {
-      try{
-        user->setVsaBuf(new Octet[len]);
-      }
-      catch(...)
-      {
-        cerr  << "RADIUS-PLUGIN: BACKGROUND ACCT: New failed for buffer in IpcSocket::recvBuf." << endl;
-      }
-        size = read (this->socket, user->getVsaBuf(), len);
-        if (size != len)
-        {
-
-                  throw Exception(Exception::SOCKETRECV);
-        }
-    }
-
+    msg.setLength(size);
 }
-
@@ -25,7 +25,8 @@
 //#include "radiusplugin.h"
 #include <string>
 #include <cstring>
-#include "User.h"
+#include "IpcMessage.h"
+#include "IpcRing.h"
 #include "Exception.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -33,20 +34,23 @@
 #include <unistd.h>
 
 
-typedef unsigned char Octet;
-
 /** This class implements the inter process communication
- * in this software. Different datatypes can the send over the
- * socket: string, int , code (8 bit int). 
- * For the strings additional the length is sent before the string
- * is sent itself. So you don't need to know the length, if you receive
- * a string.
+ * in this software. A command or a response is sent as one
+ * IpcMessage, which is one datagram on the socket. So one system
+ * call is needed per command on each side.
+ * A single integer can be sent without a message, it is received
+ * as a message with one integer too.
+ * Optionally the messages are sent through two rings in shared memory
+ * (one per direction) instead of the socket, the socket is kept to
+ * see if the background process is running.
  */
 
 class IpcSocket
 {
 private:
 	int socket;		/**The socket number.*/
+	IpcRing * sendring;	/**The ring for the sent messages, NULL if the socket is used.*/
+	IpcRing * recvring;	/**The ring for the received messages, NULL if the socket is used.*/
 	
 public:
 	IpcSocket();
@@ -55,18 +59,18 @@ public:
 	
 	int getSocket(void);
 	void setSocket(int);
-	
-	void send(string);
+	void setRings(IpcRing *, IpcRing *);
+	bool usesFd(int);
+	int getReadFd(void);
+	void shutdown(void);
 	
 	void send(int);
 	
-	void send(Octet *, ssize_t);
+	void send(IpcMessage &);
 	
 	int recvInt(void);
 	
-	string recvStr(void);
-	
-	void recvBuf(User *);
+	void recv(IpcMessage &);
 	
 };
 
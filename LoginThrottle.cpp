@@ -0,0 +1,180 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+#include "LoginThrottle.h"
+
+/** The constructor. The throttle is disabled until the limits are set.*/
+LoginThrottle::LoginThrottle(void)
+{
+    this->maxattempts=0;
+    this->window=60;
+    this->cooldown=300;
+    this->lastpurge=0;
+    pthread_mutex_init(&this->mutex, NULL);
+}
+
+/** The destructor clears the entries.*/
+LoginThrottle::~LoginThrottle(void)
+{
+    this->users.clear();
+    this->sources.clear();
+    pthread_mutex_destroy(&this->mutex);
+}
+
+/** The method sets the limits of the throttle.
+ * @param maxattempts The number of failures in the window which block, 0 disables the throttle.
+ * @param window The length of the window in seconds.
+ * @param cooldown The time in seconds a username or source address is blocked.
+ */
+void LoginThrottle::setLimits(int maxattempts, int window, int cooldown)
+{
+    this->maxattempts=maxattempts;
+    this->window=window;
+    this->cooldown=cooldown;
+}
+
+/** The method checks if the logins of a username or a source address are blocked.
+ * @param username The username.
+ * @param source The source address of the client.
+ * @return True if the username or the source address is blocked.
+ */
+bool LoginThrottle::isBlocked(const string &username, const string &source)
+{
+    bool blocked;
+    time_t now;
+
+    if (this->maxattempts <= 0)
+    {
+        return false;
+    }
+    now=time(NULL);
+    pthread_mutex_lock(&this->mutex);
+    blocked = this->isBlocked(this->users, username, now) || this->isBlocked(this->sources, source, now);
+    pthread_mutex_unlock(&this->mutex);
+    return blocked;
+}
+
+/** The method saves a failed login for the username and the source address.
+ * @param username The username.
+ * @param source The source address of the client.
+ */
+void LoginThrottle::addFailure(const string &username, const string &source)
+{
+    time_t now;
+
+    if (this->maxattempts <= 0)
+    {
+        return;
+    }
+    now=time(NULL);
+    pthread_mutex_lock(&this->mutex);
+    //remove the entries without failures in the window from time to time
+    if (now - this->lastpurge >= this->window)
+    {
+        this->purge(this->users, now);
+        this->purge(this->sources, now);
+        this->lastpurge=now;
+    }
+    this->addFailure(this->users, username, now);
+    this->addFailure(this->sources, source, now);
+    pthread_mutex_unlock(&this->mutex);
+}
+
+/** The method removes the failures of a username after a successful login.
+ * The failures of the source address are kept, other users can be behind the same address.
+ * @param username The username.
+ */
+void LoginThrottle::addSuccess(const string &username)
+{
+    if (this->maxattempts <= 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&this->mutex);
+    this->users.erase(username);
+    pthread_mutex_unlock(&this->mutex);
+}
+
+/** The method checks if a key is blocked, the mutex must be locked.
+ * @param entries The entries.
+ * @param key The username or the source address.
+ * @param now The current time.
+ * @return True if the key is blocked.
+ */
+bool LoginThrottle::isBlocked(map<string, LoginThrottleEntry> &entries, const string &key, time_t now)
+{
+    map<string, LoginThrottleEntry>::iterator iter=entries.find(key);
+    if (iter == entries.end())
+    {
+        return false;
+    }
+    return iter->second.blockeduntil > now;
+}
+
+/** The method saves a failure of a key, the mutex must be locked. The failures
+ * older than the window are removed, if the limit is reached the key is blocked.
+ * @param entries The entries.
+ * @param key The username or the source address.
+ * @param now The current time.
+ */
+void LoginThrottle::addFailure(map<string, LoginThrottleEntry> &entries, const string &key, time_t now)
+{
+    map<string, LoginThrottleEntry>::iterator iter=entries.find(key);
+    if (iter == entries.end())
+    {
+        LoginThrottleEntry entry;
+        entry.blockeduntil=0;
+        iter=entries.insert(make_pair(key, entry)).first;
+    }
+    LoginThrottleEntry &entry=iter->second;
+    while (!entry.failures.empty() && entry.failures.front() <= now - this->window)
+    {
+        entry.failures.pop_front();
+    }
+    entry.failures.push_back(now);
+    if ((int) entry.failures.size() >= this->maxattempts)
+    {
+        entry.blockeduntil=now + this->cooldown;
+        entry.failures.clear();
+    }
+}
+
+/** The method removes the keys which are not blocked and have no failures in the window,
+ * the mutex must be locked.
+ * @param entries The entries.
+ * @param now The current time.
+ */
+void LoginThrottle::purge(map<string, LoginThrottleEntry> &entries, time_t now)
+{
+    map<string, LoginThrottleEntry>::iterator iter=entries.begin();
+    while (iter != entries.end())
+    {
+        if (iter->second.blockeduntil <= now &&
+            (iter->second.failures.empty() || iter->second.failures.back() <= now - this->window))
+        {
+            entries.erase(iter++);
+        }
+        else
+        {
+            iter++;
+        }
+    }
+}
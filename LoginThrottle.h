@@ -0,0 +1,74 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+#ifndef _LOGINTHROTTLE_H_
+#define _LOGINTHROTTLE_H_
+#include <time.h>
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <string>
+
+using std::deque;
+using std::map;
+using std::string;
+
+/** The failed logins of a username or a source address.*/
+struct LoginThrottleEntry
+{
+    deque<time_t> failures;     /**<The times of the failed logins in the window.*/
+    time_t blockeduntil;        /**<The time until the logins are rejected, 0 if they are not blocked.*/
+};
+
+/** The class tracks failed logins in the foreground process by username and
+ * by source address (untrusted_ip). If there are too many failures in a sliding
+ * window the username or the source address is blocked for a cool down period. The
+ * logins of a blocked username or source address are rejected without asking the radius
+ * server, so a brute force attack doesn't use up the capacity of the radius server and the
+ * auth background process.
+ */
+class LoginThrottle
+{
+private:
+    map<string, LoginThrottleEntry> users;      /**<The failures by username.*/
+    map<string, LoginThrottleEntry> sources;    /**<The failures by source address.*/
+    int maxattempts;                            /**<The number of failures in the window which block, 0 disables the throttle.*/
+    int window;                                 /**<The length of the window in seconds.*/
+    int cooldown;                               /**<The time in seconds a username or source address is blocked.*/
+    time_t lastpurge;                           /**<The time of the last purge of old entries.*/
+    pthread_mutex_t mutex;                      /**<Protects the entries.*/
+
+    bool isBlocked(map<string, LoginThrottleEntry> &, const string &, time_t);
+    void addFailure(map<string, LoginThrottleEntry> &, const string &, time_t);
+    void purge(map<string, LoginThrottleEntry> &, time_t);
+
+public:
+    LoginThrottle(void);
+    ~LoginThrottle(void);
+
+    void setLimits(int, int, int);
+
+    bool isBlocked(const string &, const string &);
+    void addFailure(const string &, const string &);
+    void addSuccess(const string &);
+};
+
+#endif //_LOGINTHROTTLE_H_
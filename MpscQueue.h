@@ -0,0 +1,172 @@
+/*
+ *  radiusplugin -- An OpenVPN plugin for do radius authentication 
+ *					and accounting.
+ * 
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+ 
+ 
+#ifndef _MPSCQUEUE_H_
+#define _MPSCQUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/** This class implements a bounded lock-free queue with many producers and
+ * one consumer. Every slot has a sequence number: a producer reserves a position with
+ * a compare and swap and publishes the element with the sequence number, the
+ * consumer takes the element if the sequence number shows that it is published.
+ * So no thread waits on a mutex which is held by another thread.
+ * The consumer sleeps on an eventfd if the queue is empty, the producers
+ * wake it up.
+ */
+template <class T>
+class MpscQueue
+{
+private:
+	/** A slot of the queue.*/
+	struct Slot
+	{
+		size_t	sequence;	/**<The position the slot is free for (sequence == position) or published at (sequence == position+1).*/
+		T	element;	/**<The element.*/
+	};
+	
+	Slot *		slots;			/**<The slots, the number is a power of 2.*/
+	size_t		mask;			/**<The number of slots - 1.*/
+	char		pad1[64];
+	size_t		enqueuepos;		/**<The next position for a producer.*/
+	char		pad2[64];
+	size_t		dequeuepos;		/**<The next position for the consumer.*/
+	int		eventfd;		/**<Wakes up the consumer.*/
+	
+	MpscQueue(const MpscQueue &);
+	MpscQueue & operator=(const MpscQueue &);
+	
+public:
+	/** The constructor creates the slots and the eventfd.
+	 * @param size The number of slots, it is rounded up to a power of 2.
+	 */
+	MpscQueue(size_t size)
+	{
+		size_t n=2;
+		while (n < size) n<<=1;
+		this->slots=new Slot[n];
+		this->mask=n-1;
+		for (size_t i=0; i<n; i++)
+		{
+			this->slots[i].sequence=i;
+		}
+		this->enqueuepos=0;
+		this->dequeuepos=0;
+		this->eventfd=::eventfd(0, EFD_CLOEXEC);
+	}
+	
+	/** The destructor frees the slots and closes the eventfd.*/
+	~MpscQueue()
+	{
+		delete [] this->slots;
+		if (this->eventfd != -1)
+		{
+			::close(this->eventfd);
+		}
+	}
+	
+	/** The method adds an element and wakes up the consumer.
+	 * It can be called by many threads at the same time.
+	 * @param element The element.
+	 * @return False if the queue is full.
+	 */
+	bool push(const T &element)
+	{
+		Slot * slot;
+		size_t pos=__atomic_load_n(&this->enqueuepos, __ATOMIC_RELAXED);
+		while (1)
+		{
+			slot=&this->slots[pos & this->mask];
+			intptr_t diff=(intptr_t) __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (intptr_t) pos;
+			if (diff == 0)
+			{
+				if (__atomic_compare_exchange_n(&this->enqueuepos, &pos, pos+1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				//the consumer didn't take the element of the last round
+				return false;
+			}
+			else
+			{
+				pos=__atomic_load_n(&this->enqueuepos, __ATOMIC_RELAXED);
+			}
+		}
+		slot->element=element;
+		__atomic_store_n(&slot->sequence, pos+1, __ATOMIC_RELEASE);
+		this->wake();
+		return true;
+	}
+	
+	/** The method takes the next element, it must be called only by the consumer.
+	 * @param element The element is written into it.
+	 * @return False if the queue is empty.
+	 */
+	bool pop(T &element)
+	{
+		Slot * slot=&this->slots[this->dequeuepos & this->mask];
+		if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != this->dequeuepos+1)
+		{
+			return false;
+		}
+		element=slot->element;
+		__atomic_store_n(&slot->sequence, this->dequeuepos + this->mask + 1, __ATOMIC_RELEASE);
+		__atomic_store_n(&this->dequeuepos, this->dequeuepos+1, __ATOMIC_RELEASE);
+		return true;
+	}
+	
+	/** The method waits until a producer or wake() wakes up the consumer. It
+	 * returns at once if there was a wakeup since the last call.
+	 */
+	void wait(void)
+	{
+		uint64_t count;
+		while (read(this->eventfd, &count, sizeof(count)) == -1 && errno == EINTR);
+	}
+	
+	/** The method wakes up the consumer.*/
+	void wake(void)
+	{
+		uint64_t one=1;
+		while (write(this->eventfd, &one, sizeof(one)) == -1 && errno == EINTR);
+	}
+	
+	/** The method returns the number of elements in the queue. The value is
+	 * exact only if no thread uses the queue at the same time.
+	 * @return The number of elements.
+	 */
+	size_t depth(void)
+	{
+		size_t enqueue=__atomic_load_n(&this->enqueuepos, __ATOMIC_RELAXED);
+		size_t dequeue=__atomic_load_n(&this->dequeuepos, __ATOMIC_RELAXED);
+		return enqueue > dequeue ? enqueue - dequeue : 0;
+	}
+};
+
+#endif //_MPSCQUEUE_H_
@@ -20,12 +20,13 @@
  */
 
 #include "PluginContext.h"
+#include "radiusplugin.h"
 
 
 
 /** The constructor. All sockets all set to -1, the process ids and the
  * verbosity level are set to 0. The session id is set to to 1.*/
-PluginContext::PluginContext()
+PluginContext::PluginContext() : newusers(NEW_USER_QUEUE_SIZE)
 {
 
     this->authsocketforegr.setSocket(-1);
@@ -38,9 +39,22 @@ PluginContext::PluginContext()
 
     this->verb=0;
     this->sessionid=1;
+    this->requestid=0;
 
         this->stopthread=false;
     this->startthread=true;
+
+    //the user map is used by the OpenVPN thread and the auth threads,
+    //a thread which holds the mutex can call the methods of the map again
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&this->mutexusers, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    this->acctstopped=false;
+    pthread_mutex_init(&this->mutexacct, NULL);
+    pthread_cond_init(&this->condacct, NULL);
 }
 
 /** The destructor clears the users and nasportlist.*/
@@ -48,6 +62,9 @@ PluginContext::~PluginContext()
 {
     this->users.clear();
     this->nasportlist.clear();
+    pthread_mutex_destroy(&this->mutexusers);
+    pthread_mutex_destroy(&this->mutexacct);
+    pthread_cond_destroy(&this->condacct);
 
 }
 
@@ -59,6 +76,7 @@ int PluginContext::addNasPort(void)
     int newport=0;
     list<int>::iterator i;
     list<int>::iterator j;
+    pthread_mutex_lock(&this->mutexusers);
     i=nasportlist.begin();
     j=nasportlist.end();
 
@@ -86,6 +104,7 @@ int PluginContext::addNasPort(void)
         }
         this->nasportlist.insert(j, newport);
     }
+    pthread_mutex_unlock(&this->mutexusers);
     return newport;
 }
 
@@ -94,7 +113,9 @@ int PluginContext::addNasPort(void)
  */
 void PluginContext::delNasPort(int num)
 {
+    pthread_mutex_lock(&this->mutexusers);
     this->nasportlist.remove(num);
+    pthread_mutex_unlock(&this->mutexusers);
 }
 
 /**The method adds an user to the user map of the foreground
@@ -106,22 +127,28 @@ void PluginContext::addUser(UserPlugin * newuser)
 {
     pair<map<string,UserPlugin *>::iterator,bool> success;
 
+    pthread_mutex_lock(&this->mutexusers);
     success = users.insert(make_pair(newuser->getKey(), newuser));
+    if (success.second) {
+      ++this->sessionid;
+    }
+    pthread_mutex_unlock(&this->mutexusers);
     if(!success.second) {
       delete newuser;
       throw Exception(Exception::ALREADYAUTHENTICATED);
     }
-    else {
-      ++this->sessionid;
-    }
 }
 
 /**The method deletes the user from the map with the key.
+ * The cached authentication of the user is removed too.
  * @param key The key of the user.
  */
 void PluginContext::delUser(string key)
 {
+    pthread_mutex_lock(&this->mutexusers);
     users.erase(key);
+    pthread_mutex_unlock(&this->mutexusers);
+    this->authcache.remove(key);
 }
 
 /**The method finds a user in the user map.
@@ -130,11 +157,14 @@ void PluginContext::delUser(string key)
  */
 UserPlugin * PluginContext::findUser(const std::string &key)
 {
+    UserPlugin * user=NULL;
+    pthread_mutex_lock(&this->mutexusers);
     map<string,UserPlugin *>::iterator iter =  users.find(key);
     if (iter != users.end()) {
-        return iter->second;
+        user=iter->second;
     }
-    return NULL;
+    pthread_mutex_unlock(&this->mutexusers);
+    return user;
 }
 
 
@@ -200,51 +230,164 @@ int PluginContext::getSessionId(void)
 }
 
 
-/**The method adds an new user to the user list of users waiting for authentication
+/** The method returns a new request id for a command to a background
+ * process. The background processes tag their responses with the id.
+ * @returns The request id.
+ */
+int PluginContext::newRequestId(void)
+{
+    return __sync_add_and_fetch(&this->requestid, 1);
+}
+
+
+/**The method adds an new user to the queue of users waiting for authentication
+ * and wakes up the auth thread. It doesn't lock a mutex.
  * @param newuser A pointer to the user.
+ * @return False if the queue is full.
  */
-void PluginContext::addNewUser(UserPlugin * newuser)
+bool PluginContext::addNewUser(UserPlugin * newuser)
 {
-  this->newusers.push_back(newuser);
+  return this->newusers.push(newuser);
 }
 
-/**The method return the first element in the list of waiting users.
+/**The method returns the first user of the queue of waiting users. If the queue is empty
+ * it waits for a user. It is called only by the auth thread.
+ * @return The user, NULL if the thread should stop.
  */
 UserPlugin * PluginContext::getNewUser()
 {
-  if(this->newusers.empty()) {
-    return NULL;
+  UserPlugin * user = NULL;
+  while (!this->newusers.pop(user))
+  {
+    if (this->getStopThread())
+    {
+      return NULL;
+    }
+    this->newusers.wait();
   }
-  UserPlugin * user = this->newusers.front();
-  this->newusers.pop_front();
   return user;
 }
 
-pthread_cond_t  * PluginContext::getCondSend(void )
+/**The method returns the number of users waiting for authentication.
+ * @return The number of users.
+ */
+size_t PluginContext::getNewUserDepth(void)
 {
-  return &condsend;
+  return this->newusers.depth();
 }
+
 pthread_cond_t  * PluginContext::getCondRecv(void )
 {
   return &condrecv;
 }
 
-pthread_mutex_t * PluginContext::getMutexSend(void )
-{
-  return &mutexsend;
-}
-
 pthread_mutex_t * PluginContext::getMutexRecv(void )
 {
   return &mutexrecv;
 }
 
 
+pthread_mutex_t * PluginContext::getMutexUsers(void )
+{
+  return &mutexusers;
+}
+
 pthread_t * PluginContext::getThread()
 {
   return &thread;
 }
 
+pthread_t * PluginContext::getRecvThread()
+{
+  return &recvthread;
+}
+
+/** The method saves a verification which was sent to the auth background process.
+ * @param id The request id of the verification.
+ * @param pending The verification.
+ */
+void PluginContext::addPendingAuth(int id, const PendingAuth &pending)
+{
+  pthread_mutex_lock(&this->mutexusers);
+  this->pendingauths[id]=pending;
+  pthread_mutex_unlock(&this->mutexusers);
+}
+
+/** The method removes a verification from the pending verifications.
+ * @param id The request id of the verification.
+ * @param pending The verification is written into it.
+ * @return False if there is no verification with the request id.
+ */
+bool PluginContext::takePendingAuth(int id, PendingAuth * pending)
+{
+  bool found=false;
+  pthread_mutex_lock(&this->mutexusers);
+  map<int, PendingAuth>::iterator iter=this->pendingauths.find(id);
+  if (iter != this->pendingauths.end())
+  {
+    *pending=iter->second;
+    this->pendingauths.erase(iter);
+    found=true;
+  }
+  pthread_mutex_unlock(&this->mutexusers);
+  return found;
+}
+
+/** The method removes the oldest verification from the pending verifications.
+ * @param pending The verification is written into it.
+ * @return False if there is no pending verification.
+ */
+bool PluginContext::takeNextPendingAuth(PendingAuth * pending)
+{
+  bool found=false;
+  pthread_mutex_lock(&this->mutexusers);
+  if (!this->pendingauths.empty())
+  {
+    *pending=this->pendingauths.begin()->second;
+    this->pendingauths.erase(this->pendingauths.begin());
+    found=true;
+  }
+  pthread_mutex_unlock(&this->mutexusers);
+  return found;
+}
+
+/** The method checks if a verification for the user is pending.
+ * @param user The user.
+ * @return True if a verification is pending.
+ */
+bool PluginContext::isPendingAuth(UserPlugin * user)
+{
+  bool found=false;
+  pthread_mutex_lock(&this->mutexusers);
+  for (map<int, PendingAuth>::iterator iter=this->pendingauths.begin(); iter != this->pendingauths.end(); iter++)
+  {
+    if (iter->second.user==user)
+    {
+      found=true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&this->mutexusers);
+  return found;
+}
+
+/** The method detaches the pending verifications from a user which is removed,
+ * the responses are dropped.
+ * @param user The user.
+ */
+void PluginContext::cancelPendingAuths(UserPlugin * user)
+{
+  pthread_mutex_lock(&this->mutexusers);
+  for (map<int, PendingAuth>::iterator iter=this->pendingauths.begin(); iter != this->pendingauths.end(); iter++)
+  {
+    if (iter->second.user==user)
+    {
+      iter->second.user=NULL;
+    }
+  }
+  pthread_mutex_unlock(&this->mutexusers);
+}
+
 int PluginContext::getResult()
 {
   return result;
@@ -255,21 +398,124 @@ void PluginContext::setResult(int r)
   result=r;
 }
 
-bool PluginContext::UserWaitingtoAuth()
+pthread_t * PluginContext::getAcctRecvThread()
+{
+  return &acctrecvthread;
+}
+
+/** The method saves a command which was sent to the acct background process.
+ * @param id The request id of the command.
+ * @param key The key of the user.
+ * @param deferredfile The client_connect_deferred_file for the result, empty if a thread waits for the result.
+ * @param detached True if nobody waits for the result, it is only logged.
+ */
+void PluginContext::addPendingAcct(int id, const string &key, const string &deferredfile, bool detached)
+{
+  PendingAcct pending;
+  pending.key=key;
+  pending.deferredfile=deferredfile;
+  pending.detached=detached;
+  pthread_mutex_lock(&this->mutexacct);
+  this->pendingaccts[id]=pending;
+  pthread_mutex_unlock(&this->mutexacct);
+}
+
+/** The method removes a command from the pending commands.
+ * @param id The request id of the command.
+ * @param pending The command is written into it.
+ * @return False if there is no command with the request id.
+ */
+bool PluginContext::takePendingAcct(int id, PendingAcct * pending)
+{
+  bool found=false;
+  pthread_mutex_lock(&this->mutexacct);
+  map<int, PendingAcct>::iterator iter=this->pendingaccts.find(id);
+  if (iter != this->pendingaccts.end())
+  {
+    *pending=iter->second;
+    this->pendingaccts.erase(iter);
+    found=true;
+  }
+  pthread_mutex_unlock(&this->mutexacct);
+  return found;
+}
+
+/** The method removes the oldest command from the pending commands.
+ * @param pending The command is written into it.
+ * @return False if there is no pending command.
+ */
+bool PluginContext::takeNextPendingAcct(PendingAcct * pending)
+{
+  bool found=false;
+  pthread_mutex_lock(&this->mutexacct);
+  if (!this->pendingaccts.empty())
+  {
+    *pending=this->pendingaccts.begin()->second;
+    this->pendingaccts.erase(this->pendingaccts.begin());
+    found=true;
+  }
+  pthread_mutex_unlock(&this->mutexacct);
+  return found;
+}
+
+/** The method saves the response for a thread which waits in waitAcctResult().
+ * @param id The request id of the command.
+ * @param status The response from the acct background process.
+ */
+void PluginContext::setAcctResult(int id, int status)
+{
+  pthread_mutex_lock(&this->mutexacct);
+  this->acctresults[id]=status;
+  pthread_cond_broadcast(&this->condacct);
+  pthread_mutex_unlock(&this->mutexacct);
+}
+
+/** The method waits for the response of the acct background process to a command.
+ * @param id The request id of the command.
+ * @return The response, RESPONSE_FAILED if there will be no response.
+ */
+int PluginContext::waitAcctResult(int id)
 {
-  if (this->newusers.size()>0) return true;
-  else return false;
+  int status=RESPONSE_FAILED;
+  pthread_mutex_lock(&this->mutexacct);
+  while (this->acctresults.find(id) == this->acctresults.end() && this->acctstopped == false)
+  {
+    pthread_cond_wait(&this->condacct, &this->mutexacct);
+  }
+  map<int, int>::iterator iter=this->acctresults.find(id);
+  if (iter != this->acctresults.end())
+  {
+    status=iter->second;
+    this->acctresults.erase(iter);
+  }
+  this->pendingaccts.erase(id);
+  pthread_mutex_unlock(&this->mutexacct);
+  return status;
 }
 
+/** The method wakes up all threads which wait for a response of the
+ * acct background process, there will be no more responses.
+ */
+void PluginContext::stopAcctResults(void)
+{
+  pthread_mutex_lock(&this->mutexacct);
+  this->acctstopped=true;
+  pthread_cond_broadcast(&this->condacct);
+  pthread_mutex_unlock(&this->mutexacct);
+}
 
 bool PluginContext::getStopThread()
 {
-  return stopthread;
+  return __atomic_load_n(&this->stopthread, __ATOMIC_ACQUIRE);
 }
 
+/** The method sets the stop flag of the auth thread and wakes it up.
+ * @param s True if the thread should stop.
+ */
 void PluginContext::setStopThread(bool s)
 {
-  stopthread=s;
+  __atomic_store_n(&this->stopthread, s, __ATOMIC_RELEASE);
+  this->newusers.wake();
 }
 
 
@@ -23,6 +23,10 @@
 #define _CONTEXT_H_
 #include "UserPlugin.h"
 #include "RadiusClass/RadiusConfig.h"
+#include "RadiusClass/RadiusClient.h"
+#include "AuthCache.h"
+#include "LoginThrottle.h"
+#include "MpscQueue.h"
 #include "UserPlugin.h"
 #include "IpcSocket.h"
 #include "Config.h"
@@ -41,6 +45,28 @@ using std::list;
 
 using namespace std;
 
+#define NEW_USER_QUEUE_SIZE 4096 /**<The number of users which can wait for authentication.*/
+
+
+/** A verification which was sent to the authentication background process
+ * and waits for the response.*/
+struct PendingAuth
+{
+    UserPlugin * user;              /**< The user, NULL if the user was removed in the meantime.*/
+    string authcontrolfile;         /**< The auth control file for the result, empty if OpenVPN waits for the result.*/
+    string digest;                  /**< The digest of username and password for the authentication cache.*/
+    string username;                /**< The username, for the login throttle.*/
+    string source;                  /**< The source address of the client, for the login throttle.*/
+};
+
+/** A command which was sent to the accounting background process
+ * and waits for the response.*/
+struct PendingAcct
+{
+    string key;                     /**< The key of the user.*/
+    string deferredfile;            /**< The client_connect_deferred_file for the result, empty if a thread waits for the result.*/
+    bool detached;                  /**< True if nobody waits for the response, it is only logged.*/
+};
 
 /** This class saves all information for the different processes and
  * it saves the users for the foreground process.*/
@@ -55,18 +81,28 @@ private:
     int verb;                       /**< Verbosity level of OpenVPN. */
 
     map<string, UserPlugin *> users;    /**< The user list of the plugin in for the foreground process which are authenticated.*/
-    list< UserPlugin *> newusers;           /**< The user list of the plugin in for the foreground process which are waiting for authentication.*/
+    MpscQueue<UserPlugin *> newusers;   /**< The users of the plugin in for the foreground process which are waiting for authentication.*/
 
         list <int> nasportlist;         /**< The port list. Every user gets an unipue port on connect. The number is deleted if the user disconnects, a new user can
                                     get the number again. This is important for dynamic IP address assignment via the radius server.*/
 
     int sessionid;                  /**< Every user gets a new session id. The session is never decremented.*/
 
-        pthread_cond_t condsend;
-        pthread_mutex_t mutexsend;
+    int requestid;                  /**< The id of the last request to a background process, the responses carry the id.*/
+
+    map<int, PendingAuth> pendingauths; /**< The verifications which wait for a response from the auth background process, by request id.*/
+    map<int, PendingAcct> pendingaccts; /**< The commands which wait for a response from the acct background process, by request id.*/
+    map<int, int> acctresults;      /**< The responses from the acct background process for waiting threads, by request id.*/
+    bool acctstopped;               /**< True if no more responses come from the acct background process.*/
+
         pthread_cond_t condrecv;
         pthread_mutex_t mutexrecv;
+        pthread_mutex_t mutexusers;
         pthread_t thread;
+        pthread_t recvthread;
+        pthread_mutex_t mutexacct;
+        pthread_cond_t condacct;
+        pthread_t acctrecvthread;
         bool stopthread;
         bool startthread;
         int result;
@@ -81,6 +117,9 @@ public:
 
     RadiusConfig radiusconf;        /**< The object saves the radius configuration from the config file.*/
     Config      conf;               /**< The object saves the configuration from the config file.*/
+    RadiusClient radiusclient;      /**< The radius client of a background process, it sends the packets to the radius servers.*/
+    AuthCache   authcache;          /**< The cache of successful authentications for renegotiations.*/
+    LoginThrottle loginthrottle;    /**< The tracker of failed logins.*/
 
     PluginContext(void);
     ~PluginContext(void);
@@ -105,18 +144,37 @@ public:
 
     int getSessionId(void);
 
-    pthread_cond_t * getCondSend(void);
+    int newRequestId(void);
+
         //void setCond(pthread_cond_t);
         pthread_cond_t * getCondRecv(void);
 
-        pthread_mutex_t * getMutexSend(void);
         pthread_mutex_t * getMutexRecv(void);
         //void setMutex(pthread_mutex_t);
 
         UserPlugin * getNewUser();
-        void addNewUser(UserPlugin * newuser);
+        bool addNewUser(UserPlugin * newuser);
+        size_t getNewUserDepth(void);
+
+        pthread_mutex_t * getMutexUsers(void);
 
         pthread_t * getThread();
+        pthread_t * getRecvThread();
+
+        void addPendingAuth(int, const PendingAuth &);
+        bool takePendingAuth(int, PendingAuth *);
+        bool takeNextPendingAuth(PendingAuth *);
+        bool isPendingAuth(UserPlugin *);
+        void cancelPendingAuths(UserPlugin *);
+
+        pthread_t * getAcctRecvThread();
+
+        void addPendingAcct(int, const string &, const string &, bool detached=false);
+        bool takePendingAcct(int, PendingAcct *);
+        bool takeNextPendingAcct(PendingAcct *);
+        void setAcctResult(int, int);
+        int waitAcctResult(int);
+        void stopAcctResults(void);
 
         int getResult();
         void setResult(int);
@@ -124,8 +182,6 @@ public:
         bool getStopThread();
         void setStopThread(bool);
 
-        bool UserWaitingtoAuth();
-
         bool getStartThread();
         void setStartThread(bool);
 
@@ -0,0 +1,423 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "Md5.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//the functions and the step of the four rounds
+#define MD5_F(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define MD5_G(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5_ROTATE(x, n) (((x) << (n)) | ((x) >> (32-(n))))
+#define MD5_STEP(f, a, b, c, d, x, t, s) \
+	(a) += f((b), (c), (d)) + (x) + (t); \
+	(a) = MD5_ROTATE((a), (s)); \
+	(a) += (b);
+#define MD5_LANE_STEP(f, a, b, c, d, x, t, s) \
+	for (l=0; l<MD5_LANES; l++) { \
+		MD5_STEP(f, (a)[l], (b)[l], (c)[l], (d)[l], (x)[l], t, s) \
+	}
+
+#ifdef __SSE2__
+//the functions and the step on four lanes in a vector register, SSE2 has no rotate and no not
+#define MD5_SSE2_MD5_F(x, y, z) _mm_or_si128(_mm_and_si128((x), (y)), _mm_andnot_si128((x), (z)))
+#define MD5_SSE2_MD5_G(x, y, z) _mm_or_si128(_mm_and_si128((x), (z)), _mm_andnot_si128((z), (y)))
+#define MD5_SSE2_MD5_H(x, y, z) _mm_xor_si128(_mm_xor_si128((x), (y)), (z))
+#define MD5_SSE2_MD5_I(x, y, z) _mm_xor_si128((y), _mm_or_si128((x), _mm_xor_si128((z), _mm_set1_epi32(-1))))
+#define MD5_SSE2_ROTATE(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32-(n)))
+#define MD5_SSE2_STEP(f, a, b, c, d, x, t, s) \
+	for (h=0; h<MD5_LANES/4; h++) { \
+		(a)[h]=_mm_add_epi32((a)[h], _mm_add_epi32(MD5_SSE2_##f((b)[h], (c)[h], (d)[h]), \
+			_mm_add_epi32((x)[h], _mm_set1_epi32((int) (t))))); \
+		(a)[h]=MD5_SSE2_ROTATE((a)[h], s); \
+		(a)[h]=_mm_add_epi32((a)[h], (b)[h]); \
+	}
+#endif
+
+//the 64 steps of the four rounds, STEP hashes one step of one or more lanes
+#define MD5_ROUNDS(STEP) \
+	STEP(MD5_F, a, b, c, d, x[ 0], 0xd76aa478,  7) \
+	STEP(MD5_F, d, a, b, c, x[ 1], 0xe8c7b756, 12) \
+	STEP(MD5_F, c, d, a, b, x[ 2], 0x242070db, 17) \
+	STEP(MD5_F, b, c, d, a, x[ 3], 0xc1bdceee, 22) \
+	STEP(MD5_F, a, b, c, d, x[ 4], 0xf57c0faf,  7) \
+	STEP(MD5_F, d, a, b, c, x[ 5], 0x4787c62a, 12) \
+	STEP(MD5_F, c, d, a, b, x[ 6], 0xa8304613, 17) \
+	STEP(MD5_F, b, c, d, a, x[ 7], 0xfd469501, 22) \
+	STEP(MD5_F, a, b, c, d, x[ 8], 0x698098d8,  7) \
+	STEP(MD5_F, d, a, b, c, x[ 9], 0x8b44f7af, 12) \
+	STEP(MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17) \
+	STEP(MD5_F, b, c, d, a, x[11], 0x895cd7be, 22) \
+	STEP(MD5_F, a, b, c, d, x[12], 0x6b901122,  7) \
+	STEP(MD5_F, d, a, b, c, x[13], 0xfd987193, 12) \
+	STEP(MD5_F, c, d, a, b, x[14], 0xa679438e, 17) \
+	STEP(MD5_F, b, c, d, a, x[15], 0x49b40821, 22) \
+	\
+	STEP(MD5_G, a, b, c, d, x[ 1], 0xf61e2562,  5) \
+	STEP(MD5_G, d, a, b, c, x[ 6], 0xc040b340,  9) \
+	STEP(MD5_G, c, d, a, b, x[11], 0x265e5a51, 14) \
+	STEP(MD5_G, b, c, d, a, x[ 0], 0xe9b6c7aa, 20) \
+	STEP(MD5_G, a, b, c, d, x[ 5], 0xd62f105d,  5) \
+	STEP(MD5_G, d, a, b, c, x[10], 0x02441453,  9) \
+	STEP(MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14) \
+	STEP(MD5_G, b, c, d, a, x[ 4], 0xe7d3fbc8, 20) \
+	STEP(MD5_G, a, b, c, d, x[ 9], 0x21e1cde6,  5) \
+	STEP(MD5_G, d, a, b, c, x[14], 0xc33707d6,  9) \
+	STEP(MD5_G, c, d, a, b, x[ 3], 0xf4d50d87, 14) \
+	STEP(MD5_G, b, c, d, a, x[ 8], 0x455a14ed, 20) \
+	STEP(MD5_G, a, b, c, d, x[13], 0xa9e3e905,  5) \
+	STEP(MD5_G, d, a, b, c, x[ 2], 0xfcefa3f8,  9) \
+	STEP(MD5_G, c, d, a, b, x[ 7], 0x676f02d9, 14) \
+	STEP(MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20) \
+	\
+	STEP(MD5_H, a, b, c, d, x[ 5], 0xfffa3942,  4) \
+	STEP(MD5_H, d, a, b, c, x[ 8], 0x8771f681, 11) \
+	STEP(MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16) \
+	STEP(MD5_H, b, c, d, a, x[14], 0xfde5380c, 23) \
+	STEP(MD5_H, a, b, c, d, x[ 1], 0xa4beea44,  4) \
+	STEP(MD5_H, d, a, b, c, x[ 4], 0x4bdecfa9, 11) \
+	STEP(MD5_H, c, d, a, b, x[ 7], 0xf6bb4b60, 16) \
+	STEP(MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23) \
+	STEP(MD5_H, a, b, c, d, x[13], 0x289b7ec6,  4) \
+	STEP(MD5_H, d, a, b, c, x[ 0], 0xeaa127fa, 11) \
+	STEP(MD5_H, c, d, a, b, x[ 3], 0xd4ef3085, 16) \
+	STEP(MD5_H, b, c, d, a, x[ 6], 0x04881d05, 23) \
+	STEP(MD5_H, a, b, c, d, x[ 9], 0xd9d4d039,  4) \
+	STEP(MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11) \
+	STEP(MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16) \
+	STEP(MD5_H, b, c, d, a, x[ 2], 0xc4ac5665, 23) \
+	\
+	STEP(MD5_I, a, b, c, d, x[ 0], 0xf4292244,  6) \
+	STEP(MD5_I, d, a, b, c, x[ 7], 0x432aff97, 10) \
+	STEP(MD5_I, c, d, a, b, x[14], 0xab9423a7, 15) \
+	STEP(MD5_I, b, c, d, a, x[ 5], 0xfc93a039, 21) \
+	STEP(MD5_I, a, b, c, d, x[12], 0x655b59c3,  6) \
+	STEP(MD5_I, d, a, b, c, x[ 3], 0x8f0ccc92, 10) \
+	STEP(MD5_I, c, d, a, b, x[10], 0xffeff47d, 15) \
+	STEP(MD5_I, b, c, d, a, x[ 1], 0x85845dd1, 21) \
+	STEP(MD5_I, a, b, c, d, x[ 8], 0x6fa87e4f,  6) \
+	STEP(MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10) \
+	STEP(MD5_I, c, d, a, b, x[ 6], 0xa3014314, 15) \
+	STEP(MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21) \
+	STEP(MD5_I, a, b, c, d, x[ 4], 0xf7537e82,  6) \
+	STEP(MD5_I, d, a, b, c, x[11], 0xbd3af235, 10) \
+	STEP(MD5_I, c, d, a, b, x[ 2], 0x2ad7d2bb, 15) \
+	STEP(MD5_I, b, c, d, a, x[ 9], 0xeb86d391, 21)
+
+/** The constructor initializes the state.*/
+Md5::Md5(void)
+{
+	this->reset();
+}
+
+/** The method sets the state back to the start, so a new hash can be computed.*/
+void Md5::reset(void)
+{
+	this->state[0]=0x67452301;
+	this->state[1]=0xefcdab89;
+	this->state[2]=0x98badcfe;
+	this->state[3]=0x10325476;
+	this->count=0;
+}
+
+/** The method hashes one block.
+ * @param block The 64 octets of the block.
+ */
+void Md5::transform(const Octet * block)
+{
+	uint32_t a=this->state[0], b=this->state[1], c=this->state[2], d=this->state[3];
+	uint32_t x[16];
+	int i;
+
+	//the words are little endian
+	for (i=0; i<16; i++)
+	{
+		x[i]=((uint32_t) block[i*4]) | ((uint32_t) block[i*4+1] << 8) |
+			((uint32_t) block[i*4+2] << 16) | ((uint32_t) block[i*4+3] << 24);
+	}
+
+	MD5_ROUNDS(MD5_STEP)
+
+	this->state[0]+=a;
+	this->state[1]+=b;
+	this->state[2]+=c;
+	this->state[3]+=d;
+}
+
+/** The method hashes data, it can be called more than once.
+ * @param data The data.
+ * @param len The length of the data.
+ */
+void Md5::update(const void * data, size_t len)
+{
+	const Octet * in=(const Octet *) data;
+	size_t used=this->count % MD5_BLOCK_LENGTH;
+	size_t n;
+
+	this->count+=len;
+	//fill the buffer first
+	if (used>0)
+	{
+		n=MD5_BLOCK_LENGTH-used;
+		if (len<n)
+		{
+			memcpy(this->buffer+used, in, len);
+			return;
+		}
+		memcpy(this->buffer+used, in, n);
+		this->transform(this->buffer);
+		in+=n;
+		len-=n;
+	}
+	//the full blocks are hashed without a copy
+	while (len>=MD5_BLOCK_LENGTH)
+	{
+		this->transform(in);
+		in+=MD5_BLOCK_LENGTH;
+		len-=MD5_BLOCK_LENGTH;
+	}
+	memcpy(this->buffer, in, len);
+}
+
+/** The method finishes the hash and writes the digest. The object must be
+ * reset before it is used again.
+ * @param digest An array for the 16 octets of the digest.
+ */
+void Md5::final(Octet * digest)
+{
+	Octet padding[MD5_BLOCK_LENGTH*2];
+	uint64_t bits=this->count*8;
+	size_t used=this->count % MD5_BLOCK_LENGTH;
+	size_t padlen=(used<56) ? (56-used) : (120-used);
+	int i;
+
+	memset(padding, 0, sizeof(padding));
+	padding[0]=0x80;
+	//the length in bits is little endian
+	for (i=0; i<8; i++)
+	{
+		padding[padlen+i]=(Octet) (bits >> (8*i));
+	}
+	this->update(padding, padlen+8);
+
+	for (i=0; i<4; i++)
+	{
+		digest[i*4]=(Octet) this->state[i];
+		digest[i*4+1]=(Octet) (this->state[i] >> 8);
+		digest[i*4+2]=(Octet) (this->state[i] >> 16);
+		digest[i*4+3]=(Octet) (this->state[i] >> 24);
+	}
+}
+
+/** The method hashes one block of every lane. The lanes are independent, every
+ * step is done for all lanes at once. With SSE2 four lanes are in one vector
+ * register, else every step is a loop of a fixed length over the lanes, which
+ * the compiler may vectorize.
+ * @param state The states of the lanes, they are updated if the lane is active.
+ * @param blocks The block of every lane.
+ * @param active True for the lanes which hash a block.
+ */
+void Md5::transformLanes(uint32_t state[4][MD5_LANES], const Octet * blocks[MD5_LANES], const bool active[MD5_LANES])
+{
+	uint32_t words[16][MD5_LANES];
+	const Octet * block;
+	int i, l;
+
+	for (l=0; l<MD5_LANES; l++)
+	{
+		block=blocks[l];
+		for (i=0; i<16; i++)
+		{
+			words[i][l]=((uint32_t) block[i*4]) | ((uint32_t) block[i*4+1] << 8) |
+				((uint32_t) block[i*4+2] << 16) | ((uint32_t) block[i*4+3] << 24);
+		}
+	}
+
+#ifdef __SSE2__
+	__m128i a[MD5_LANES/4], b[MD5_LANES/4], c[MD5_LANES/4], d[MD5_LANES/4];
+	__m128i x[16][MD5_LANES/4];
+	uint32_t result[4][MD5_LANES];
+	int h;
+
+	for (h=0; h<MD5_LANES/4; h++)
+	{
+		a[h]=_mm_loadu_si128((const __m128i *) &state[0][h*4]);
+		b[h]=_mm_loadu_si128((const __m128i *) &state[1][h*4]);
+		c[h]=_mm_loadu_si128((const __m128i *) &state[2][h*4]);
+		d[h]=_mm_loadu_si128((const __m128i *) &state[3][h*4]);
+		for (i=0; i<16; i++)
+		{
+			x[i][h]=_mm_loadu_si128((const __m128i *) &words[i][h*4]);
+		}
+	}
+
+	MD5_ROUNDS(MD5_SSE2_STEP)
+
+	for (h=0; h<MD5_LANES/4; h++)
+	{
+		_mm_storeu_si128((__m128i *) &result[0][h*4], a[h]);
+		_mm_storeu_si128((__m128i *) &result[1][h*4], b[h]);
+		_mm_storeu_si128((__m128i *) &result[2][h*4], c[h]);
+		_mm_storeu_si128((__m128i *) &result[3][h*4], d[h]);
+	}
+	for (l=0; l<MD5_LANES; l++)
+	{
+		if (active[l])
+		{
+			state[0][l]+=result[0][l];
+			state[1][l]+=result[1][l];
+			state[2][l]+=result[2][l];
+			state[3][l]+=result[3][l];
+		}
+	}
+#else
+	uint32_t a[MD5_LANES], b[MD5_LANES], c[MD5_LANES], d[MD5_LANES];
+	uint32_t (* x)[MD5_LANES]=words;
+
+	for (l=0; l<MD5_LANES; l++)
+	{
+		a[l]=state[0][l];
+		b[l]=state[1][l];
+		c[l]=state[2][l];
+		d[l]=state[3][l];
+	}
+
+	MD5_ROUNDS(MD5_LANE_STEP)
+
+	for (l=0; l<MD5_LANES; l++)
+	{
+		if (active[l])
+		{
+			state[0][l]+=a[l];
+			state[1][l]+=b[l];
+			state[2][l]+=c[l];
+			state[3][l]+=d[l];
+		}
+	}
+#endif
+}
+
+/** The method computes the digests of many messages at once, MD5_LANES
+ * messages are hashed side by side. Every message is the data followed by
+ * a suffix which is the same for all messages, like the shared secret of
+ * the accounting authenticators.
+ * @param n The number of messages.
+ * @param data The data of every message.
+ * @param len The length of the data of every message.
+ * @param suffix The suffix of the messages.
+ * @param suffixlen The length of the suffix.
+ * @param digest An array of 16 octets for the digest of every message.
+ */
+void Md5::digests(int n, const Octet * const * data, const size_t * len,
+				  const void * suffix, size_t suffixlen, Octet * const * digest)
+{
+	uint32_t state[4][MD5_LANES];
+	Octet tail[MD5_LANES][MD5_BLOCK_LENGTH];
+	Octet zero[MD5_BLOCK_LENGTH];
+	const Octet * blocks[MD5_LANES];
+	bool active[MD5_LANES];
+	size_t count[MD5_LANES], total, offset, pos;
+	uint64_t bits;
+	int i, j, l, k, lanes, maxcount;
+
+	memset(zero, 0, sizeof(zero));
+	for (i=0; i<n; i+=MD5_LANES)
+	{
+		lanes=(n-i < MD5_LANES) ? n-i : MD5_LANES;
+		maxcount=0;
+		for (l=0; l<MD5_LANES; l++)
+		{
+			state[0][l]=0x67452301;
+			state[1][l]=0xefcdab89;
+			state[2][l]=0x98badcfe;
+			state[3][l]=0x10325476;
+			//the number of blocks with the padding and the length
+			count[l]=(l<lanes) ? (len[i+l]+suffixlen+8)/MD5_BLOCK_LENGTH+1 : 0;
+			if ((int) count[l]>maxcount)
+			{
+				maxcount=count[l];
+			}
+		}
+		for (k=0; k<maxcount; k++)
+		{
+			offset=(size_t) k*MD5_BLOCK_LENGTH;
+			for (l=0; l<MD5_LANES; l++)
+			{
+				active[l]=((size_t) k<count[l]);
+				if (!active[l])
+				{
+					blocks[l]=zero;
+					continue;
+				}
+				if (offset+MD5_BLOCK_LENGTH<=len[i+l])
+				{
+					//a block of the data is hashed without a copy
+					blocks[l]=data[i+l]+offset;
+					continue;
+				}
+				//the block with the end of the data, the suffix or the padding
+				total=len[i+l]+suffixlen;
+				for (j=0; j<MD5_BLOCK_LENGTH; j++)
+				{
+					pos=offset+j;
+					if (pos<len[i+l])
+					{
+						tail[l][j]=data[i+l][pos];
+					}
+					else if (pos<total)
+					{
+						tail[l][j]=((const Octet *) suffix)[pos-len[i+l]];
+					}
+					else
+					{
+						tail[l][j]=(pos==total) ? 0x80 : 0;
+					}
+				}
+				if ((size_t) k==count[l]-1)
+				{
+					//the length in bits is little endian
+					bits=(uint64_t) total*8;
+					for (j=0; j<8; j++)
+					{
+						tail[l][56+j]=(Octet) (bits >> (8*j));
+					}
+				}
+				blocks[l]=tail[l];
+			}
+			transformLanes(state, blocks, active);
+		}
+		for (l=0; l<lanes; l++)
+		{
+			for (j=0; j<4; j++)
+			{
+				digest[i+l][j*4]=(Octet) state[j][l];
+				digest[i+l][j*4+1]=(Octet) (state[j][l] >> 8);
+				digest[i+l][j*4+2]=(Octet) (state[j][l] >> 16);
+				digest[i+l][j*4+3]=(Octet) (state[j][l] >> 24);
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MD5_H_
+#define _MD5_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "radius.h"
+
+#define MD5_BLOCK_LENGTH 64 /**<The length of a block of MD5.*/
+#define MD5_LANES 8 /**<The number of messages which are hashed side by side by Md5::digests(), a multiple of 4 for SSE2.*/
+
+/** The class implements MD5 (RFC 1321) for the User-Password hiding and the
+ * authenticators. It has no handle which must be opened and closed, the state
+ * can be copied. So a server keeps the state after its shared secret and every
+ * packet starts with a copy of it. Many independent messages are hashed
+ * side by side with digests().
+ */
+class Md5
+{
+private:
+	uint32_t	state[4];					/**<The state of the hash.*/
+	uint64_t	count;						/**<The number of hashed octets.*/
+	Octet		buffer[MD5_BLOCK_LENGTH];	/**<The octets which do not fill a block so far.*/
+
+	void		transform(const Octet *);
+	static void	transformLanes(uint32_t [4][MD5_LANES], const Octet * [MD5_LANES], const bool [MD5_LANES]);
+
+public:
+	Md5(void);
+
+	void		reset(void);
+	void		update(const void *, size_t);
+	void		final(Octet *);
+
+	static void	digests(int, const Octet * const *, const size_t *, const void *, size_t, Octet * const *);
+};
+
+#endif //_MD5_H_
@@ -0,0 +1,205 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Known-answer test of the MD5 implementation. Md5 is checked against the
+ * test suite of RFC 1321 and Md5::digests() is checked against Md5 for the
+ * message lengths around the block and padding boundaries, with and without
+ * a suffix and with a number of messages which does not fill the last lanes.
+ *
+ * Build and run it with: make check
+ */
+
+#include "Md5.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+/** Converts a digest into a hex string.
+ * @param digest The 16 octets of the digest.
+ * @param hex A buffer for 33 characters.
+ */
+static void toHex(const Octet * digest, char * hex)
+{
+	int i;
+	for (i=0; i<16; i++)
+	{
+		sprintf(hex+2*i, "%02x", digest[i]);
+	}
+}
+
+/** Hashes a string with Md5 and compares the digest with the expected one.
+ * @param message The message.
+ * @param expected The expected digest as hex string.
+ * @return 0 if the digest is correct, else 1.
+ */
+static int checkRfc1321(const char * message, const char * expected)
+{
+	Md5 md5;
+	Octet digest[16];
+	char hex[33];
+
+	md5.update(message, strlen(message));
+	md5.final(digest);
+	toHex(digest, hex);
+	if (strcmp(hex, expected)!=0)
+	{
+		cerr << "Md5Test: MD5(\"" << message << "\") is " << hex << ", expected " << expected << ".\n";
+		return 1;
+	}
+	return 0;
+}
+
+/** Hashes messages of one length with Md5::digests() and compares every
+ * digest with the one of Md5.
+ * @param n The number of messages.
+ * @param len The length of every message.
+ * @param suffix The suffix of the messages.
+ * @return The number of wrong digests.
+ */
+static int checkDigests(int n, size_t len, const char * suffix)
+{
+	Octet data[MD5_LANES*2+3][256];
+	Octet result[MD5_LANES*2+3][16];
+	const Octet * datas[MD5_LANES*2+3];
+	Octet * results[MD5_LANES*2+3];
+	size_t lens[MD5_LANES*2+3];
+	Octet expected[16];
+	Md5 md5;
+	int i, errors=0;
+	size_t j;
+
+	for (i=0; i<n; i++)
+	{
+		for (j=0; j<len; j++)
+		{
+			data[i][j]=(Octet) (i*31+j*7+1);
+		}
+		datas[i]=data[i];
+		results[i]=result[i];
+		lens[i]=len;
+	}
+	Md5::digests(n, datas, lens, suffix, strlen(suffix), results);
+
+	for (i=0; i<n; i++)
+	{
+		md5.reset();
+		md5.update(data[i], len);
+		md5.update(suffix, strlen(suffix));
+		md5.final(expected);
+		if (memcmp(expected, result[i], 16)!=0)
+		{
+			cerr << "Md5Test: Md5::digests() differs from Md5 for message " << i << " of " << n
+				 << " with length " << len << " and suffix length " << strlen(suffix) << ".\n";
+			errors++;
+		}
+	}
+	return errors;
+}
+
+/** Hashes messages of different lengths in one batch, so the lanes
+ * end after different numbers of blocks.
+ * @param suffix The suffix of the messages.
+ * @return The number of wrong digests.
+ */
+static int checkMixedDigests(const char * suffix)
+{
+	static const size_t lengths[]={0, 55, 56, 63, 64, 119, 1, 200, 120, 3, 64};
+	const int n=sizeof(lengths)/sizeof(lengths[0]);
+	Octet data[n][256];
+	Octet result[n][16];
+	const Octet * datas[n];
+	Octet * results[n];
+	size_t lens[n];
+	Octet expected[16];
+	Md5 md5;
+	int i, errors=0;
+	size_t j;
+
+	for (i=0; i<n; i++)
+	{
+		for (j=0; j<lengths[i]; j++)
+		{
+			data[i][j]=(Octet) (i*13+j*5+3);
+		}
+		datas[i]=data[i];
+		results[i]=result[i];
+		lens[i]=lengths[i];
+	}
+	Md5::digests(n, datas, lens, suffix, strlen(suffix), results);
+
+	for (i=0; i<n; i++)
+	{
+		md5.reset();
+		md5.update(data[i], lens[i]);
+		md5.update(suffix, strlen(suffix));
+		md5.final(expected);
+		if (memcmp(expected, result[i], 16)!=0)
+		{
+			cerr << "Md5Test: Md5::digests() differs from Md5 for the mixed message " << i
+				 << " with length " << lens[i] << " and suffix length " << strlen(suffix) << ".\n";
+			errors++;
+		}
+	}
+	return errors;
+}
+
+int main(void)
+{
+	static const size_t lengths[]={0, 55, 56, 63, 64, 119};
+	static const int counts[]={1, MD5_LANES, MD5_LANES*2+3};
+	static const char * suffixes[]={"", "testing123", "a shared secret which is longer than a block of md5, so it spans two blocks......"};
+	int errors=0;
+	unsigned int i, k, n;
+
+	//the test suite of RFC 1321, appendix A.5
+	errors+=checkRfc1321("", "d41d8cd98f00b204e9800998ecf8427e");
+	errors+=checkRfc1321("a", "0cc175b9c0f1b6a831c399e269772661");
+	errors+=checkRfc1321("abc", "900150983cd24fb0d6963f7d28e17f72");
+	errors+=checkRfc1321("message digest", "f96b697d7cb7938d525a2f31aaf161d0");
+	errors+=checkRfc1321("abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b");
+	errors+=checkRfc1321("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+						 "d174ab98d277d9f5a5611c2c9f419d9f");
+	errors+=checkRfc1321("12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+						 "57edf4a22be3c955ac49da2e2107b67a");
+
+	for (i=0; i<sizeof(suffixes)/sizeof(suffixes[0]); i++)
+	{
+		for (k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++)
+		{
+			//one message, a full batch and a batch which does not fill the last lanes
+			for (n=0; n<sizeof(counts)/sizeof(counts[0]); n++)
+			{
+				errors+=checkDigests(counts[n], lengths[k], suffixes[i]);
+			}
+		}
+		errors+=checkMixedDigests(suffixes[i]);
+	}
+
+	if (errors!=0)
+	{
+		cerr << "Md5Test: " << errors << " errors.\n";
+		return 1;
+	}
+	cout << "Md5Test: ok\n";
+	return 0;
+}
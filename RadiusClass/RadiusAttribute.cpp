@@ -28,12 +28,11 @@
 #define NEED_LIBGCRYPT_VERSION "1.2.0"
 GCRY_THREAD_OPTION_PTHREAD_IMPL;
 
-/** The constructor sets the type to 0 and the value to NULL.*/
+/** The constructor sets the type to 0 and the value to empty.*/
 RadiusAttribute::RadiusAttribute(void)
 {
     this->type=0;
     this->length=0;
-    this->value=NULL;
 }
 
 
@@ -45,7 +44,7 @@ RadiusAttribute::RadiusAttribute(void)
 RadiusAttribute::RadiusAttribute(Octet ty, const char *value)
 {
     this->type=ty;
-    this->value=NULL;
+    this->length=0;
     //Only set the value if there is something in.
     if(value != NULL) {
         this->setValue(value);
@@ -53,13 +52,12 @@ RadiusAttribute::RadiusAttribute(Octet ty, const char *value)
 }
 
 
-/**The construcotr sets the type. The value is set to NULL.
+/**The construcotr sets the type. The value is empty.
  * @param Octet typ :  The type of the attribute.*/
 RadiusAttribute::RadiusAttribute(Octet typ)
 {
     this->type=typ;
     this->length=0;
-    this->value=NULL;
 }
 
 
@@ -70,7 +68,7 @@ RadiusAttribute::RadiusAttribute(Octet typ)
 RadiusAttribute::RadiusAttribute(Octet typ, const std::string &str)
 {
     this->type=typ;
-    this->value=NULL;
+    this->length=0;
     this->setValue(str);
 }
 
@@ -84,19 +82,14 @@ RadiusAttribute::RadiusAttribute(Octet typ, const std::string &str)
 RadiusAttribute::RadiusAttribute(Octet typ, uint32_t value)
 {
     this->type=typ;
-    this->value=NULL;
+    this->length=0;
     this->setValue(value);
 }
 
 
-/** The destructor of the class.
- * It frees the allocated memory for the value, if the pointer is not NULL.
- */
+/** The destructor of the class.*/
 RadiusAttribute::~RadiusAttribute(void)
 {
-    if (this->value) {
-        delete [] this->value;
-    }
 }
 
 
@@ -156,96 +149,46 @@ void RadiusAttribute::setLength(Octet len)
 char * RadiusAttribute::makePasswordHash(const char *password, char *hpassword,
                                          const char *sharedSecret, const char *authenticator)
 {
-  unsigned char digest[MD5_DIGEST_LENGTH] = {0}; //The digest.
-  gcry_md_hd_t context;                          //the hash context
-  int i,k,j,l,                                   //Some counters.
-    passwordlen;                                 //The password length.
+  Md5 secret;
+  secret.update(sharedSecret, strlen(sharedSecret));
+  //the password field has at least 16 octets
+  hashPassword((const Octet *) password, this->length-2 < MD5_DIGEST_LENGTH ? MD5_DIGEST_LENGTH : this->length-2,
+               (Octet *) hpassword, secret, authenticator);
+  return hpassword;
+}
 
-  if(!gcry_control(GCRYCTL_ANY_INITIALIZATION_P))
-  { /* No other library has already initialized libgcrypt. */
-    gcry_error_t err = 0;
-    err |= gcry_control(GCRYCTL_SET_THREAD_CBS,&gcry_threads_pthread);
-    if(err) {
-      std::cerr << "libgcrypt gcry_control(GCRYCTL_SET_THREAD_CBS,&gcry_threads_pthread) failed!\n";}
-
-    if (!gcry_check_version(NEED_LIBGCRYPT_VERSION) ) {
-      cerr << "libgcrypt is too old (need " << NEED_LIBGCRYPT_VERSION
-           << ", have " << gcry_check_version (NULL) << ")\n";
-      // actually it's really not ok!! fail
-    }
-    /* Disable secure memory.  */
-    err |= gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
-    if(err) {
-      std::cerr << "libgcrypt gcry_control(GCRYCTL_DISABLE_SECMEM, 0) failed!\n";}
 
-    err |= gcry_control(GCRYCTL_INITIALIZATION_FINISHED);
-    if(err) {
-      std::cerr << "libgcrypt gcry_control(GCRYCTL_INITIALIZATION_FINISHED) failed!\n";}
+/** Creates the MD5/xOR hash of a password field, see makePasswordHash().
+ * The method needs no attribute, so a packet hashes the password in place
+ * in its send buffer. The shared secret is given as the MD5 state after
+ * the secret, so it is not hashed again for every packet.
+ * @param password The padded password.
+ * @param len The length of the password field, a multiple of 16 octets.
+ * @param hpassword An array for the hashed password with the length len.
+ * @param sharedSecret The MD5 state after the sharedsecret of the server.
+ * @param authenticator The authenticator field of the packet.
+ */
+void RadiusAttribute::hashPassword(const Octet *password, int len, Octet *hpassword,
+                                   const Md5 &sharedSecret, const char *authenticator)
+{
+  Octet digest[MD5_DIGEST_LENGTH];               //The digest.
+  Md5 context;                                   //the hash context
+  int i,j;                                       //Some counters.
 
-    if(err) {
-      std::cerr << "libgcrypt initialization failed!\n";
-      // fail
-    }
-  }
-  gcry_md_open(&context, GCRY_MD_MD5, 0);
-  gcry_md_write(context, sharedSecret, strlen(sharedSecret));
-  gcry_md_write(context, authenticator, MD5_DIGEST_LENGTH);
-  unsigned char *msg_dig = gcry_md_read(context, GCRY_MD_MD5);
-  if(msg_dig) {
-    memcpy(digest, msg_dig, MD5_DIGEST_LENGTH);
-  } else {
-    std::cerr << "libgcrypt message read failed! ("
-              << __func__ << ": " << __LINE__ << ")\n";
-    // fail
-  }
-  if(this->length < MD5_DIGEST_LENGTH) {
-    //XOR the password and the digest
-    for(i=0; i < MD5_DIGEST_LENGTH; ++i) {
-      hpassword[i] = password[i] ^ digest[i];
-    }
-  }
-  else
+  //every block of 16 octets is XORed with the hash of the secret and the previous block
+  for(i = 0; i < len; i += MD5_DIGEST_LENGTH)
   {
-    passwordlen = this->length - 2; //get the length of the passwordfield
-
-    //XOR the password and the digest, build the first xOR-hash
-    for(i = 0; i < MD5_DIGEST_LENGTH; ++i) {
-      hpassword[i] = password[i] ^ digest[i];
+    context = sharedSecret;
+    if(i == 0) {
+      context.update(authenticator, MD5_DIGEST_LENGTH);
+    } else {
+      context.update(hpassword + i - MD5_DIGEST_LENGTH, MD5_DIGEST_LENGTH);
     }
-    passwordlen = passwordlen - MD5_DIGEST_LENGTH;  //the next 16 charakters
-    k = -1;                        //the first loop
-    while(passwordlen > 0)
-    {
-      //build the next hash
-      memset(digest, 0, MD5_DIGEST_LENGTH);
-
-      // release previouse message digest context and related resources
-      // gcry_md_close(context);
-      //put the hash of the last XOR in the digest, build the hash
-      // gcry_md_open (&context, GCRY_MD_MD5, 0);
-      gcry_md_reset(context);
-      gcry_md_write(context, sharedSecret, strlen(sharedSecret));
-      gcry_md_write(context, hpassword + (++k * MD5_DIGEST_LENGTH), MD5_DIGEST_LENGTH);
-
-      unsigned char *msg_dig = gcry_md_read(context, GCRY_MD_MD5);
-      if(msg_dig) {
-        memcpy(digest, msg_dig, MD5_DIGEST_LENGTH);
-      } else {
-        std::cerr << "libgcrypt message read failed! ("
-                  << __func__ << ": " << __LINE__ << ")\n";
-        // fail
-      }
-
-      j=-1;
-      l= i + MD5_DIGEST_LENGTH;
-      for(; i < l; ++i) {
-        hpassword[i] = password[i] ^ digest[++j];
-      }
-      passwordlen = passwordlen - MD5_DIGEST_LENGTH;      //and the next 16 characters
+    context.final(digest);
+    for(j = 0; j < MD5_DIGEST_LENGTH; ++j) {
+      hpassword[i+j] = password[i+j] ^ digest[j];
     }
   }
-  gcry_md_close(context);
-  return hpassword;
 }
 
 
@@ -396,10 +339,7 @@ int RadiusAttribute::setValue(const char *value)
                     passwordlen;    //The passwordlength.
 
     //If the attribute has already an value, clear it.
-    if (this->value!=NULL) {
-        delete [] this->value;
-        length = 0;
-    }
+    this->length = 0;
 
     switch(this->type)
     {
@@ -408,20 +348,12 @@ int RadiusAttribute::setValue(const char *value)
         case    ATTRIB_Framed_IP_Address:
         case    ATTRIB_Framed_IP_Netmask:
         case    ATTRIB_Login_IP_Host:
-          //allocate memory
-          try {
-            this->value=new Octet[4];
-          } catch (...) {
-            return ALLOC_ERROR;
-          }
             //transform the number parted by the "." in network byte order
             i=0;j=0;
             while(value[i]!='.' && i<3)
                 tmpStr[j++]=value[i++];
             tmpStr[j]=0;
             if (value[i]!='.') {
-              delete [] this->value;
-              this->value = NULL;
                 return BAD_IP;
             }
             this->value[0]=(unsigned char)atoi(tmpStr);
@@ -432,8 +364,6 @@ int RadiusAttribute::setValue(const char *value)
                 tmpStr[j++]=value[i++];
             tmpStr[j]=0;
             if (value[i]!='.') {
-              delete [] this->value;
-              this->value = NULL;
                 return BAD_IP;
             }
             this->value[1]=(unsigned char)atoi(tmpStr);
@@ -443,8 +373,6 @@ int RadiusAttribute::setValue(const char *value)
                 tmpStr[j++]=value[i++];
             tmpStr[j]=0;
             if (value[i]!='.') {
-              delete [] this->value;
-              this->value = NULL;
                 return BAD_IP;
             }
             this->value[2]=(unsigned char)atoi(tmpStr);
@@ -461,11 +389,6 @@ int RadiusAttribute::setValue(const char *value)
         case    ATTRIB_User_Password:
             //the minimum length is 16 Octets
             if (strlen(value)<16) {
-              try {
-                this->value = new Octet [16];
-              } catch (...) {
-                return ALLOC_ERROR;
-              }
                 memset(this->value,0,16);
                 memcpy(this->value, value, strlen(value));
                 this->length=(Octet)16;
@@ -476,10 +399,8 @@ int RadiusAttribute::setValue(const char *value)
                 if ((strlen(value)%16)!=0) {
                     passwordlen++;
                 }
-                try {
-                  this->value = new Octet [passwordlen*16];
-                } catch (...) {
-                  return ALLOC_ERROR;
+                if (passwordlen*16>RADIUS_MAX_PASSWORD_LEN) {
+                    return TO_LONG_PASSWORD;
                 }
                 memset(this->value,0,(passwordlen*16));
                 memcpy(this->value, value, strlen(value));
@@ -523,13 +444,6 @@ int RadiusAttribute::setValue(const char *value)
         case    ATTRIB_Acct_Input_Gigawords:
         case    ATTRIB_Acct_Output_Gigawords:
         case    ATTRIB_Event_Timestamp:
-          try {
-            if(!(this->value=new Octet [4])) {
-              return ALLOC_ERROR;
-            }
-          } catch (...) {
-            return ALLOC_ERROR;
-          }
             //transform the integer in the right network byte order
             q=htonl(strtoul(value,NULL,10));
             memcpy(this->value,&q,4);
@@ -539,22 +453,18 @@ int RadiusAttribute::setValue(const char *value)
 
         //Special case vender specific, at the moment it is treated as a string.
         case ATTRIB_Vendor_Specific:
-          try {
-            this->value=new Octet [int(value[5])+4];
-          } catch (...) {
-            return ALLOC_ERROR;
-          }
-            memcpy(this->value, value, int(value[5])+4);
-            this->length=int(value[5])+4;
+            if (int((Octet) value[5])+4>RADIUS_MAX_ATTRIBUTE_LEN) {
+                return TO_BIG_ATTRIBUTE_LENGTH;
+            }
+            memcpy(this->value, value, int((Octet) value[5])+4);
+            this->length=int((Octet) value[5])+4;
             break;
 
-        //String: They need only copied in a new char array.
+        //String: They need only copied into the value.
         default:
-          try {
-            this->value=new Octet [strlen(value)];
-          } catch (...) {
-            return ALLOC_ERROR;
-          }
+            if (strlen(value)>RADIUS_MAX_ATTRIBUTE_LEN) {
+                return TO_BIG_ATTRIBUTE_LENGTH;
+            }
             memcpy(this->value, value, strlen(value));
             this->length=strlen(value);
     }
@@ -577,13 +487,10 @@ int RadiusAttribute::setValue(const char *value)
 
 int RadiusAttribute::setRecvValue(char *value)
 {
-  try {
-    if(!(this->value=new Octet[this->length-2])) {
-        return ALLOC_ERROR;
+    if (this->length<2)
+    {
+        return BAD_LENGTH;
     }
-  } catch (...) {
-    return ALLOC_ERROR;
-  }
     memcpy(this->value, value, (this->length-2));
     return 0;
 }
@@ -603,20 +510,24 @@ int RadiusAttribute::intFromBuf(void)
 /**The overloading of the assignment operator.*/
 RadiusAttribute & RadiusAttribute::operator=(const RadiusAttribute &ra)
 {
-    this->value=new Octet[ra.length-2];
     this->type=ra.type;
     this->length=ra.length;
-    memcpy(this->value,ra.value,ra.length-2);
+    if (ra.length>2)
+    {
+        memcpy(this->value,ra.value,ra.length-2);
+    }
     return *this;
 }
 
 /**The copy constructor.*/
 RadiusAttribute::RadiusAttribute(const RadiusAttribute &ra)
 {
-    this->value=new Octet[ra.length-2];
     this->type=ra.type;
     this->length=ra.length;
-    memcpy(this->value,ra.value,ra.length-2);
+    if (ra.length>2)
+    {
+        memcpy(this->value,ra.value,ra.length-2);
+    }
 }
 
 
@@ -660,3 +571,32 @@ string RadiusAttribute::ipFromBuf(void)
           value[0], value[1], value[2], value[3]);
   return ip_str;
 }
+
+
+/** Transform the value of a received attribute to an integer, see RadiusAttribute::intFromBuf().
+ * @return The transformed integer, 0 if the value is too short.
+ */
+int RadiusAttributeView::intFromBuf(void) const
+{
+    uint32_t i;
+    if (this->length < 4) {
+        return 0;
+    }
+    memcpy(&i, this->value, 4);
+    return ntohl(i);
+}
+
+
+/** The method converts the value of a received attribute into an ip.
+ * @return The ip address as a string, empty if the value is too short.
+ */
+string RadiusAttributeView::ipFromBuf(void) const
+{
+  if(this->length < 4) {
+    return "";
+  }
+  char ip_str[16] = {0};
+  sprintf(ip_str, "%i.%i.%i.%i",
+          value[0], value[1], value[2], value[3]);
+  return ip_str;
+}
@@ -24,6 +24,7 @@
 #include <gcrypt.h>
 #include <string>
 #include "radius.h"
+#include "Md5.h"
 #include <iostream>
 using namespace std;
 
@@ -34,7 +35,7 @@ class RadiusAttribute
 private:
     Octet       type;       /**< The attibute type, see in radius.h*/
     Octet       length;     /**< The attribute length, of the value*/
-    Octet       *value;     /**< A pointer to the value*/
+    Octet       value[RADIUS_MAX_ATTRIBUTE_LEN]; /**< The value, it is kept in the attribute, so an attribute on the stack needs no heap memory.*/
 
 
 public:
@@ -73,6 +74,8 @@ public:
 
     char *          makePasswordHash(const char *password, char * hpassword,
                                      const char *sharedSecret, const char *authenticator);
+    static void     hashPassword(const Octet *password, int len, Octet *hpassword,
+                                 const Md5 &sharedSecret, const char *authenticator);
   char *          makePasswordHashPrev(const char *password,char * hpassword, const char *sharedSecret, const char *authenticator);
 
 };
@@ -80,4 +83,17 @@ public:
 
 
 
+/** A view of a received attribute. The value is not copied, it points
+ * into the receive buffer of the packet and is valid as long as the packet.*/
+struct RadiusAttributeView
+{
+    Octet       type;       /**< The attibute type, see in radius.h*/
+    int         length;     /**< The length of the value*/
+    Octet       *value;     /**< A pointer to the value in the receive buffer*/
+
+    int             intFromBuf(void) const;
+    string          ipFromBuf(void) const;
+};
+
+
 #endif //_RADIUSATTRIB_H_
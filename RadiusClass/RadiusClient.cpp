@@ -0,0 +1,1454 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RadiusClient.h"
+#include <signal.h>
+#include <poll.h>
+#include <math.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+/** The callback for RadiusClient::send(), it wakes up the
+ * waiting thread when the request is finished.
+ */
+class RadiusSyncCallback : public RadiusRequestCallback
+{
+public:
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool done;
+	int result;
+
+	RadiusSyncCallback(void)
+	{
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&cond, NULL);
+		done=false;
+		result=NO_RESPONSE;
+	}
+	~RadiusSyncCallback(void)
+	{
+		pthread_cond_destroy(&cond);
+		pthread_mutex_destroy(&mutex);
+	}
+	void complete(RadiusPacket *packet, int result)
+	{
+		pthread_mutex_lock(&mutex);
+		this->result=result;
+		this->done=true;
+		pthread_cond_signal(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+	int wait(void)
+	{
+		pthread_mutex_lock(&mutex);
+		while (!done)
+		{
+			pthread_cond_wait(&cond, &mutex);
+		}
+		pthread_mutex_unlock(&mutex);
+		return result;
+	}
+};
+
+
+/** The constructor. The client is not running until start() is called.*/
+RadiusClient::RadiusClient(void)
+{
+	this->serverlist=NULL;
+	this->pollfd=-1;
+	this->wakeup[0]=-1;
+	this->wakeup[1]=-1;
+	this->running=false;
+	this->stopping=false;
+	this->resolving=false;
+	this->ports=0;
+	this->unfinished=0;
+	pthread_mutex_init(&this->mutex, NULL);
+	pthread_cond_init(&this->finished, NULL);
+	pthread_cond_init(&this->resolvewait, NULL);
+}
+
+/** The destructor stops the thread, if it is running.*/
+RadiusClient::~RadiusClient(void)
+{
+	this->stop();
+	pthread_cond_destroy(&this->resolvewait);
+	pthread_cond_destroy(&this->finished);
+	pthread_mutex_destroy(&this->mutex);
+}
+
+/** The method opens the sockets to the radius servers and starts the
+ * thread of the event loop. It must be called in the process which
+ * sends the packets (after fork()). Only the sockets to the ports the process
+ * uses are opened, so two processes never bind the same source port to the same server port.
+ * @param serverlist The list of radius servers, the first one has the highest priority.
+ * @param ports RADIUS_CLIENT_AUTH and/or RADIUS_CLIENT_ACCT.
+ * @param balance How the requests are spread over the servers, one of RADIUS_BALANCE_*.
+ * @param maxoutstanding The maximum number of outstanding requests, more requests wait. 0 for no limit.
+ * @return 0 if everything is ok, else SOCKET_ERROR, also if no server got a socket.
+ */
+int RadiusClient::start(list<RadiusServer> * serverlist, int ports, int balance, int maxoutstanding)
+{
+	list<RadiusServer>::iterator server;
+	sigset_t signal_mask, old_mask;
+	unsigned int i, opened=0;
+	int j;
+
+	if (this->running)
+	{
+		return 0;
+	}
+	this->serverlist=serverlist;
+	this->ports=ports;
+	this->balance=balance;
+	this->nextserver=0;
+	this->maxoutstanding=maxoutstanding;
+	this->outstanding=0;
+	this->retrywaiting=false;
+	this->stopping=false;
+
+	if (pipe(this->wakeup)!=0)
+	{
+		cerr << "RadiusClient: Cannot create pipe: " << strerror(errno) << "\n";
+		return SOCKET_ERROR;
+	}
+	fcntl(this->wakeup[0], F_SETFL, O_NONBLOCK);
+	fcntl(this->wakeup[1], F_SETFL, O_NONBLOCK);
+	fcntl(this->wakeup[0], F_SETFD, FD_CLOEXEC);
+	fcntl(this->wakeup[1], F_SETFD, FD_CLOEXEC);
+
+#ifdef __linux__
+	struct epoll_event ev;
+	if ((this->pollfd=epoll_create(RADIUS_CLIENT_MAX_EVENTS))<0)
+	{
+		cerr << "RadiusClient: Cannot create epoll descriptor: " << strerror(errno) << "\n";
+		this->closeSockets();
+		return SOCKET_ERROR;
+	}
+	fcntl(this->pollfd, F_SETFD, FD_CLOEXEC);
+	memset(&ev, 0, sizeof(ev));
+	ev.events=EPOLLIN;
+	ev.data.ptr=NULL;
+	epoll_ctl(this->pollfd, EPOLL_CTL_ADD, this->wakeup[0], &ev);
+#endif
+
+	for (server=serverlist->begin(); server != serverlist->end(); server++)
+	{
+		RadiusClientServer s;
+		s.server=&(*server);
+		//until the first response the wait of the server is the timeout
+		s.srtt=-1;
+		s.rttvar=0;
+		s.state=RADIUS_SERVER_ALIVE;
+		s.failedprobes=0;
+		s.probing=false;
+		s.nextprobe=0;
+		s.outstanding=0;
+		s.credit=0;
+		s.rto=((long long) server->getWait())*1000000;
+		if (s.rto > ((long long) server->getMaxRto())*1000)
+		{
+			s.rto=((long long) server->getMaxRto())*1000;
+		}
+		this->servers.push_back(s);
+	}
+	for (i=0; i<this->servers.size(); i++)
+	{
+		for (j=0; j<this->servers[i].server->getSockets(); j++)
+		{
+			if (((ports & RADIUS_CLIENT_AUTH) && this->openSocket(i, false, j)!=0) ||
+			    ((ports & RADIUS_CLIENT_ACCT) && this->openSocket(i, true, j)!=0))
+			{
+				cerr << "RadiusClient: Cannot open sockets to server " << this->servers[i].server->getName() << ".\n";
+				break;
+			}
+		}
+		//a server without sockets is dead until they are opened with a new address
+		if (this->hasSockets(i))
+		{
+			opened++;
+		}
+		else
+		{
+			this->setState(i, RADIUS_SERVER_DEAD);
+		}
+	}
+	if (opened==0)
+	{
+		cerr << "RadiusClient: Cannot open sockets to any server.\n";
+		this->closeSockets();
+		return SOCKET_ERROR;
+	}
+
+	//the signals are handled by the other threads
+	sigfillset(&signal_mask);
+	pthread_sigmask(SIG_BLOCK, &signal_mask, &old_mask);
+	if (pthread_create(&this->thread, NULL, &RadiusClient::loop, (void *) this)!=0)
+	{
+		pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+		cerr << "RadiusClient: Cannot create thread.\n";
+		this->closeSockets();
+		return SOCKET_ERROR;
+	}
+	this->running=true;
+
+	//the names of the servers are resolved again in the background, also the names which were never resolved
+	for (i=0; i<this->servers.size(); i++)
+	{
+		struct sockaddr_storage addr;
+		socklen_t len;
+		if (this->servers[i].server->getResolveTtl()>0 ||
+			this->servers[i].server->getAddress(&addr, &len, 0)!=0)
+		{
+			break;
+		}
+	}
+	if (i<this->servers.size())
+	{
+		if (pthread_create(&this->resolver, NULL, &RadiusClient::resolve, (void *) this)==0)
+		{
+			this->resolving=true;
+		}
+		else
+		{
+			cerr << "RadiusClient: Cannot create resolver thread, the addresses of the servers are not refreshed.\n";
+		}
+	}
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+	return 0;
+}
+
+/** The method stops the thread of the event loop. Requests which are
+ * not finished so far are finished with NO_RESPONSE. The sockets are closed.
+ */
+void RadiusClient::stop(void)
+{
+	if (!this->running)
+	{
+		return;
+	}
+	pthread_mutex_lock(&this->mutex);
+	this->stopping=true;
+	pthread_cond_broadcast(&this->resolvewait);
+	pthread_mutex_unlock(&this->mutex);
+	if (write(this->wakeup[1], "x", 1) < 0)
+	{
+		//the pipe is full, the thread wakes up anyway
+	}
+	if (this->resolving)
+	{
+		pthread_join(this->resolver, NULL);
+		this->resolving=false;
+	}
+	pthread_join(this->thread, NULL);
+	this->running=false;
+	this->resolved.clear();
+	this->closeSockets();
+}
+
+/** The method returns true if the thread of the client is running.
+ * @return True if the client is running.
+ */
+bool RadiusClient::isRunning(void)
+{
+	return this->running;
+}
+
+/** The method sends a packet and waits for the response. The packet is sent to the
+ * servers in the order of the server list. If the client is not running the packet is
+ * sent with RadiusPacket::radiusSend() and RadiusPacket::radiusReceive().
+ * @param packet The packet to send, the response is written into it.
+ * @return 0 if a response was received, else NO_RESPONSE, SHAPE_ERROR or another error number.
+ */
+int RadiusClient::send(RadiusPacket * packet)
+{
+	RadiusSyncCallback callback;
+
+	if (!this->running)
+	{
+		if (this->serverlist==NULL)
+		{
+			return NO_RESPONSE;
+		}
+		if (packet->radiusSend(this->serverlist->begin())<0)
+		{
+			cerr << "RadiusClient: Packet was not sent.\n";
+		}
+		return packet->radiusReceive(this->serverlist);
+	}
+	if (this->submit(packet, &callback)!=0)
+	{
+		return SOCKET_ERROR;
+	}
+	return callback.wait();
+}
+
+/** The method submits a packet to the client. The method returns at once,
+ * when the request is finished the callback is called from the thread of the client.
+ * The packet must exist until the callback is called.
+ * @param packet The packet to send, the response is written into it.
+ * @param callback The callback of the request.
+ * @param wake If false the thread is not woken up, so more requests can be submitted
+ * and are handled in one batch after wakeUp() is called.
+ * @return 0 if the request is submitted, else SOCKET_ERROR.
+ */
+int RadiusClient::submit(RadiusPacket * packet, RadiusRequestCallback * callback, bool wake)
+{
+	RadiusClientRequest * request;
+
+	if (!this->running)
+	{
+		return SOCKET_ERROR;
+	}
+	request=new RadiusClientRequest;
+	request->packet=packet;
+	request->callback=callback;
+	request->server=0;
+	request->first=0;
+	request->attempt=0;
+	request->tries=0;
+	request->socket=NULL;
+	request->identifier=0;
+	request->timerset=false;
+	request->probe=false;
+
+	pthread_mutex_lock(&this->mutex);
+	if (this->stopping)
+	{
+		pthread_mutex_unlock(&this->mutex);
+		delete request;
+		return SOCKET_ERROR;
+	}
+	this->submitted.push_back(request);
+	this->unfinished++;
+	pthread_mutex_unlock(&this->mutex);
+	if (wake)
+	{
+		this->wakeUp();
+	}
+	return 0;
+}
+
+/** The method wakes up the thread of the client, it takes all submitted requests.
+ */
+void RadiusClient::wakeUp(void)
+{
+	if (write(this->wakeup[1], "x", 1) < 0)
+	{
+		//the pipe is full, the thread wakes up anyway
+	}
+}
+
+/** The method waits until all submitted requests are finished. A request is
+ * finished when the response is received or all servers failed.
+ */
+void RadiusClient::flush(void)
+{
+	pthread_mutex_lock(&this->mutex);
+	while (this->running && this->unfinished > 0)
+	{
+		pthread_cond_wait(&this->finished, &this->mutex);
+	}
+	pthread_mutex_unlock(&this->mutex);
+}
+
+/** The event loop of the client.
+ * @param c A pointer to the RadiusClient object.
+ */
+void * RadiusClient::loop(void * c)
+{
+	RadiusClient * client = (RadiusClient *) c;
+	list<RadiusClientRequest *> requests;
+	list<RadiusClientRequest *>::iterator it;
+	list<RadiusClientAddress> addresses;
+	list<RadiusClientAddress>::iterator addr;
+	char buf[64];
+	bool stopping;
+	int i, n;
+
+	while (1)
+	{
+		//take the new requests
+		pthread_mutex_lock(&client->mutex);
+		requests.swap(client->submitted);
+		addresses.swap(client->resolved);
+		stopping=client->stopping;
+		pthread_mutex_unlock(&client->mutex);
+		for (addr=addresses.begin(); addr != addresses.end(); addr++)
+		{
+			client->setAddress(*addr);
+		}
+		addresses.clear();
+		//the waiting requests go first, they get the identifiers which were freed
+		client->dispatchWaiting();
+		for (it=requests.begin(); it != requests.end(); it++)
+		{
+			(*it)->first=client->choose((*it)->packet);
+			client->dispatch(*it);
+		}
+		requests.clear();
+		client->sign();
+		if (stopping)
+		{
+			break;
+		}
+
+#ifdef __linux__
+		struct epoll_event events[RADIUS_CLIENT_MAX_EVENTS];
+		n=epoll_wait(client->pollfd, events, RADIUS_CLIENT_MAX_EVENTS, client->nextTimeout());
+		for (i=0; i<n; i++)
+		{
+			if (events[i].data.ptr==NULL)
+			{
+				while (read(client->wakeup[0], buf, sizeof(buf)) > 0);
+			}
+			else
+			{
+				client->receive((RadiusClientSocket *) events[i].data.ptr);
+			}
+		}
+#else
+		vector<struct pollfd> fds;
+		vector<RadiusClientSocket *> sockets;
+		struct pollfd p;
+		unsigned int k, l;
+		p.fd=client->wakeup[0];
+		p.events=POLLIN;
+		fds.push_back(p);
+		sockets.push_back(NULL);
+		for (k=0; k<client->servers.size(); k++)
+		{
+			for (l=0; l<client->servers[k].authsockets.size(); l++)
+			{
+				p.fd=client->servers[k].authsockets[l]->fd;
+				fds.push_back(p);
+				sockets.push_back(client->servers[k].authsockets[l]);
+			}
+			for (l=0; l<client->servers[k].acctsockets.size(); l++)
+			{
+				p.fd=client->servers[k].acctsockets[l]->fd;
+				fds.push_back(p);
+				sockets.push_back(client->servers[k].acctsockets[l]);
+			}
+		}
+		n=poll(&fds[0], fds.size(), client->nextTimeout());
+		for (i=0; n > 0 && i<(int)fds.size(); i++)
+		{
+			if ((fds[i].revents & POLLIN)==0)
+			{
+				continue;
+			}
+			if (sockets[i]==NULL)
+			{
+				while (read(client->wakeup[0], buf, sizeof(buf)) > 0);
+			}
+			else
+			{
+				client->receive(sockets[i]);
+			}
+		}
+#endif
+		client->expire();
+		client->probe();
+		client->sign();
+	}
+
+	//finish all requests which are left
+	while (!client->timers.empty())
+	{
+		RadiusClientRequest * request=client->timers.begin()->second;
+		client->cancelTimer(request);
+		client->release(request);
+		client->finish(request, NO_RESPONSE);
+	}
+	while (!client->waiting.empty())
+	{
+		RadiusClientRequest * request=client->waiting.front();
+		client->waiting.pop_front();
+		client->finish(request, NO_RESPONSE);
+	}
+	return NULL;
+}
+
+/** The resolver thread of the client. It resolves the name of every server
+ * again when its ttl expired and hands the addresses to the event loop, so
+ * the event loop never waits on the resolver. A name which was never resolved
+ * is tried every RADIUS_CLIENT_RESOLVE_RETRY seconds until it is resolved.
+ * @param c A pointer to the RadiusClient object.
+ */
+void * RadiusClient::resolve(void * c)
+{
+	RadiusClient * client = (RadiusClient *) c;
+	vector<long long> due;
+	vector<bool> unresolved;
+	RadiusClientAddress address;
+	struct timespec deadline;
+	long long next, wait;
+	unsigned int i;
+	int ttl;
+
+	//the addresses are only changed by the event loop with the addresses of this thread
+	for (i=0; i<client->servers.size(); i++)
+	{
+		unresolved.push_back(client->servers[i].server->getAddress(&address.address, &address.len, 0)!=0);
+		due.push_back(now()+((long long) (unresolved[i] ? RADIUS_CLIENT_RESOLVE_RETRY :
+			client->servers[i].server->getResolveTtl()))*1000000);
+	}
+
+	pthread_mutex_lock(&client->mutex);
+	while (!client->stopping)
+	{
+		//wait for the next server whose ttl expires
+		next=-1;
+		for (i=0; i<due.size(); i++)
+		{
+			if ((client->servers[i].server->getResolveTtl()>0 || unresolved[i]) && (next<0 || due[i]<next))
+			{
+				next=due[i];
+			}
+		}
+		wait=next-now();
+		if (wait>0)
+		{
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_sec+=wait/1000000;
+			deadline.tv_nsec+=(wait%1000000)*1000;
+			if (deadline.tv_nsec>=1000000000)
+			{
+				deadline.tv_sec++;
+				deadline.tv_nsec-=1000000000;
+			}
+			pthread_cond_timedwait(&client->resolvewait, &client->mutex, &deadline);
+			continue;
+		}
+		pthread_mutex_unlock(&client->mutex);
+
+		//the names and ttls are not changed after start()
+		for (i=0; i<due.size(); i++)
+		{
+			ttl=client->servers[i].server->getResolveTtl();
+			if ((ttl==0 && !unresolved[i]) || due[i]>now())
+			{
+				continue;
+			}
+			due[i]=now()+((long long) (unresolved[i] ? RADIUS_CLIENT_RESOLVE_RETRY : ttl))*1000000;
+			if (RadiusServer::lookup(client->servers[i].server->getName(), &address.address, &address.len)!=0)
+			{
+				if (unresolved[i])
+				{
+					cerr << "RadiusClient: Cannot resolve the radius server " << client->servers[i].server->getName() << ", it is tried again later.\n";
+				}
+				else
+				{
+					cerr << "RadiusClient: Cannot resolve the radius server " << client->servers[i].server->getName() << ", the old address is used.\n";
+				}
+				continue;
+			}
+			unresolved[i]=false;
+			due[i]=now()+((long long) ttl)*1000000;
+			address.server=i;
+			pthread_mutex_lock(&client->mutex);
+			client->resolved.push_back(address);
+			pthread_mutex_unlock(&client->mutex);
+			if (write(client->wakeup[1], "x", 1) < 0)
+			{
+				//the pipe is full, the thread wakes up anyway
+			}
+		}
+		pthread_mutex_lock(&client->mutex);
+	}
+	pthread_mutex_unlock(&client->mutex);
+	return NULL;
+}
+
+/** The method applies an address of a server which was resolved again. If the
+ * address changed, the sockets of the server are connected to the new address,
+ * the outstanding requests are answered from the new address or retransmitted.
+ * If the sockets could not be opened at start, they are opened now.
+ * @param address The new address.
+ */
+void RadiusClient::setAddress(RadiusClientAddress &address)
+{
+	RadiusClientServer &s=this->servers[address.server];
+	struct sockaddr_storage addr;
+	socklen_t len;
+	unsigned int i;
+	int j;
+
+	if (!s.server->setAddress(&address.address, address.len))
+	{
+		return;
+	}
+	if (s.authsockets.empty() && s.acctsockets.empty())
+	{
+		for (j=0; j<s.server->getSockets(); j++)
+		{
+			if (((this->ports & RADIUS_CLIENT_AUTH) && this->openSocket(address.server, false, j)!=0) ||
+			    ((this->ports & RADIUS_CLIENT_ACCT) && this->openSocket(address.server, true, j)!=0))
+			{
+				cerr << "RadiusClient: Cannot open sockets to server " << s.server->getName() << ".\n";
+				break;
+			}
+		}
+		if (this->hasSockets(address.server))
+		{
+			this->setState(address.server, RADIUS_SERVER_ALIVE);
+		}
+		return;
+	}
+	s.server->getAddress(&addr, &len, s.server->getAuthPort());
+	for (i=0; i<s.authsockets.size(); i++)
+	{
+		if (connect(s.authsockets[i]->fd, (struct sockaddr *) &addr, len)<0)
+		{
+			cerr << "RadiusClient: Cannot connect to the new address of server " << s.server->getName() << ": " << strerror(errno) << "\n";
+		}
+	}
+	s.server->getAddress(&addr, &len, s.server->getAcctPort());
+	for (i=0; i<s.acctsockets.size(); i++)
+	{
+		if (connect(s.acctsockets[i]->fd, (struct sockaddr *) &addr, len)<0)
+		{
+			cerr << "RadiusClient: Cannot connect to the new address of server " << s.server->getName() << ": " << strerror(errno) << "\n";
+		}
+	}
+}
+
+/** The method returns a monotonic time in microseconds.
+ * @return The time in microseconds.
+ */
+long long RadiusClient::now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((long long) ts.tv_sec)*1000000 + ts.tv_nsec/1000;
+}
+
+/** The method opens a UDP socket of the pool of a server
+ * and adds it to the event loop.
+ * @param index The index of the server.
+ * @param acct True for the accounting port, false for the authentication port.
+ * @param pos The position of the socket in the pool of the server.
+ * @return 0 if everything is ok, else the error of RadiusServer::openSocket().
+ */
+int RadiusClient::openSocket(unsigned int index, bool acct, int pos)
+{
+	RadiusClientSocket * sock;
+	int fd, i;
+
+	//the server opens the socket with its source address and port
+	if ((fd=this->servers[index].server->openSocket(acct, pos))<0)
+	{
+		return fd;
+	}
+
+	sock=new RadiusClientSocket;
+	sock->fd=fd;
+	sock->server=index;
+	sock->inuse=0;
+	sock->freehead=0;
+	for (i=0; i<RADIUS_CLIENT_IDENTIFIERS; i++)
+	{
+		sock->freeids[i]=i;
+	}
+	memset(sock->outstanding, 0, sizeof(sock->outstanding));
+
+#ifdef __linux__
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events=EPOLLIN;
+	ev.data.ptr=sock;
+	epoll_ctl(this->pollfd, EPOLL_CTL_ADD, fd, &ev);
+#endif
+	if (acct)
+	{
+		this->servers[index].acctsockets.push_back(sock);
+	}
+	else
+	{
+		this->servers[index].authsockets.push_back(sock);
+	}
+	return 0;
+}
+
+/** The method closes all sockets and descriptors of the client.*/
+void RadiusClient::closeSockets(void)
+{
+	unsigned int i, j;
+	for (i=0; i<this->servers.size(); i++)
+	{
+		for (j=0; j<this->servers[i].authsockets.size(); j++)
+		{
+			close(this->servers[i].authsockets[j]->fd);
+			delete this->servers[i].authsockets[j];
+		}
+		for (j=0; j<this->servers[i].acctsockets.size(); j++)
+		{
+			close(this->servers[i].acctsockets[j]->fd);
+			delete this->servers[i].acctsockets[j];
+		}
+	}
+	this->servers.clear();
+	if (this->pollfd>=0)
+	{
+		close(this->pollfd);
+		this->pollfd=-1;
+	}
+	if (this->wakeup[0]>=0)
+	{
+		close(this->wakeup[0]);
+		close(this->wakeup[1]);
+		this->wakeup[0]=-1;
+		this->wakeup[1]=-1;
+	}
+}
+
+/** The method checks if a server has sockets to the ports the client uses.
+ * @param index The index of the server.
+ * @return True if the sockets are open.
+ */
+bool RadiusClient::hasSockets(unsigned int index)
+{
+	return ((this->ports & RADIUS_CLIENT_AUTH)==0 || !this->servers[index].authsockets.empty()) &&
+		((this->ports & RADIUS_CLIENT_ACCT)==0 || !this->servers[index].acctsockets.empty());
+}
+
+/** The method checks if a server takes part in the balancing.
+ * @param index The index of the server.
+ * @return True if the server is alive and has a weight.
+ */
+bool RadiusClient::isCandidate(unsigned int index)
+{
+	return this->servers[index].state==RADIUS_SERVER_ALIVE && this->servers[index].server->getWeight()>0;
+}
+
+/** The method chooses the first server of a new request with the balancing
+ * policy of the client. Only the servers which are alive and have a weight are
+ * chosen, if there is none the request starts at the first server. From the chosen
+ * server the request fails over to the following servers, after the last server
+ * comes the first one.
+ * The hash policy chooses the server with rendezvous hashing: every server gets a
+ * score from a hash of its name, its ports and the User-Name of the packet, scaled by its weight,
+ * and the highest score wins. A user stays on its server as long as the server is
+ * alive and only the users of a server which fails move to other servers.
+ * @param packet The packet of the request.
+ * @return The index of the server.
+ */
+unsigned int RadiusClient::choose(RadiusPacket * packet)
+{
+	unsigned int n=this->servers.size(), best=n, i, k;
+	unsigned long long h;
+	long long total=0;
+	double score, bestscore=0;
+	const string * name;
+	int pos;
+
+	if (this->balance==RADIUS_BALANCE_FAILOVER || n<2)
+	{
+		return 0;
+	}
+	switch (this->balance)
+	{
+	case RADIUS_BALANCE_HASH:
+		//find the User-Name in the send buffer, a packet without one is balanced round robin
+		for (pos=RADIUS_PACKET_HEADER_LEN; pos+1<packet->sendbufferlen; pos+=packet->sendbuffer[pos+1])
+		{
+			if (packet->sendbuffer[pos]==ATTRIB_User_Name)
+			{
+				break;
+			}
+		}
+		if (pos+1>=packet->sendbufferlen)
+		{
+			break;
+		}
+		for (i=0; i<n; i++)
+		{
+			if (!this->isCandidate(i))
+			{
+				continue;
+			}
+			//FNV-1a over the name and the ports of the server and the username, mixed with the finalizer of SplitMix64
+			h=14695981039346656037ULL;
+			name=&this->servers[i].server->getName();
+			for (k=0; k<name->size(); k++)
+			{
+				h=(h ^ (Octet) (*name)[k]) * 1099511628211ULL;
+			}
+			h=(h ^ (unsigned int) this->servers[i].server->getAuthPort()) * 1099511628211ULL;
+			h=(h ^ (unsigned int) this->servers[i].server->getAcctPort()) * 1099511628211ULL;
+			for (k=2; k<packet->sendbuffer[pos+1]; k++)
+			{
+				h=(h ^ packet->sendbuffer[pos+k]) * 1099511628211ULL;
+			}
+			h=(h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			h=(h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+			h=h ^ (h >> 31);
+			//the hash as a number in (0,1), -weight/ln(u) is the weighted score
+			score=-this->servers[i].server->getWeight()/log(((h >> 11) + 0.5)/9007199254740992.0);
+			if (best==n || score>bestscore)
+			{
+				best=i;
+				bestscore=score;
+			}
+		}
+		return (best<n) ? best : 0;
+
+	case RADIUS_BALANCE_WEIGHTED:
+		//smooth weighted round robin, the servers with a high weight don't get their requests in a row
+		for (i=0; i<n; i++)
+		{
+			if (!this->isCandidate(i))
+			{
+				continue;
+			}
+			this->servers[i].credit+=this->servers[i].server->getWeight();
+			total+=this->servers[i].server->getWeight();
+			if (best==n || this->servers[i].credit>this->servers[best].credit)
+			{
+				best=i;
+			}
+		}
+		if (best<n)
+		{
+			this->servers[best].credit-=total;
+		}
+		return (best<n) ? best : 0;
+
+	case RADIUS_BALANCE_LEASTOUTSTANDING:
+		//the fewest outstanding requests per weight, the search starts at another server every time for the ties
+		for (k=0; k<n; k++)
+		{
+			i=(this->nextserver+k)%n;
+			if (this->isCandidate(i) && (best==n ||
+				(long long) this->servers[i].outstanding*this->servers[best].server->getWeight() <
+				(long long) this->servers[best].outstanding*this->servers[i].server->getWeight()))
+			{
+				best=i;
+			}
+		}
+		this->nextserver=(this->nextserver+1)%n;
+		return (best<n) ? best : 0;
+	}
+
+	//round robin
+	for (k=0; k<n; k++)
+	{
+		i=(this->nextserver+k)%n;
+		if (this->isCandidate(i))
+		{
+			this->nextserver=(i+1)%n;
+			return i;
+		}
+	}
+	return 0;
+}
+
+/** The method gives the request an identifier on a socket of its current
+ * server and sends it. If all identifiers of the sockets are in use, a new
+ * socket is opened up to RadiusServer::getMaxSockets(), else the request waits.
+ * The request waits too while the client has the maximum number of outstanding requests.
+ * If there are no more servers, the request is finished with NO_RESPONSE.
+ * @param request The request.
+ */
+void RadiusClient::dispatch(RadiusClientRequest * request)
+{
+	RadiusClientSocket * sock;
+	RadiusServer * server;
+	unsigned int i;
+	bool acct;
+
+	while (request->attempt < this->servers.size())
+	{
+		request->server=(request->first + request->attempt) % this->servers.size();
+		//a server which doesn't answer is skipped while a later server is alive
+		if (!request->probe && this->servers[request->server].state!=RADIUS_SERVER_ALIVE &&
+			this->isAlive(request))
+		{
+			request->attempt++;
+			continue;
+		}
+		//the probes of the accounting client go to the accounting port
+		acct=(request->packet->code==ACCOUNTING_REQUEST ||
+			(request->probe && (this->ports & RADIUS_CLIENT_AUTH)==0));
+		vector<RadiusClientSocket *> &sockets = acct ?
+			this->servers[request->server].acctsockets : this->servers[request->server].authsockets;
+		server=this->servers[request->server].server;
+
+		//the probes don't count for the limit, they must find out if the server answers
+		if (!request->probe && this->maxoutstanding>0 && this->outstanding>=this->maxoutstanding)
+		{
+			this->waiting.push_back(request);
+			return;
+		}
+		//use the socket with the fewest outstanding requests
+		sock=NULL;
+		for (i=0; i<sockets.size(); i++)
+		{
+			if (sockets[i]->inuse < RADIUS_CLIENT_IDENTIFIERS && (sock==NULL || sockets[i]->inuse < sock->inuse))
+			{
+				sock=sockets[i];
+			}
+		}
+		if (sockets.empty() && request->probe)
+		{
+			break;
+		}
+		if (sockets.empty())
+		{
+			//the server is not reachable, try the next one
+			request->attempt++;
+			continue;
+		}
+		//all identifiers are in use, spill to a new socket
+		if (sock==NULL && (int) sockets.size() < server->getMaxSockets() &&
+			this->openSocket(request->server, acct, sockets.size())==0)
+		{
+			sock=sockets.back();
+		}
+		if (sock==NULL && request->probe)
+		{
+			break;
+		}
+		if (sock==NULL)
+		{
+			this->waiting.push_back(request);
+			return;
+		}
+		//take the identifier which is free for the longest time
+		request->socket=sock;
+		request->identifier=sock->freeids[sock->freehead++];
+		sock->outstanding[request->identifier]=request;
+		sock->inuse++;
+		this->servers[request->server].outstanding++;
+		this->outstanding++;
+		request->tries=0;
+		this->transmit(request);
+		return;
+	}
+	this->finish(request, NO_RESPONSE);
+}
+
+/** The method sends a request. The first transmission to a server shapes
+ * the packet with the identifier of the request and the secret of the server,
+ * the accounting requests are only shaped, they are signed and sent together by sign().
+ * A retransmission sends the same bytes again with the same identifier and
+ * authenticator (RFC 2865), so a late response to an earlier transmission
+ * is accepted too.
+ * @param request The request.
+ */
+void RadiusClient::transmit(RadiusClientRequest * request)
+{
+	RadiusPacket * packet=request->packet;
+	RadiusServer * server=this->servers[request->server].server;
+
+	if (request->tries==0)
+	{
+		packet->identifier=request->identifier;
+		if (packet->shapeRadiusPacket(server)!=0)
+		{
+			this->release(request);
+			this->finish(request, SHAPE_ERROR);
+			return;
+		}
+	}
+	request->tries++;
+	this->setTimer(request);
+	if (request->tries==1 && packet->code==ACCOUNTING_REQUEST)
+	{
+		this->signing.push_back(request);
+		return;
+	}
+	this->sendRequest(request);
+}
+
+/** The method signs the accounting requests which were shaped since the
+ * last call and sends them. The authenticators of all requests to the
+ * same server are computed in one batch with Md5::digests().
+ */
+void RadiusClient::sign(void)
+{
+	vector<RadiusPacket *> packets;
+	unsigned int i, j, server;
+
+	for (i=0; i<this->signing.size(); i++)
+	{
+		if (this->signing[i]==NULL)
+		{
+			continue;
+		}
+		//take all requests to the server of the first one
+		server=this->signing[i]->server;
+		packets.clear();
+		for (j=i; j<this->signing.size(); j++)
+		{
+			if (this->signing[j]!=NULL && this->signing[j]->server==server)
+			{
+				packets.push_back(this->signing[j]->packet);
+			}
+		}
+		RadiusPacket::calcacctdigests(&packets[0], packets.size(),
+			this->servers[server].server->getSharedSecret().c_str());
+		for (j=i; j<this->signing.size(); j++)
+		{
+			if (this->signing[j]!=NULL && this->signing[j]->server==server)
+			{
+				this->sendRequest(this->signing[j]);
+				this->signing[j]=NULL;
+			}
+		}
+	}
+	this->signing.clear();
+}
+
+/** The method sends the shaped packet of a request to its socket.
+ * @param request The request.
+ */
+void RadiusClient::sendRequest(RadiusClientRequest * request)
+{
+	RadiusServer * server=this->servers[request->server].server;
+
+	if (::send(request->socket->fd, request->packet->sendbuffer, request->packet->sendbufferlen, 0)<0)
+	{
+		//the packet is sent again when the timer expires
+		cerr << "RadiusClient: Packet was not sent to " << server->getName() << ": " << strerror(errno) << "\n";
+	}
+}
+
+/** The method frees the identifier of the request.
+ * @param request The request.
+ */
+void RadiusClient::release(RadiusClientRequest * request)
+{
+	RadiusClientSocket * sock=request->socket;
+
+	if (sock)
+	{
+		//the identifier goes to the end of the ring
+		sock->outstanding[request->identifier]=NULL;
+		sock->freeids[(Octet) (sock->freehead + RADIUS_CLIENT_IDENTIFIERS - sock->inuse)]=request->identifier;
+		sock->inuse--;
+		this->servers[sock->server].outstanding--;
+		this->outstanding--;
+		request->socket=NULL;
+	}
+}
+
+/** The method calls the callback of the request and deletes the request.
+ * The waiting requests get the freed identifier in the next iteration of the
+ * event loop, so finish() and dispatch() never call each other recursively.
+ * @param request The request.
+ * @param result The result for the callback.
+ */
+void RadiusClient::finish(RadiusClientRequest * request, int result)
+{
+	if (request->probe)
+	{
+		//a probe is not submitted, it belongs to the client
+		this->probed(request->server, result==0);
+		delete request->packet;
+		delete request;
+	}
+	else
+	{
+		request->callback->complete(request->packet, result);
+		delete request;
+
+		pthread_mutex_lock(&this->mutex);
+		if (--this->unfinished == 0)
+		{
+			pthread_cond_broadcast(&this->finished);
+		}
+		pthread_mutex_unlock(&this->mutex);
+	}
+	this->retrywaiting=true;
+}
+
+/** The method dispatches the waiting requests again if an identifier was freed
+ * since the last call. Every waiting request gets one chance, if there is still no
+ * identifier it waits again. A request which is finished by dispatch() frees no
+ * identifier, but it may lift the limit of outstanding requests, so the list is tried
+ * again until a pass finishes no request.
+ */
+void RadiusClient::dispatchWaiting(void)
+{
+	RadiusClientRequest * next;
+	unsigned int n;
+
+	while (this->retrywaiting)
+	{
+		this->retrywaiting=false;
+		n=this->waiting.size();
+		while (n-- > 0 && !this->waiting.empty())
+		{
+			next=this->waiting.front();
+			this->waiting.pop_front();
+			this->dispatch(next);
+			if (!this->waiting.empty() && this->waiting.back()==next)
+			{
+				break;
+			}
+		}
+	}
+}
+
+/** The method sends the request to the next server. The freed identifier
+ * goes to the waiting requests in the next iteration of the event loop.
+ * @param request The request.
+ */
+void RadiusClient::failover(RadiusClientRequest * request)
+{
+	this->release(request);
+	this->retrywaiting=true;
+	request->attempt++;
+	this->dispatch(request);
+}
+
+/** The method reads all datagrams from a socket. A datagram is the response
+ * to the outstanding request with the same identifier, if the response authenticator
+ * is correct. Other datagrams are dropped.
+ * @param sock The socket.
+ */
+void RadiusClient::receive(RadiusClientSocket * sock)
+{
+	RadiusClientRequest * request;
+	RadiusPacket * packet;
+	RadiusServer * server=this->servers[sock->server].server;
+	ssize_t len;
+	int plen;
+
+	while (1)
+	{
+		len=recv(sock->fd, this->recvbuffer, RADIUS_MAX_PACKET_LEN, 0);
+		if (len<0)
+		{
+			if (errno==EINTR || errno==ECONNREFUSED)
+			{
+				continue;
+			}
+			break;
+		}
+		if (len<20)
+		{
+			continue;
+		}
+		plen=(this->recvbuffer[2]<<8) | this->recvbuffer[3];
+		if (plen<20 || plen>len)
+		{
+			continue;
+		}
+		request=sock->outstanding[this->recvbuffer[1]];
+		if (request==NULL)
+		{
+			//a late response, the request is already finished
+			continue;
+		}
+		packet=request->packet;
+		//the response is checked in the buffer of the client, a forged one never reaches the packet
+		if (RadiusPacket::verifyResponse(this->recvbuffer, plen, packet->sendbuffer+4,
+			server->getSharedSecret().c_str())!=0)
+		{
+			cerr << "RadiusClient: Response with a wrong authenticator from " << server->getName() << " dropped.\n";
+			continue;
+		}
+		memcpy(packet->recvbuffer, this->recvbuffer, plen);
+		packet->recvbufferlen=plen;
+		//only the responses to packets which were not retransmitted are measured
+		if (request->tries==1)
+		{
+			this->updateRto(this->servers[sock->server], now()-request->sent);
+		}
+		this->setState(sock->server, RADIUS_SERVER_ALIVE);
+		this->cancelTimer(request);
+		this->release(request);
+		if (packet->unShapeRadiusPacket()!=0)
+		{
+			this->finish(request, UNSHAPE_ERROR);
+		}
+		else
+		{
+			this->finish(request, 0);
+		}
+	}
+}
+
+/** The method handles the expired timers. The packet is sent again
+ * as long as the server has retries left, then the next server is tried.
+ */
+void RadiusClient::expire(void)
+{
+	RadiusClientRequest * request;
+	long long t=now();
+
+	while (!this->timers.empty() && this->timers.begin()->first <= t)
+	{
+		request=this->timers.begin()->second;
+		this->cancelTimer(request);
+		if (request->probe)
+		{
+			//a Status-Server packet is not retransmitted (RFC 5997)
+			this->release(request);
+			this->finish(request, NO_RESPONSE);
+		}
+		else if (request->tries <= this->servers[request->server].server->getRetry())
+		{
+			this->transmit(request);
+		}
+		else
+		{
+			//the server didn't answer, it is probed until it answers again
+			if (this->servers[request->server].state==RADIUS_SERVER_ALIVE)
+			{
+				this->setState(request->server, RADIUS_SERVER_ZOMBIE);
+			}
+			this->failover(request);
+		}
+	}
+}
+
+/** The method sets the retransmit timer of a request. The timeout is the
+ * retransmission timeout of the server, it is doubled for every retransmission
+ * of the request up to the maxrto of the server and varied by up to 25%,
+ * so the retransmissions of many requests do not arrive at the same time.
+ * @param request The request.
+ */
+void RadiusClient::setTimer(RadiusClientRequest * request)
+{
+	RadiusClientServer &s=this->servers[request->server];
+	long long timeout=s.rto, max=((long long) s.server->getMaxRto())*1000;
+	unsigned short jitter=0;
+	long long deadline;
+	int i;
+
+	for (i=1; i<request->tries && timeout<max; i++)
+	{
+		timeout*=2;
+	}
+	if (timeout>max)
+	{
+		timeout=max;
+	}
+	RadiusRandom::random((Octet *) &jitter, sizeof(jitter));
+	timeout=timeout*3/4 + timeout*jitter/(2*65536);
+	request->sent=now();
+	deadline=request->sent + timeout;
+	this->cancelTimer(request);
+	request->timer=this->timers.insert(make_pair(deadline, request));
+	request->timerset=true;
+}
+
+/** The method cancels the retransmit timer of a request.
+ * @param request The request.
+ */
+void RadiusClient::cancelTimer(RadiusClientRequest * request)
+{
+	if (request->timerset)
+	{
+		this->timers.erase(request->timer);
+		request->timerset=false;
+	}
+}
+
+/** The method checks if a server after the current server of a request is alive.
+ * @param request The request.
+ * @return True if one of the servers the request fails over to is alive.
+ */
+bool RadiusClient::isAlive(RadiusClientRequest * request)
+{
+	unsigned int k;
+
+	for (k=request->attempt+1; k<this->servers.size(); k++)
+	{
+		if (this->servers[(request->first + k) % this->servers.size()].state==RADIUS_SERVER_ALIVE)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/** The method changes the state of a server. A server which didn't answer
+ * a request after all retries is a zombie, it is probed at once and after every
+ * maxrto. After RADIUS_CLIENT_ZOMBIE_PROBES unanswered probes it is dead and
+ * probed every status interval. Every response makes it alive again.
+ * @param index The index of the server.
+ * @param state RADIUS_SERVER_ALIVE, RADIUS_SERVER_ZOMBIE or RADIUS_SERVER_DEAD.
+ */
+void RadiusClient::setState(unsigned int index, int state)
+{
+	RadiusClientServer &s=this->servers[index];
+	static const char * names[]={"alive", "a zombie", "dead"};
+
+	if (s.state==state)
+	{
+		return;
+	}
+	cerr << "RadiusClient: Server " << s.server->getName() << " is " << names[state] << ".\n";
+	s.state=state;
+	s.failedprobes=0;
+	if (state==RADIUS_SERVER_ZOMBIE && s.server->getStatusServer())
+	{
+		s.nextprobe=now();
+	}
+	else
+	{
+		s.nextprobe=now()+((long long) s.server->getStatusInterval())*1000000;
+	}
+}
+
+/** The method sends a Status-Server packet (RFC 5997) to every server which
+ * doesn't answer and whose probe is due. A server which is not probed with
+ * Status-Server is alive again when the probe is due.
+ */
+void RadiusClient::probe(void)
+{
+	RadiusClientRequest * request;
+	RadiusPacket * packet;
+	long long t=now();
+	unsigned int i;
+
+	for (i=0; i<this->servers.size(); i++)
+	{
+		RadiusClientServer &s=this->servers[i];
+		if (s.state==RADIUS_SERVER_ALIVE || s.probing || s.nextprobe>t)
+		{
+			continue;
+		}
+		if (!s.server->getStatusServer())
+		{
+			this->setState(i, RADIUS_SERVER_ALIVE);
+			continue;
+		}
+		packet=new RadiusPacket(STATUS_SERVER);
+		packet->addMessageAuthenticator();
+		request=new RadiusClientRequest;
+		request->packet=packet;
+		request->callback=NULL;
+		request->server=i;
+		request->first=i;
+		request->attempt=0;
+		request->tries=0;
+		request->socket=NULL;
+		request->identifier=0;
+		request->timerset=false;
+		request->probe=true;
+		s.probing=true;
+		this->dispatch(request);
+	}
+}
+
+/** The method handles the result of a probe.
+ * @param index The index of the server.
+ * @param answered True if the server answered the probe.
+ */
+void RadiusClient::probed(unsigned int index, bool answered)
+{
+	RadiusClientServer &s=this->servers[index];
+
+	s.probing=false;
+	if (answered)
+	{
+		this->setState(index, RADIUS_SERVER_ALIVE);
+		return;
+	}
+	if (s.state==RADIUS_SERVER_ZOMBIE && ++s.failedprobes>=RADIUS_CLIENT_ZOMBIE_PROBES)
+	{
+		this->setState(index, RADIUS_SERVER_DEAD);
+		return;
+	}
+	if (s.state==RADIUS_SERVER_ZOMBIE)
+	{
+		s.nextprobe=now()+((long long) s.server->getMaxRto())*1000;
+	}
+	else
+	{
+		s.nextprobe=now()+((long long) s.server->getStatusInterval())*1000000;
+	}
+}
+
+/** The method updates the retransmission timeout of a server with the round
+ * trip time of a response, like TCP does (RFC 6298). The timeout is the smoothed
+ * round trip time plus four times its variation, within the minrto and the
+ * maxrto of the server.
+ * @param s The server.
+ * @param rtt The round trip time in microseconds.
+ */
+void RadiusClient::updateRto(RadiusClientServer &s, long long rtt)
+{
+	long long delta;
+
+	if (s.srtt<0)
+	{
+		s.srtt=rtt;
+		s.rttvar=rtt/2;
+	}
+	else
+	{
+		delta=(s.srtt>rtt) ? s.srtt-rtt : rtt-s.srtt;
+		s.rttvar=(3*s.rttvar + delta)/4;
+		s.srtt=(7*s.srtt + rtt)/8;
+	}
+	s.rto=s.srtt + ((4*s.rttvar > 1000) ? 4*s.rttvar : 1000);
+	if (s.rto < ((long long) s.server->getMinRto())*1000)
+	{
+		s.rto=((long long) s.server->getMinRto())*1000;
+	}
+	if (s.rto > ((long long) s.server->getMaxRto())*1000)
+	{
+		s.rto=((long long) s.server->getMaxRto())*1000;
+	}
+}
+
+/** The method returns the time until the next timer expires.
+ * @return The time in milliseconds, -1 if there is no timer.
+ */
+int RadiusClient::nextTimeout(void)
+{
+	long long t=-1;
+	unsigned int i;
+
+	if (!this->timers.empty())
+	{
+		t=this->timers.begin()->first;
+	}
+	//the next probe of a server which doesn't answer
+	for (i=0; i<this->servers.size(); i++)
+	{
+		if (this->servers[i].state!=RADIUS_SERVER_ALIVE && !this->servers[i].probing &&
+			(t<0 || this->servers[i].nextprobe<t))
+		{
+			t=this->servers[i].nextprobe;
+		}
+	}
+	if (t<0)
+	{
+		return -1;
+	}
+	t=t - now();
+	if (t<0)
+	{
+		return 0;
+	}
+	//the timer must not fire before the deadline
+	return (int) ((t+999)/1000);
+}
@@ -0,0 +1,202 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _RADIUSCLIENT_H_
+#define _RADIUSCLIENT_H_
+
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "error.h"
+#include "radius.h"
+#include "RadiusPacket.h"
+#include "RadiusServer.h"
+#include "RadiusConfig.h"
+#include "RadiusRandom.h"
+
+using namespace std;
+
+#define RADIUS_CLIENT_AUTH		1	/**<The client sends to the authentication ports.*/
+#define RADIUS_CLIENT_ACCT		2	/**<The client sends to the accounting ports.*/
+#define RADIUS_CLIENT_IDENTIFIERS	256	/**<The number of identifiers, the identifier is one octet.*/
+#define RADIUS_CLIENT_MAX_EVENTS	64	/**<The maximum number of events handled per loop.*/
+#define RADIUS_CLIENT_ZOMBIE_PROBES	3	/**<The number of unanswered probes after which a zombie server is dead.*/
+#define RADIUS_CLIENT_RESOLVE_RETRY	10	/**<The seconds after which a name which was never resolved is tried again.*/
+
+#define RADIUS_SERVER_ALIVE		0	/**<The server answers.*/
+#define RADIUS_SERVER_ZOMBIE	1	/**<The server didn't answer a request after all retries, it is probed.*/
+#define RADIUS_SERVER_DEAD		2	/**<The server didn't answer the probes either, it is probed every status interval.*/
+
+/** The interface for the completion of an asynchronous request of the
+ * RadiusClient. The method is called from the thread of the client, so it
+ * must not block.
+ */
+class RadiusRequestCallback
+{
+public:
+	virtual ~RadiusRequestCallback() {}
+	/** The method is called when the request is finished.
+	 * @param packet The packet of the request, if result is 0 it contains the response.
+	 * @param result 0 if a response was received, else NO_RESPONSE or SHAPE_ERROR.
+	 */
+	virtual void complete(RadiusPacket *packet, int result)=0;
+};
+
+struct RadiusClientSocket;
+
+/** A request which is handled by the RadiusClient.*/
+struct RadiusClientRequest
+{
+	RadiusPacket *			packet;		/**<The packet to send, the response is written into it.*/
+	RadiusRequestCallback *	callback;	/**<The callback which is called when the request is finished.*/
+	unsigned int			server;		/**<The index of the server the request is sent to.*/
+	unsigned int			first;		/**<The index of the server the balancing chose, the request fails over to the following servers.*/
+	unsigned int			attempt;	/**<The number of servers after the first one which were tried.*/
+	int						tries;		/**<The number of transmissions to the current server.*/
+	long long				sent;		/**<The time of the last transmission in microseconds.*/
+	RadiusClientSocket *	socket;		/**<The socket which holds the identifier of the request, NULL if none.*/
+	Octet					identifier;	/**<The identifier of the request on the socket.*/
+	multimap<long long, RadiusClientRequest *>::iterator timer; /**<The retransmit timer of the request.*/
+	bool					timerset;	/**<True if the timer is set.*/
+	bool					probe;		/**<True for a Status-Server probe of the client, it has no callback.*/
+};
+
+/** A long-lived UDP socket connected to one port of a radius server. Up to
+ * 256 requests are outstanding on a socket, they are found by the identifier.
+ * The free identifiers are kept in a ring in the order they were released, so
+ * an identifier is used again as late as possible and a late response to it
+ * is dropped.*/
+struct RadiusClientSocket
+{
+	int						fd;			/**<The socket.*/
+	unsigned int			server;		/**<The index of the server.*/
+	int						inuse;		/**<The number of outstanding requests.*/
+	Octet					freehead;	/**<The position of the next free identifier in the ring, it wraps at 256.*/
+	Octet					freeids[RADIUS_CLIENT_IDENTIFIERS]; /**<The ring of the free identifiers, 256-inuse from freehead.*/
+	RadiusClientRequest *	outstanding[RADIUS_CLIENT_IDENTIFIERS]; /**<The outstanding requests by identifier.*/
+};
+
+/** The state of a radius server in the RadiusClient.*/
+struct RadiusClientServer
+{
+	RadiusServer *				server;		/**<The server from the configuration.*/
+	long long					srtt;		/**<The smoothed round trip time in microseconds, -1 before the first response.*/
+	long long					rttvar;		/**<The variation of the round trip time in microseconds.*/
+	long long					rto;		/**<The retransmission timeout in microseconds.*/
+	int							state;		/**<RADIUS_SERVER_ALIVE, RADIUS_SERVER_ZOMBIE or RADIUS_SERVER_DEAD.*/
+	int							failedprobes; /**<The number of unanswered probes in the current state.*/
+	bool						probing;	/**<True if a probe is outstanding.*/
+	long long					nextprobe;	/**<The time of the next probe in microseconds.*/
+	int							outstanding; /**<The number of requests which hold an identifier on a socket of the server.*/
+	long long					credit;		/**<The credit of the server for the weighted balancing.*/
+	vector<RadiusClientSocket *>	authsockets;	/**<The sockets to the authentication port.*/
+	vector<RadiusClientSocket *>	acctsockets;	/**<The sockets to the accounting port.*/
+};
+
+/** A new address of a radius server, found by the resolver thread.*/
+struct RadiusClientAddress
+{
+	unsigned int			server;		/**<The index of the server.*/
+	struct sockaddr_storage	address;	/**<The address, the port is not set.*/
+	socklen_t				len;		/**<The length of the address.*/
+};
+
+/** The class implements an event driven radius client. A thread
+ * waits with epoll for responses on long-lived UDP sockets and for the
+ * retransmit timers, the requests are matched to the responses by the identifier
+ * and the response authenticator. Many requests can be outstanding at the same time,
+ * the threads which submit the requests don't wait on the network.
+ * The requests are spread over the servers with a balancing policy.
+ */
+class RadiusClient
+{
+private:
+	vector<RadiusClientServer>	servers;	/**<The radius servers in the order of priority.*/
+	list<RadiusServer> *		serverlist;	/**<The server list the client was started with.*/
+	list<RadiusClientRequest *>	submitted;	/**<Requests which were submitted but are not handled by the thread so far.*/
+	list<RadiusClientRequest *>	waiting;	/**<Requests which wait for a free identifier or below the limit of outstanding requests.*/
+	vector<RadiusClientRequest *>	signing;	/**<Accounting requests which are shaped but not signed and sent so far.*/
+	list<RadiusClientAddress>	resolved;	/**<Addresses which were resolved again but are not applied by the thread so far.*/
+	multimap<long long, RadiusClientRequest *> timers; /**<The retransmit timers by deadline in microseconds.*/
+	pthread_mutex_t				mutex;		/**<Protects the submitted list, the counter of unfinished requests and the stop flag.*/
+	pthread_cond_t				finished;	/**<Signals that the last unfinished request is finished.*/
+	int							unfinished;	/**<The number of submitted requests whose callback was not called so far.*/
+	pthread_t					thread;		/**<The thread of the event loop.*/
+	pthread_t					resolver;	/**<The thread which resolves the names of the servers again.*/
+	pthread_cond_t				resolvewait; /**<Wakes up the resolver thread when the client stops.*/
+	bool						resolving;	/**<True if the resolver thread is running.*/
+	int							ports;		/**<The ports the client sends to, RADIUS_CLIENT_AUTH and/or RADIUS_CLIENT_ACCT.*/
+	int							balance;	/**<How the requests are spread over the servers, one of RADIUS_BALANCE_*.*/
+	unsigned int				nextserver;	/**<The server where the search of the round robin starts.*/
+	int							maxoutstanding; /**<The maximum number of requests which hold an identifier, 0 for no limit.*/
+	int							outstanding; /**<The number of requests which hold an identifier.*/
+	bool						retrywaiting; /**<True if an identifier was freed, the waiting requests are dispatched again.*/
+	int							pollfd;		/**<The epoll descriptor.*/
+	int							wakeup[2];	/**<A pipe to wake up the event loop.*/
+	bool						running;	/**<True if the thread is running.*/
+	bool						stopping;	/**<True if the thread should exit.*/
+	Octet						recvbuffer[RADIUS_MAX_PACKET_LEN]; /**<The buffer for received datagrams.*/
+
+	static void *	loop(void *);
+	static void *	resolve(void *);
+	static long long now(void);
+	int				openSocket(unsigned int, bool, int);
+	void			closeSockets(void);
+	void			setAddress(RadiusClientAddress &);
+	unsigned int	choose(RadiusPacket *);
+	bool			hasSockets(unsigned int);
+	bool			isCandidate(unsigned int);
+	void			dispatch(RadiusClientRequest *);
+	void			dispatchWaiting(void);
+	void			transmit(RadiusClientRequest *);
+	void			sign(void);
+	void			sendRequest(RadiusClientRequest *);
+	void			release(RadiusClientRequest *);
+	void			finish(RadiusClientRequest *, int);
+	void			failover(RadiusClientRequest *);
+	void			receive(RadiusClientSocket *);
+	void			expire(void);
+	void			setTimer(RadiusClientRequest *);
+	void			updateRto(RadiusClientServer &, long long);
+	bool			isAlive(RadiusClientRequest *);
+	void			setState(unsigned int, int);
+	void			probe(void);
+	void			probed(unsigned int, bool);
+	void			cancelTimer(RadiusClientRequest *);
+	int				nextTimeout(void);
+
+public:
+	RadiusClient(void);
+	~RadiusClient(void);
+
+	int		start(list<RadiusServer> *, int, int balance=RADIUS_BALANCE_FAILOVER, int maxoutstanding=0);
+	void	stop(void);
+	bool	isRunning(void);
+
+	int		send(RadiusPacket *);
+	int		submit(RadiusPacket *, RadiusRequestCallback *, bool wake=true);
+	void	wakeUp(void);
+	void	flush(void);
+};
+
+#endif //_RADIUSCLIENT_H_
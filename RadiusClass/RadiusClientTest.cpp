@@ -0,0 +1,704 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Test of the event driven radius client against radius servers on the
+ * loopback interface. The servers are UDP sockets of the test, it reads the
+ * requests and writes the responses itself, so every response is sent
+ * exactly when a check needs it. The checks cover:
+ * - the matching of the responses by identifier and response authenticator,
+ * - the free ring of the identifiers, an identifier is used again only after
+ *   all others, and a late response to its earlier request is dropped,
+ * - the spill to a new socket when all identifiers of a socket are in use,
+ * - the retransmission of the same bytes when the timer expires,
+ * - the retransmission timeout, it follows the round trip time after the first response,
+ * - the failover to the second server and NO_RESPONSE after all retries.
+ *
+ * Build and run it with: make check
+ */
+
+#include "RadiusClient.h"
+#include "RadiusAttribute.h"
+#include "Md5.h"
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <poll.h>
+#include <sys/time.h>
+
+using namespace std;
+
+#define TEST_SECRET		"testing123"	/**<The shared secret of the first server.*/
+#define TEST_SECRET2	"secret2"		/**<The shared secret of the second server.*/
+#define TEST_TIMEOUT	3000			/**<The time in milliseconds a check waits for a request or a result.*/
+
+/** A callback which saves the result of a request, the test waits for it.*/
+class TestCallback : public RadiusRequestCallback
+{
+private:
+	pthread_mutex_t	mutex;		/**<Protects the result.*/
+	pthread_cond_t	cond;		/**<Signals the result.*/
+	bool			done;		/**<True if the request is finished.*/
+	int				result;		/**<The result of the request.*/
+
+public:
+	TestCallback(void)
+	{
+		pthread_mutex_init(&this->mutex, NULL);
+		pthread_cond_init(&this->cond, NULL);
+		this->done=false;
+		this->result=0;
+	}
+
+	~TestCallback(void)
+	{
+		pthread_cond_destroy(&this->cond);
+		pthread_mutex_destroy(&this->mutex);
+	}
+
+	void complete(RadiusPacket * packet, int result)
+	{
+		pthread_mutex_lock(&this->mutex);
+		this->result=result;
+		this->done=true;
+		pthread_cond_signal(&this->cond);
+		pthread_mutex_unlock(&this->mutex);
+	}
+
+	/** Waits for the result.
+	 * @param ms The time to wait in milliseconds.
+	 * @param result The result is written into it.
+	 * @return False if the request is not finished in time.
+	 */
+	bool wait(int ms, int * result)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec+=ms/1000;
+		deadline.tv_nsec+=(ms%1000)*1000000L;
+		if (deadline.tv_nsec>=1000000000L)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec-=1000000000L;
+		}
+		pthread_mutex_lock(&this->mutex);
+		while (!this->done && pthread_cond_timedwait(&this->cond, &this->mutex, &deadline)==0);
+		*result=this->result;
+		const bool done=this->done;
+		pthread_mutex_unlock(&this->mutex);
+		return done;
+	}
+};
+
+/** A request of the test, the packet with its callback.*/
+struct TestRequest
+{
+	RadiusPacket	packet;		/**<The Access-Request.*/
+	TestCallback	callback;	/**<The callback of the request.*/
+
+	TestRequest(const string &username) : packet(ACCESS_REQUEST)
+	{
+		RadiusAttribute name(ATTRIB_User_Name, username);
+		packet.addRadiusAttribute(&name);
+	}
+};
+
+/** A datagram which the test server received.*/
+struct Datagram
+{
+	Octet				data[RADIUS_MAX_PACKET_LEN];	/**<The datagram.*/
+	int					len;		/**<The length of the datagram.*/
+	struct sockaddr_in	from;		/**<The address of the client socket.*/
+};
+
+/** Returns the time in milliseconds.*/
+static long long now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((long long) tv.tv_sec)*1000 + tv.tv_usec/1000;
+}
+
+/** Opens a server socket on the loopback interface.
+ * @param port The port of the socket is written into it.
+ * @return The socket, -1 in case of error.
+ */
+static int openServer(int * port)
+{
+	struct sockaddr_in addr;
+	socklen_t len=sizeof(addr);
+	int fd=socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (fd<0)
+	{
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family=AF_INET;
+	addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+	//the ports of RadiusServer are short int, so the port is taken below 32768
+	for (*port=21812; *port<32768; (*port)++)
+	{
+		addr.sin_port=htons(*port);
+		if (bind(fd, (struct sockaddr *) &addr, len)==0)
+		{
+			return fd;
+		}
+	}
+	close(fd);
+	return -1;
+}
+
+/** Creates a server for the client. The retransmission timeout is kept short,
+ * the name is resolved once and the server is not probed.
+ * @param port The authentication port.
+ * @param secret The shared secret.
+ * @param retry The retries of the server.
+ * @return The server.
+ */
+static RadiusServer makeServer(int port, const char * secret, int retry)
+{
+	RadiusServer server("127.0.0.1", secret, port, port+1, retry, 1);
+	server.setSockets(1);
+	server.setMaxSockets(1);
+	server.setMaxRto(200);
+	server.setStatusServer(false);
+	server.setResolveTtl(0);
+	server.resolve();
+	return server;
+}
+
+/** Reads the next datagram of a server socket.
+ * @param fd The server socket.
+ * @param datagram The datagram is written into it.
+ * @param ms The time to wait in milliseconds.
+ * @return False if no datagram arrived in time.
+ */
+static bool readRequest(int fd, Datagram * datagram, int ms)
+{
+	struct pollfd p;
+	socklen_t len=sizeof(datagram->from);
+
+	p.fd=fd;
+	p.events=POLLIN;
+	if (poll(&p, 1, ms)<=0)
+	{
+		return false;
+	}
+	datagram->len=recvfrom(fd, datagram->data, sizeof(datagram->data), 0,
+						   (struct sockaddr *) &datagram->from, &len);
+	return datagram->len>=RADIUS_PACKET_HEADER_LEN;
+}
+
+/** Drops the datagrams which are left from an earlier check, for example
+ * retransmissions which arrived before the client was stopped.
+ * @param fd The server socket.
+ */
+static void drain(int fd)
+{
+	Datagram datagram;
+	while (readRequest(fd, &datagram, 0));
+}
+
+/** Sends a response without attributes to a request. The response
+ * authenticator is MD5(code+identifier+length+request authenticator+secret).
+ * @param fd The server socket.
+ * @param request The request.
+ * @param code The code of the response.
+ * @param secret The shared secret.
+ * @param corrupt If true the authenticator is wrong.
+ */
+static void sendResponse(int fd, const Datagram &request, Octet code, const char * secret, bool corrupt)
+{
+	Octet response[RADIUS_PACKET_HEADER_LEN];
+	Md5 md5;
+
+	response[0]=code;
+	response[1]=request.data[1];
+	response[2]=0;
+	response[3]=RADIUS_PACKET_HEADER_LEN;
+	memcpy(response+4, request.data+4, RADIUS_PACKET_AUTHENTICATOR_LEN);
+	md5.update(response, RADIUS_PACKET_HEADER_LEN);
+	md5.update(secret, strlen(secret));
+	md5.final(response+4);
+	if (corrupt)
+	{
+		response[4]^=0xff;
+	}
+	sendto(fd, response, sizeof(response), 0, (const struct sockaddr *) &request.from, sizeof(request.from));
+}
+
+/** Returns the value of the User-Name attribute of a request, it is the first attribute.
+ * @param request The request.
+ * @return The username.
+ */
+static string username(const Datagram &request)
+{
+	if (request.len<RADIUS_PACKET_HEADER_LEN+2 || request.data[RADIUS_PACKET_HEADER_LEN]!=ATTRIB_User_Name)
+	{
+		return "";
+	}
+	return string((const char *) request.data+RADIUS_PACKET_HEADER_LEN+2, request.data[RADIUS_PACKET_HEADER_LEN+1]-2);
+}
+
+/** Checks that the responses are matched to their requests by the identifier and
+ * the response authenticator. Three requests are answered in the reverse order,
+ * every request gets another code and a response with a wrong authenticator first.
+ * @param fd The server socket.
+ * @param port The port of the server.
+ * @return The number of errors.
+ */
+static int checkMatching(int fd, int port)
+{
+	static const char * names[]={"accept", "reject", "challenge"};
+	static const Octet codes[]={ACCESS_ACCEPT, ACCESS_REJECT, ACCESS_CHALLENGE};
+	list<RadiusServer> servers;
+	RadiusClient client;
+	TestRequest * requests[3];
+	Datagram datagrams[3];
+	int errors=0, result, i, k;
+
+	drain(fd);
+	servers.push_back(makeServer(port, TEST_SECRET, 1));
+	if (client.start(&servers, RADIUS_CLIENT_AUTH)!=0)
+	{
+		cerr << "RadiusClientTest: The client did not start.\n";
+		return 1;
+	}
+	for (i=0; i<3; i++)
+	{
+		requests[i]=new TestRequest(names[i]);
+		client.submit(&requests[i]->packet, &requests[i]->callback);
+	}
+	for (i=0; i<3; i++)
+	{
+		if (!readRequest(fd, &datagrams[i], TEST_TIMEOUT))
+		{
+			cerr << "RadiusClientTest: The server got " << i << " of 3 requests.\n";
+			client.stop();
+			for (i=0; i<3; i++)
+			{
+				delete requests[i];
+			}
+			return 1;
+		}
+	}
+	//a response with a wrong authenticator is dropped, the requests are not finished
+	for (i=0; i<3; i++)
+	{
+		sendResponse(fd, datagrams[i], ACCESS_ACCEPT, TEST_SECRET, true);
+	}
+	usleep(50000);
+	for (i=0; i<3; i++)
+	{
+		if (requests[i]->callback.wait(0, &result))
+		{
+			cerr << "RadiusClientTest: A response with a wrong authenticator was accepted.\n";
+			errors++;
+		}
+	}
+	for (i=2; i>=0; i--)
+	{
+		for (k=0; k<3 && username(datagrams[i])!=names[k]; k++);
+		sendResponse(fd, datagrams[i], codes[k<3 ? k : 0], TEST_SECRET, false);
+	}
+	for (i=0; i<3; i++)
+	{
+		if (!requests[i]->callback.wait(TEST_TIMEOUT, &result) || result!=0)
+		{
+			cerr << "RadiusClientTest: The request " << names[i] << " got no response.\n";
+			errors++;
+		}
+		else if (requests[i]->packet.getCode()!=codes[i])
+		{
+			cerr << "RadiusClientTest: The request " << names[i] << " got the response code "
+				 << requests[i]->packet.getCode() << ", expected " << (int) codes[i] << ".\n";
+			errors++;
+		}
+	}
+	client.stop();
+	for (i=0; i<3; i++)
+	{
+		delete requests[i];
+	}
+	return errors;
+}
+
+/** Checks the free ring of the identifiers. 256 requests one after another get
+ * 256 different identifiers, the next request gets the identifier of the first one
+ * again. A late response to the first request is dropped, it doesn't finish the new one.
+ * @param fd The server socket.
+ * @param port The port of the server.
+ * @return The number of errors.
+ */
+static int checkIdentifiers(int fd, int port)
+{
+	list<RadiusServer> servers;
+	RadiusClient client;
+	bool used[RADIUS_CLIENT_IDENTIFIERS];
+	Datagram first, datagram;
+	int errors=0, result, i;
+
+	drain(fd);
+	servers.push_back(makeServer(port, TEST_SECRET, 1));
+	if (client.start(&servers, RADIUS_CLIENT_AUTH)!=0)
+	{
+		cerr << "RadiusClientTest: The client did not start.\n";
+		return 1;
+	}
+	memset(used, 0, sizeof(used));
+	for (i=0; i<=RADIUS_CLIENT_IDENTIFIERS; i++)
+	{
+		TestRequest request("ring");
+		client.submit(&request.packet, &request.callback);
+		if (!readRequest(fd, &datagram, TEST_TIMEOUT))
+		{
+			cerr << "RadiusClientTest: The server got no request " << i << ".\n";
+			client.stop();
+			return errors+1;
+		}
+		if (i==0)
+		{
+			first=datagram;
+		}
+		if (i<RADIUS_CLIENT_IDENTIFIERS && used[datagram.data[1]])
+		{
+			cerr << "RadiusClientTest: The identifier " << (int) datagram.data[1] << " was used again after "
+				 << i << " requests.\n";
+			errors++;
+		}
+		used[datagram.data[1]]=true;
+		if (i==RADIUS_CLIENT_IDENTIFIERS)
+		{
+			if (datagram.data[1]!=first.data[1])
+			{
+				cerr << "RadiusClientTest: The ring didn't wrap to the first identifier.\n";
+				errors++;
+			}
+			//the late response to the first request has the same identifier but another authenticator
+			sendResponse(fd, first, ACCESS_ACCEPT, TEST_SECRET, false);
+			usleep(50000);
+			if (request.callback.wait(0, &result))
+			{
+				cerr << "RadiusClientTest: A late response to a reused identifier was accepted.\n";
+				errors++;
+			}
+		}
+		sendResponse(fd, datagram, ACCESS_ACCEPT, TEST_SECRET, false);
+		if (!request.callback.wait(TEST_TIMEOUT, &result) || result!=0)
+		{
+			cerr << "RadiusClientTest: The request " << i << " got no response.\n";
+			errors++;
+		}
+	}
+	client.stop();
+	return errors;
+}
+
+/** Checks the spill to a new socket. The server has one socket and two at most,
+ * 257 requests at the same time use all identifiers of the first socket and one
+ * of the second. The requests are submitted in batches which the server reads
+ * in between, so its receive buffer doesn't overflow.
+ * @param fd The server socket.
+ * @param port The port of the server.
+ * @return The number of errors.
+ */
+static int checkSpill(int fd, int port)
+{
+	const int n=RADIUS_CLIENT_IDENTIFIERS+1;
+	list<RadiusServer> servers;
+	RadiusClient client;
+	vector<TestRequest *> requests;
+	vector<Datagram> datagrams(n);
+	int errors=0, result, i, k, firstport=0, spilled=0;
+
+	drain(fd);
+	servers.push_back(makeServer(port, TEST_SECRET, 1));
+	servers.back().setMaxSockets(2);
+	servers.back().setMaxRto(TEST_TIMEOUT);
+	if (client.start(&servers, RADIUS_CLIENT_AUTH)!=0)
+	{
+		cerr << "RadiusClientTest: The client did not start.\n";
+		return 1;
+	}
+	for (i=0; i<n; i++)
+	{
+		if (i%64==0)
+		{
+			for (k=i; k<n && k<i+64; k++)
+			{
+				requests.push_back(new TestRequest("spill"));
+				client.submit(&requests[k]->packet, &requests[k]->callback, k==n-1 || k==i+63);
+			}
+		}
+		if (!readRequest(fd, &datagrams[i], TEST_TIMEOUT))
+		{
+			cerr << "RadiusClientTest: The server got " << i << " of " << n << " requests.\n";
+			errors++;
+			break;
+		}
+		if (i==0)
+		{
+			firstport=datagrams[i].from.sin_port;
+		}
+		if (datagrams[i].from.sin_port!=firstport)
+		{
+			spilled++;
+		}
+	}
+	if (errors==0 && spilled!=1)
+	{
+		cerr << "RadiusClientTest: " << spilled << " requests were sent from a second socket, expected 1.\n";
+		errors++;
+	}
+	for (i=0; errors==0 && i<n; i++)
+	{
+		sendResponse(fd, datagrams[i], ACCESS_ACCEPT, TEST_SECRET, false);
+	}
+	for (i=0; errors==0 && i<n; i++)
+	{
+		if (!requests[i]->callback.wait(TEST_TIMEOUT, &result) || result!=0)
+		{
+			cerr << "RadiusClientTest: The request " << i << " of the spill got no response.\n";
+			errors++;
+		}
+	}
+	client.stop();
+	for (i=0; i<(int) requests.size(); i++)
+	{
+		delete requests[i];
+	}
+	return errors;
+}
+
+/** Checks the retransmission. An unanswered request is sent again with the same
+ * bytes, the response to the retransmission finishes it.
+ * @param fd The server socket.
+ * @param port The port of the server.
+ * @return The number of errors.
+ */
+static int checkRetransmit(int fd, int port)
+{
+	list<RadiusServer> servers;
+	RadiusClient client;
+	TestRequest request("retransmit");
+	Datagram first, second;
+	int errors=0, result;
+
+	drain(fd);
+	servers.push_back(makeServer(port, TEST_SECRET, 2));
+	if (client.start(&servers, RADIUS_CLIENT_AUTH)!=0)
+	{
+		cerr << "RadiusClientTest: The client did not start.\n";
+		return 1;
+	}
+	client.submit(&request.packet, &request.callback);
+	if (!readRequest(fd, &first, TEST_TIMEOUT) || !readRequest(fd, &second, TEST_TIMEOUT))
+	{
+		cerr << "RadiusClientTest: The request was not retransmitted.\n";
+		client.stop();
+		return 1;
+	}
+	if (first.len!=second.len || memcmp(first.data, second.data, first.len)!=0)
+	{
+		cerr << "RadiusClientTest: The retransmission differs from the first transmission.\n";
+		errors++;
+	}
+	sendResponse(fd, second, ACCESS_ACCEPT, TEST_SECRET, false);
+	if (!request.callback.wait(TEST_TIMEOUT, &result) || result!=0)
+	{
+		cerr << "RadiusClientTest: The retransmitted request got no response.\n";
+		errors++;
+	}
+	client.stop();
+	return errors;
+}
+
+/** Checks the retransmission timeout. Before the first response it is the wait of
+ * the server (1 s), after a fast response it drops to the minrto (100 ms).
+ * @param fd The server socket.
+ * @param port The port of the server.
+ * @return The number of errors.
+ */
+static int checkRto(int fd, int port)
+{
+	list<RadiusServer> servers;
+	RadiusClient client;
+	Datagram first, second;
+	long long interval[2];
+	int errors=0, result, i;
+
+	drain(fd);
+	servers.push_back(makeServer(port, TEST_SECRET, 1));
+	servers.back().setMaxRto(0);
+	servers.back().setMinRto(100);
+	if (client.start(&servers, RADIUS_CLIENT_AUTH)!=0)
+	{
+		cerr << "RadiusClientTest: The client did not start.\n";
+		return 1;
+	}
+	//the first request is answered at once, only the second one is retransmitted
+	for (i=0; i<2; i++)
+	{
+		TestRequest probe("rtt"), request("rto");
+		if (i==1)
+		{
+			client.submit(&probe.packet, &probe.callback);
+			if (!readRequest(fd, &first, TEST_TIMEOUT))
+			{
+				cerr << "RadiusClientTest: The server got no request for the round trip time.\n";
+				client.stop();
+				return errors+1;
+			}
+			sendResponse(fd, first, ACCESS_ACCEPT, TEST_SECRET, false);
+			probe.callback.wait(TEST_TIMEOUT, &result);
+		}
+		client.submit(&request.packet, &request.callback);
+		if (!readRequest(fd, &first, TEST_TIMEOUT))
+		{
+			cerr << "RadiusClientTest: The server got no request.\n";
+			client.stop();
+			return errors+1;
+		}
+		interval[i]=now();
+		if (!readRequest(fd, &second, TEST_TIMEOUT))
+		{
+			cerr << "RadiusClientTest: The request was not retransmitted.\n";
+			client.stop();
+			return errors+1;
+		}
+		interval[i]=now()-interval[i];
+		sendResponse(fd, second, ACCESS_ACCEPT, TEST_SECRET, false);
+		request.callback.wait(TEST_TIMEOUT, &result);
+	}
+	//the timeout is varied by up to 25%
+	if (interval[0]<700 || interval[0]>1400)
+	{
+		cerr << "RadiusClientTest: The first retransmission came after " << interval[0] << " ms, expected about 1000 ms.\n";
+		errors++;
+	}
+	if (interval[1]<60 || interval[1]>400)
+	{
+		cerr << "RadiusClientTest: The retransmission after a fast response came after " << interval[1]
+			 << " ms, expected about 100 ms.\n";
+		errors++;
+	}
+	client.stop();
+	return errors;
+}
+
+/** Checks the failover. The first server doesn't answer, after its retries the
+ * request is shaped with the secret of the second server and sent to it. If the
+ * second server doesn't answer either, the request is finished with NO_RESPONSE
+ * after all retries.
+ * @param fd The socket of the first server.
+ * @param port The port of the first server.
+ * @param fd2 The socket of the second server.
+ * @param port2 The port of the second server.
+ * @param answer True if the second server answers.
+ * @return The number of errors.
+ */
+static int checkFailover(int fd, int port, int fd2, int port2, bool answer)
+{
+	list<RadiusServer> servers;
+	RadiusClient client;
+	TestRequest request("failover");
+	Datagram datagram;
+	int errors=0, result, i, sent;
+
+	drain(fd);
+	servers.push_back(makeServer(port, TEST_SECRET, 1));
+	servers.push_back(makeServer(port2, TEST_SECRET2, 1));
+	drain(fd2);
+	if (client.start(&servers, RADIUS_CLIENT_AUTH)!=0)
+	{
+		cerr << "RadiusClientTest: The client did not start.\n";
+		return 1;
+	}
+	client.submit(&request.packet, &request.callback);
+	//the first transmission and one retry
+	for (sent=0; readRequest(fd, &datagram, 500); sent++);
+	if (sent!=2)
+	{
+		cerr << "RadiusClientTest: The first server got " << sent << " transmissions, expected 2.\n";
+		errors++;
+	}
+	for (i=0; i<2; i++)
+	{
+		if (!readRequest(fd2, &datagram, TEST_TIMEOUT))
+		{
+			cerr << "RadiusClientTest: The second server got " << i << " transmissions, expected 2.\n";
+			errors++;
+			break;
+		}
+		if (answer)
+		{
+			sendResponse(fd2, datagram, ACCESS_ACCEPT, TEST_SECRET2, false);
+			break;
+		}
+	}
+	if (!request.callback.wait(TEST_TIMEOUT, &result))
+	{
+		cerr << "RadiusClientTest: The request was not finished.\n";
+		errors++;
+	}
+	else if (answer && result!=0)
+	{
+		cerr << "RadiusClientTest: The request failed over but got no response: " << result << ".\n";
+		errors++;
+	}
+	else if (!answer && result!=NO_RESPONSE)
+	{
+		cerr << "RadiusClientTest: The request to two silent servers finished with " << result
+			 << ", expected NO_RESPONSE.\n";
+		errors++;
+	}
+	client.stop();
+	return errors;
+}
+
+int main(void)
+{
+	int fd, fd2, port, port2, errors=0;
+
+	if ((fd=openServer(&port))<0 || (fd2=openServer(&port2))<0)
+	{
+		cerr << "RadiusClientTest: The server sockets could not be opened.\n";
+		return 1;
+	}
+
+	errors+=checkMatching(fd, port);
+	errors+=checkIdentifiers(fd, port);
+	errors+=checkSpill(fd, port);
+	errors+=checkRetransmit(fd, port);
+	errors+=checkRto(fd, port);
+	errors+=checkFailover(fd, port, fd2, port2, true);
+	errors+=checkFailover(fd, port, fd2, port2, false);
+
+	close(fd);
+	close(fd2);
+	if (errors!=0)
+	{
+		cerr << "RadiusClientTest: " << errors << " errors.\n";
+		return 1;
+	}
+	cout << "RadiusClientTest: ok\n";
+	return 0;
+}
@@ -33,6 +33,13 @@ RadiusConfig::RadiusConfig(void)
 	memset(this->serviceType,0,2);
 	memset(this->nasIdentifier,0,128);
 	memset(this->nasIpAddress,0,16);
+	this->nasAttributesLen=0;
+	this->nasAuthAttributesLen=0;
+	this->balance=RADIUS_BALANCE_FAILOVER;
+	this->authbalance=-1;
+	this->acctbalance=-1;
+	this->authmaxoutstanding=0;
+	this->acctmaxoutstanding=0;
 	
 }
 
@@ -49,24 +56,35 @@ RadiusConfig::RadiusConfig(string configfile)
 	memset(this->serviceType,0,2);
 	memset(this->nasIdentifier,0,128);
 	memset(this->nasIpAddress,0,16);
+	this->nasAttributesLen=0;
+	this->nasAuthAttributesLen=0;
+	this->balance=RADIUS_BALANCE_FAILOVER;
+	this->authbalance=-1;
+	this->acctbalance=-1;
+	this->authmaxoutstanding=0;
+	this->acctmaxoutstanding=0;
 	this->parseConfigFile(configfile.c_str());
 }
 
 
-/** The destructur clears the serverlist. */
+/** The destructur clears the serverlists. */
 RadiusConfig::~RadiusConfig(void)
 {
 	
-	server.clear();
+	authservers.clear();
+	acctservers.clear();
 	
 }
 
-/** The getter method for the radius server list.
+/** The getter method for the radius server list of a pool. A server block
+ * is in both pools, an authserver block only in the authentication pool
+ * and an acctserver block only in the accounting pool.
+ * @param acct True for the accounting pool, false for the authentication pool.
  * @return The server list.*/
 
-list<RadiusServer> * RadiusConfig::getRadiusServer(void)
+list<RadiusServer> * RadiusConfig::getRadiusServer(bool acct)
 {
-	return (&server);
+	return acct ? &acctservers : &authservers;
 }
 
 /** The method parse the configfile for attributes and 
@@ -78,6 +96,7 @@ list<RadiusServer> * RadiusConfig::getRadiusServer(void)
 int RadiusConfig::parseConfigFile(const char * configfile)
 {
 	string line;
+	bool auth, acct;
 	
 	RadiusServer *tmpServer=NULL;
 	ifstream file;
@@ -128,7 +147,39 @@ int RadiusConfig::parseConfigFile(const char * configfile)
 				}
 				line.copy(this->nasIpAddress,line.size()-15,15);
 			}
-			if(strncmp(line.c_str(),"server",6)==0)
+			if (strncmp(line.c_str(),"balance=",8)==0)
+			{
+				if ((this->balance=parseBalance(line.substr(8)))<0)
+				{
+					return BAD_FILE;
+				}
+			}
+			if (strncmp(line.c_str(),"authbalance=",12)==0)
+			{
+				if ((this->authbalance=parseBalance(line.substr(12)))<0)
+				{
+					return BAD_FILE;
+				}
+			}
+			if (strncmp(line.c_str(),"acctbalance=",12)==0)
+			{
+				if ((this->acctbalance=parseBalance(line.substr(12)))<0)
+				{
+					return BAD_FILE;
+				}
+			}
+			if (strncmp(line.c_str(),"authmaxoutstanding=",19)==0)
+			{
+				this->authmaxoutstanding=atoi(line.substr(19).c_str());
+			}
+			if (strncmp(line.c_str(),"acctmaxoutstanding=",19)==0)
+			{
+				this->acctmaxoutstanding=atoi(line.substr(19).c_str());
+			}
+			//a server block is in both pools
+			auth=(strncmp(line.c_str(),"server",6)==0 || strncmp(line.c_str(),"authserver",10)==0);
+			acct=(strncmp(line.c_str(),"server",6)==0 || strncmp(line.c_str(),"acctserver",10)==0);
+			if(auth || acct)
 			{
 				tmpServer=new RadiusServer;
 				while((line.find("{")==string::npos) && (file.eof()==false))
@@ -171,10 +222,62 @@ int RadiusConfig::parseConfigFile(const char * configfile)
 					{
 						tmpServer->setWait(atoi(line.substr(5).c_str()));
 					}
+					if (strncmp(line.c_str(),"sockets=",8)==0)
+					{
+						tmpServer->setSockets(atoi(line.substr(8).c_str()));
+					}
+					if (strncmp(line.c_str(),"statusserver=",13)==0)
+					{
+						tmpServer->setStatusServer(atoi(line.substr(13).c_str())!=0);
+					}
+					if (strncmp(line.c_str(),"statusinterval=",15)==0)
+					{
+						tmpServer->setStatusInterval(atoi(line.substr(15).c_str()));
+					}
+					if (strncmp(line.c_str(),"weight=",7)==0)
+					{
+						tmpServer->setWeight(atoi(line.substr(7).c_str()));
+					}
+					if (strncmp(line.c_str(),"minrto=",7)==0)
+					{
+						tmpServer->setMinRto(atoi(line.substr(7).c_str()));
+					}
+					if (strncmp(line.c_str(),"maxrto=",7)==0)
+					{
+						tmpServer->setMaxRto(atoi(line.substr(7).c_str()));
+					}
+					if (strncmp(line.c_str(),"maxsockets=",11)==0)
+					{
+						tmpServer->setMaxSockets(atoi(line.substr(11).c_str()));
+					}
+					if (strncmp(line.c_str(),"sourceip=",9)==0)
+					{
+						tmpServer->setSourceIp(line.substr(9));
+					}
+					if (strncmp(line.c_str(),"sourceport=",11)==0)
+					{
+						tmpServer->setSourcePort(atoi(line.substr(11).c_str()));
+					}
+					if (strncmp(line.c_str(),"resolvettl=",11)==0)
+					{
+						tmpServer->setResolveTtl(atoi(line.substr(11).c_str()));
+					}
 				}
 				if(strstr(line.c_str(),"}"))
 				{
-					this->server.push_back(*tmpServer);
+					//the packets are sent without asking the resolver
+					if (tmpServer->resolve()!=0)
+					{
+						cerr << "RADIUS-PLUGIN: Cannot resolve the radius server " << tmpServer->getName() << ", it is tried again later.\n";
+					}
+					if (auth)
+					{
+						this->authservers.push_back(*tmpServer);
+					}
+					if (acct)
+					{
+						this->acctservers.push_back(*tmpServer);
+					}
 				}
 				//No "}" was found - something in config is wrong
 				else
@@ -195,6 +298,7 @@ int RadiusConfig::parseConfigFile(const char * configfile)
 	{
 		return BAD_FILE;
 	}
+	this->buildNasAttributes();
 	return 0;
 }
 	
@@ -263,6 +367,7 @@ void RadiusConfig::getValue(const char * text, char * value)
 void RadiusConfig::setServiceType(char * type)
 {
 	strncpy(this->serviceType, type, 2);
+	this->buildNasAttributes();
 }
 
 /** The getter method for the service type
@@ -277,6 +382,7 @@ char * RadiusConfig::getServiceType(void)
 void RadiusConfig::setFramedProtocol(char * proto)
 {
 	strncpy(this->framedProtocol, proto, 2);
+	this->buildNasAttributes();
 }
 
 /**The getter method for the framed protocol
@@ -294,6 +400,7 @@ char * RadiusConfig::getFramedProtocol(void)
 void RadiusConfig::setNASPortType(char * type)
 {
 	strncpy(this->nasPortType, type, 2);
+	this->buildNasAttributes();
 }
 
 /** The getter method for the nas port type.
@@ -310,6 +417,7 @@ char * RadiusConfig::getNASPortType(void)
 void RadiusConfig::setNASIdentifier(char * identifier)
 {
 	strncpy(this->nasIdentifier,identifier, 128);
+	this->buildNasAttributes();
 }
 
 /** The getter method for the nas identifier.
@@ -327,6 +435,7 @@ char * RadiusConfig::getNASIdentifier(void)
 void RadiusConfig::setNASIpAddress(char * ip)
 {
 	strncpy(this->nasIpAddress,ip, 16);
+	this->buildNasAttributes();
 }
 
 
@@ -338,6 +447,114 @@ char * RadiusConfig::getNASIpAddress(void)
 	return this->nasIpAddress;
 }
 
+/** The method encodes the NAS attributes from the configuration in
+ * wire format, so they are appended to every packet with one copy
+ * instead of being parsed again for every packet. The framed protocol
+ * is the last attribute, it is only sent in accounting requests.
+ * Other attributes which are the same in every packet belong here too.
+ */
+void RadiusConfig::buildNasAttributes(void)
+{
+	this->nasAttributesLen=0;
+	this->addNasAttribute(ATTRIB_NAS_Identifier, this->nasIdentifier);
+	this->addNasAttribute(ATTRIB_NAS_IP_Address, this->nasIpAddress);
+	this->addNasAttribute(ATTRIB_NAS_Port_Type, this->nasPortType);
+	this->addNasAttribute(ATTRIB_Service_Type, this->serviceType);
+	this->nasAuthAttributesLen=this->nasAttributesLen;
+	this->addNasAttribute(ATTRIB_Framed_Protocol, this->framedProtocol);
+}
+
+/** The method encodes an attribute and appends it to the NAS attributes,
+ * if the value is not empty.
+ * @param type The type of the attribute.
+ * @param value The value from the configuration file.
+ */
+void RadiusConfig::addNasAttribute(Octet type, const char * value)
+{
+	RadiusAttribute ra(type);
+	int len;
+
+	if (strcmp(value,"")==0)
+	{
+		return;
+	}
+	if (ra.setValue(value)!=0)
+	{
+		cerr << "RADIUS-PLUGIN: Fail to set value of the NAS attribute " << (int) type << ".\n";
+		return;
+	}
+	len=ra.getLength();
+	if (this->nasAttributesLen+len>RADIUS_NAS_ATTRIBUTES_LEN)
+	{
+		cerr << "RADIUS-PLUGIN: The NAS attributes are too long, attribute " << (int) type << " is not sent.\n";
+		return;
+	}
+	this->nasAttributes[this->nasAttributesLen]=type;
+	this->nasAttributes[this->nasAttributesLen+1]=len;
+	memcpy(this->nasAttributes+this->nasAttributesLen+2, ra.getValue(), len-2);
+	this->nasAttributesLen+=len;
+}
+
+/** The getter method for the encoded NAS attributes.
+ * @return A pointer to the attributes in wire format.
+ */
+const Octet * RadiusConfig::getNasAttributes(void)
+{
+	return this->nasAttributes;
+}
+
+/** The getter method for the length of the encoded NAS attributes.
+ * @param acct True for accounting requests, they have the framed protocol too.
+ * @return The length in octets.
+ */
+int RadiusConfig::getNasAttributesLen(bool acct)
+{
+	return acct ? this->nasAttributesLen : this->nasAuthAttributesLen;
+}
+
+/** The method parses the name of a balancing policy.
+ * @param name failover, roundrobin, weighted, leastoutstanding or hash.
+ * @return One of RADIUS_BALANCE_*, -1 for an unknown name.
+ */
+int RadiusConfig::parseBalance(const string &name)
+{
+	if (name=="failover") return RADIUS_BALANCE_FAILOVER;
+	if (name=="roundrobin") return RADIUS_BALANCE_ROUNDROBIN;
+	if (name=="weighted") return RADIUS_BALANCE_WEIGHTED;
+	if (name=="leastoutstanding") return RADIUS_BALANCE_LEASTOUTSTANDING;
+	if (name=="hash") return RADIUS_BALANCE_HASH;
+	return -1;
+}
+
+/** The getter method for the balancing of the requests over the servers of a pool.
+ * @param acct True for the accounting pool, false for the authentication pool.
+ * @return One of RADIUS_BALANCE_*, the balancing of the pool or else the common balancing.
+ */
+int RadiusConfig::getBalance(bool acct)
+{
+	int b=acct ? this->acctbalance : this->authbalance;
+	return (b>=0) ? b : this->balance;
+}
+
+/** The setter method for the balancing of the requests over the servers.
+ * @param b One of RADIUS_BALANCE_*.
+ */
+void RadiusConfig::setBalance(int b)
+{
+	this->balance=b;
+}
+
+/** The getter method for the maximum number of outstanding requests to a pool.
+ * More requests wait in the radius client until a request is finished.
+ * @param acct True for the accounting pool, false for the authentication pool.
+ * @return The maximum number of requests, 0 for no limit.
+ */
+int RadiusConfig::getMaxOutstanding(bool acct)
+{
+	int n=acct ? this->acctmaxoutstanding : this->authmaxoutstanding;
+	return (n>0) ? n : 0;
+}
+
 ostream& operator << (ostream& os, RadiusConfig& config)
 {
      list<RadiusServer> * serverlist;
@@ -348,9 +565,12 @@ ostream& operator << (ostream& os, RadiusConfig& config)
      os << "\nNASIpAdress: "<< config.getNASIpAddress();
      os << "\nNASPortTyoe: "<< config.getNASPortType();
      os << "\nServiceType: " << config.getServiceType();
+     os << "\nBalance: " << config.getBalance(false) << "/" << config.getBalance(true);
+     os << "\nMaxOutstanding: " << config.getMaxOutstanding(false) << "/" << config.getMaxOutstanding(true);
     
-	//get the server list
-	serverlist=config.getRadiusServer();
+	//get the server list of the authentication pool
+	os << "\n\nAuthentication servers:";
+	serverlist=config.getRadiusServer(false);
 	//set server to the first server
 	server=serverlist->begin();
  	while(server != serverlist->end())
@@ -358,6 +578,15 @@ ostream& operator << (ostream& os, RadiusConfig& config)
  		cout << *server;
  		server++;
  	}
+	//and of the accounting pool
+	os << "\n\nAccounting servers:";
+	serverlist=config.getRadiusServer(true);
+	server=serverlist->begin();
+ 	while(server != serverlist->end())
+ 	{
+ 		cout << *server;
+ 		server++;
+ 	}
  	
  	return os;
  	
@@ -29,6 +29,7 @@
 
 #include "RadiusServer.h"
 #include"RadiusServer.h"
+#include "RadiusAttribute.h"
 #include "error.h"
 
 #include <list>
@@ -37,20 +38,40 @@
 using std::list;
 using namespace std;
 
+#define RADIUS_NAS_ATTRIBUTES_LEN 256 /**<The maximum length of the encoded NAS attributes.*/
+
+#define RADIUS_BALANCE_FAILOVER		0	/**<The requests go to the first server which is alive, in the order of the configuration.*/
+#define RADIUS_BALANCE_ROUNDROBIN	1	/**<The requests go to the servers in turn.*/
+#define RADIUS_BALANCE_WEIGHTED		2	/**<The requests go to the servers in turn, in proportion to their weights.*/
+#define RADIUS_BALANCE_LEASTOUTSTANDING	3	/**<A request goes to the server with the fewest outstanding requests per weight.*/
+#define RADIUS_BALANCE_HASH			4	/**<The requests of a user go to the same server, chosen by a hash of the username.*/
+
 /**This class represents the configurations attributes which 
  * can set in the configuration file and methods for the attributes.
  */
 class RadiusConfig
 {
 private:
-	list<RadiusServer> server; 		/**<An list with radius server, it is created dynamically by parsing the configuration file.*/
+	list<RadiusServer> authservers;	/**<The pool of the servers for the authentication, it is created dynamically by parsing the configuration file.*/
+	list<RadiusServer> acctservers;	/**<The pool of the servers for the accounting.*/
 	char serviceType[2]; 			/**<The service type which is set in the radius packet.*/
     char framedProtocol[2]; 		/**<The framed protocol which is set in the radius packet as an attribute.*/
     char nasPortType[2]; 			/**<The nas port type which is set in radius packet.*/
     char nasIdentifier[128]; 		/**<The nas identifier which is set in the radius packet.*/
     char nasIpAddress[16]; 			/**<The nas ipaddress which is set in the radius packet.*/
+    Octet nasAttributes[RADIUS_NAS_ATTRIBUTES_LEN]; /**<The NAS attributes in wire format, they are the same in every packet.*/
+    int nasAttributesLen;			/**<The length of the NAS attributes for accounting requests.*/
+    int nasAuthAttributesLen;		/**<The length of the NAS attributes for access requests, they have no framed protocol.*/
+    int balance;					/**<How the requests are spread over the servers, one of RADIUS_BALANCE_*.*/
+    int authbalance;				/**<The balancing of the authentication pool, -1 for balance.*/
+    int acctbalance;				/**<The balancing of the accounting pool, -1 for balance.*/
+    int authmaxoutstanding;			/**<The maximum number of outstanding requests to the authentication pool, 0 for no limit.*/
+    int acctmaxoutstanding;			/**<The maximum number of outstanding requests to the accounting pool, 0 for no limit.*/
     
 	void deletechars(string *);
+	static int parseBalance(const string &);
+	void buildNasAttributes(void);
+	void addNasAttribute(Octet, const char *);
 	
 	
 public:
@@ -64,7 +85,7 @@ public:
 	
 	void getValue(const char * text, char * value);
 	
-	list<RadiusServer>* getRadiusServer(void);
+	list<RadiusServer>* getRadiusServer(bool acct=false);
 	
 	
 	void setServiceType(char *);
@@ -83,6 +104,14 @@ public:
     char * getNASIpAddress(void);
 	void setNASIpAddress(char * );
 	
+	const Octet * getNasAttributes(void);
+	int getNasAttributesLen(bool);
+	
+	int getBalance(bool acct=false);
+	void setBalance(int);
+	
+	int getMaxOutstanding(bool acct);
+	
 	
 	
 	friend ostream& operator << (ostream& os, RadiusConfig& config);
@@ -25,61 +25,50 @@ GCRY_THREAD_OPTION_PTHREAD_IMPL;
 
 using namespace std;
 
-/** The destructur frees the dynamic allocated memory of the buffers,
- * closes the socket and clears the attribute multimap.
+/** The destructur closes the socket.
  */
 
 RadiusPacket::~RadiusPacket()
 {
-    if (this->sendbuffer) {
-        delete [] (this->sendbuffer);
-    }
-    if (this->recvbuffer) {
-        delete [] (this->recvbuffer);
-    }
-
     if (this->sock) {
         close (this->sock);
     }
-    this->attribs.clear();
 }
 
 /** The constructur sets the code and generate random numbers
- * for the identifier. The socket and the buffer length are set to 0, the pointer
- * to the buffers is set to NULL. The length is set to 20 Bytes, this is the length without
+ * for the identifier. The socket and the buffer length of the receive buffer are set to 0. The length is set to 20 Bytes, this is the length without
  * attributes.
  * @param code The code of the packet.
  */
 RadiusPacket::RadiusPacket(Octet code)
 {
     this->code=code;
+    this->identifier=0;
     this->getRandom(RADIUS_PACKET_IDENTIFIER_LEN,&(this->identifier));
     memset(this->authenticator,0,16);
-    memset(this->req_authenticator,0,16);
     this->length=sizeof(Octet)*(RADIUS_PACKET_AUTHENTICATOR_LEN+4);
-    this->sendbuffer=NULL;
-    this->sendbufferlen=0;
-    this->recvbuffer=NULL;
+    this->sendbufferlen=RADIUS_PACKET_HEADER_LEN;
+    this->passwordoffset=0;
+    this->msgauthoffset=0;
     this->recvbufferlen=0;
     this->sock=0;
 
 }
 
 /** The constructur generates random numbers
- * for the identifier. The socket, the code and the buffer length are set to 0, the pointer
- * to the buffers is set to NULL. The length is set to 20 Bytes, this is the length without
+ * for the identifier. The socket, the code and the buffer length of the receive buffer are set to 0. The length is set to 20 Bytes, this is the length without
  * attributes.
  */
 RadiusPacket::RadiusPacket(void)
 {
     this->code=0;
+    this->identifier=0;
     this->getRandom(RADIUS_PACKET_IDENTIFIER_LEN,&(this->identifier));
     memset(this->authenticator,0,16);
-    memset(this->req_authenticator,0,16);
     this->length=sizeof(Octet)*(RADIUS_PACKET_AUTHENTICATOR_LEN+4);
-    this->sendbuffer=NULL;
-    this->sendbufferlen=0;
-    this->recvbuffer=NULL;
+    this->sendbufferlen=RADIUS_PACKET_HEADER_LEN;
+    this->passwordoffset=0;
+    this->msgauthoffset=0;
     this->recvbufferlen=0;
     this->sock=0;
 
@@ -97,9 +86,25 @@ void RadiusPacket::dumpRadiusPacket(void)
     fprintf(stdout,"\tidentifier\t:\t%d\n",this->identifier);
     fprintf(stdout,"\tlength\t\t:\t%d\n",this->length);
     fprintf(stdout,"---------------------------------\n");
-    for (multimap<Octet, RadiusAttribute>::iterator it = attribs.begin(); it != attribs.end(); ++it)
+    for (int pos = RADIUS_PACKET_HEADER_LEN; pos < this->sendbufferlen; pos += this->sendbuffer[pos+1])
+    {
+        fprintf(stdout,"\ttype\t\t:\t%d\t|",this->sendbuffer[pos]);
+        fprintf(stdout,"\tlength\t:\t%d\t|",this->sendbuffer[pos+1]);
+        fprintf(stdout,"\tvalue\t:\t'");
+        for(int i = 2; i < this->sendbuffer[pos+1]; ++i) {
+            fputc(pos+2 == this->passwordoffset ? '*' : this->sendbuffer[pos+i],stdout);
+        }
+        fprintf(stdout,"'\n");
+    }
+    RadiusAttributeView view;
+    int pos=0;
+    while (this->nextAttribute(&pos, &view))
     {
-        it->second.dumpRadiusAttrib();
+        fprintf(stdout,"\ttype\t\t:\t%d\t|",view.type);
+        fprintf(stdout,"\tlength\t:\t%d\t|",view.length+2);
+        fprintf(stdout,"\tvalue\t:\t'");
+        fwrite(view.value,1,view.length,stdout);
+        fprintf(stdout,"'\n");
     }
 
     fprintf(stdout,"---------------------------------\n");
@@ -107,37 +112,66 @@ void RadiusPacket::dumpRadiusPacket(void)
 }
 
 
-/** Returns the number of attributes in the given radiusPacket.
+/** Returns the number of attributes in the given radiusPacket, the received
+ * attributes if a response was received, else the attributes to send.
  * @return An integer with the number of the attributes.
  */
 int RadiusPacket::getRadiusAttribNumber(void)
 {
-    int i=0;
-    for (multimap<Octet, RadiusAttribute>::iterator it = attribs.begin(); it != attribs.end(); it++)
+    RadiusAttributeView view;
+    int i=0, pos=0;
+    if (this->recvbufferlen>0)
+    {
+        while (this->nextAttribute(&pos, &view))
+        {
+            i++;
+        }
+        return i;
+    }
+    for (int pos = RADIUS_PACKET_HEADER_LEN; pos < this->sendbufferlen; pos += this->sendbuffer[pos+1])
     {
-
         i++;
     }
     return i;
 }
 
 
-/** Links a radiusAttrib structure to a radiusPacket.
+/** Appends a radius attribute to the send buffer of the packet,
+ * the attribute is copied, so it can be freed after the call.
+ * The value of the User-Password attribute is kept in plaintext until the
+ * packet is shaped.
  * @param ra The radius attribute to add.
  *  @return Returns 0 if everything is ok,
- * NO_VALUE_IN_ATTRIBUTE if the attribut value length is 0.
- * Return -1 if attribute value length is 0.
+ * NO_VALUE_IN_ATTRIBUTE if the attribut value length is 0,
+ * TO_BIG_ATTRIBUTE_LENGTH if the packet is full or TO_LONG_PASSWORD.
  */
 int RadiusPacket::addRadiusAttribute(RadiusAttribute *ra)
 {
-    if (ra->getLength()<1)
+    if (ra->getLength()<2)
     {
         cerr << "No value in the Attribute!\n";
         return NO_VALUE_IN_ATTRIBUTE;
     }
+    if (this->sendbufferlen+ra->getLength()>RADIUS_MAX_PACKET_LEN)
+    {
+        return TO_BIG_ATTRIBUTE_LENGTH;
+    }
+
+    if (ra->getType()==ATTRIB_User_Password)
+    {
+        if (ra->getLength()-2>RADIUS_MAX_PASSWORD_LEN)
+        {
+            return TO_LONG_PASSWORD;
+        }
+        memcpy(this->password, ra->getValue(), ra->getLength()-2);
+        this->passwordoffset=this->sendbufferlen+2;
+    }
 
-    //insert the attribute in the list
-    attribs.insert(pair<Octet,RadiusAttribute>((Octet)ra->getType(), *ra));
+    //append the attribute in wire order
+    this->sendbuffer[this->sendbufferlen]=ra->getType();
+    this->sendbuffer[this->sendbufferlen+1]=ra->getLength();
+    memcpy(this->sendbuffer+this->sendbufferlen+2, ra->getValue(), ra->getLength()-2);
+    this->sendbufferlen+=ra->getLength();
 
     //add the length of the attribute to the the packet length
     this->length=this->length+ra->getLength();
@@ -145,96 +179,80 @@ int RadiusPacket::addRadiusAttribute(RadiusAttribute *ra)
 }
 
 
-/** Formats a radiusPacket structure into a buffer that can be sent to a radius server via UDP.
- *  The destination buffer is put into sendbuffer while its length is put into sendbufferlen.
- *  @param sharedsecret The sharedsecret in plaintext.
- *  @return Returns 0 if everything is ok, ALLOC_ERROR in case of error.
+/** Appends attributes which are already in wire format to the send buffer
+ * with one copy, e.g. the NAS attributes of the configuration. The block must
+ * not have a User-Password attribute, it is not hashed.
+ * @param attributes The attributes in wire format.
+ * @param len The length of the attributes.
+ * @return Returns 0 if everything is ok, TO_BIG_ATTRIBUTE_LENGTH if the packet is full.
  */
-int RadiusPacket::shapeRadiusPacket(const char * sharedsecret)
+int RadiusPacket::addRadiusAttributes(const Octet *attributes, int len)
 {
-    int             i,j;
-    Octet *         value;
-    char *          hashedpassword ;
-
-    //fill the authenticator with random data
-    this->getRandom(RADIUS_PACKET_AUTHENTICATOR_LEN,this->authenticator);
-
-    //free the buffer if it is not empty, for ex. if is send again
-    if(this->sendbuffer!=NULL)
+    if (this->sendbufferlen+len>RADIUS_MAX_PACKET_LEN)
     {
-        delete [] this->sendbuffer;
-        this->sendbuffer = NULL;
-    }
-    //allocate memory for the packet
-    try {
-      if(!(this->sendbuffer=new Octet [this->length])) {
-        return (ALLOC_ERROR);
-      }
-    } catch(...) {
-      return ALLOC_ERROR;
+        return TO_BIG_ATTRIBUTE_LENGTH;
     }
+    memcpy(this->sendbuffer+this->sendbufferlen, attributes, len);
+    this->sendbufferlen+=len;
+    this->length=this->length+len;
+    return 0;
+}
 
-    this->sendbufferlen=0;
-
-    //add the code and increment the length
-    sendbuffer[(this->sendbufferlen)++]=this->code;
-
-    //add the identifier and increment the length
-    sendbuffer[(this->sendbufferlen)++]=this->identifier;
-    int nlength=htonl(this->length);
-    //add the two octets for the length and increment the length twice
-    sendbuffer[(this->sendbufferlen)++]=((char*)&(nlength))[2];
-    sendbuffer[(this->sendbufferlen)++]=((char*)&(nlength))[3];
-
-    //add the authenticator to the buffer
-    for(i=0;i<RADIUS_PACKET_AUTHENTICATOR_LEN;i++)
-        sendbuffer[(this->sendbufferlen)++]=this->authenticator[i];
 
-    //add the attributes to the buffer
-    for (multimap<Octet, RadiusAttribute>::iterator it = attribs.begin(); it != attribs.end(); it++)
+/** Appends a Message-Authenticator attribute (RFC 3579) to the packet. The
+ * value is the HMAC-MD5 of the whole packet, it is computed by shapeRadiusPacket()
+ * for every transmission.
+ * @return 0 if the attribute was added, else TO_BIG_ATTRIBUTE_LENGTH.
+ */
+int RadiusPacket::addMessageAuthenticator(void)
+{
+    if (this->sendbufferlen+MD5_DIGEST_LENGTH+2>RADIUS_MAX_PACKET_LEN)
     {
-        //if the attribute is a password, build the hashedpassword
-        if (it->second.getType()==ATTRIB_User_Password)
-        {
-
-            this->sendbuffer[(this->sendbufferlen)++]=it->second.getType();
-            this->sendbuffer[(this->sendbufferlen)++]=it->second.getLength();
-
-            if (it->second.getLength()-2<=16)
-            {
-                hashedpassword=new char[16];
-                it->second.makePasswordHash((char *)it->second.getValue(),hashedpassword,sharedsecret,this->getAuthenticator());
-                for(j=0;j<16;j++)
-                    this->sendbuffer[(this->sendbufferlen)++]=(Octet)hashedpassword[j];
-
-            }
-            else
-            {
-
-
-                hashedpassword = new char [it->second.getLength()-2];
-                it->second.makePasswordHash((char *)it->second.getValue(), hashedpassword, sharedsecret, this->getAuthenticator());
+        return TO_BIG_ATTRIBUTE_LENGTH;
+    }
+    this->sendbuffer[this->sendbufferlen]=ATTRIB_Message_Authenticator;
+    this->sendbuffer[this->sendbufferlen+1]=MD5_DIGEST_LENGTH+2;
+    this->msgauthoffset=this->sendbufferlen+2;
+    this->sendbufferlen+=MD5_DIGEST_LENGTH+2;
+    this->length=this->length+MD5_DIGEST_LENGTH+2;
+    return 0;
+}
 
-                for(j=0;j<(it->second.getLength()-2);j++)
-                {
-                    this->sendbuffer[(this->sendbufferlen)++]=(Octet)hashedpassword[j];
 
-                }
+/** Formats a radiusPacket structure into a buffer that can be sent to a radius server via UDP.
+ *  The attributes are already in the sendbuffer, only the header is written,
+ *  the password is hashed with the new authenticator and the Message-Authenticator is computed.
+ *  @param server The server the packet is sent to.
+ *  @return Returns 0 if everything is ok.
+ */
+int RadiusPacket::shapeRadiusPacket(RadiusServer *server)
+{
+    //fill the authenticator with random data
+    if (this->getRandom(RADIUS_PACKET_AUTHENTICATOR_LEN,this->authenticator)!=0)
+    {
+        cerr << "RADIUS-PLUGIN: No random data for the authenticator.\n";
+        return SHAPE_ERROR;
+    }
 
+    //the code, the identifier, the length and the authenticator
+    this->sendbuffer[0]=this->code;
+    this->sendbuffer[1]=this->identifier;
+    this->sendbuffer[2]=(this->sendbufferlen>>8) & 0xff;
+    this->sendbuffer[3]=this->sendbufferlen & 0xff;
+    memcpy(this->sendbuffer+4, this->authenticator, RADIUS_PACKET_AUTHENTICATOR_LEN);
 
-            }
-            delete [] hashedpassword;
+    //the password depends on the authenticator and the shared secret of the server
+    if (this->passwordoffset>0)
+    {
+        RadiusAttribute::hashPassword(this->password, this->sendbuffer[this->passwordoffset-1]-2,
+                                      this->sendbuffer+this->passwordoffset, server->getSecretDigest(), this->getAuthenticator());
+    }
 
-        }
-        //normal attributes
-        else
-        {
-            this->sendbuffer[(this->sendbufferlen)++]=it->second.getType();
-            this->sendbuffer[(this->sendbufferlen)++]=it->second.getLength();
-            value=it->second.getValue();
-            for(j=0;j<(it->second.getLength()-2);j++)
-                this->sendbuffer[(this->sendbufferlen)++]=value[j];
-        }
+    //the HMAC is computed over the packet with a zero Message-Authenticator
+    if (this->msgauthoffset>0)
+    {
+        memset(this->sendbuffer+this->msgauthoffset, 0, MD5_DIGEST_LENGTH);
+        server->hmac(this->sendbuffer, this->sendbufferlen, this->sendbuffer+this->msgauthoffset);
     }
     return 0;
 }
@@ -246,7 +264,7 @@ void    RadiusPacket::dumpShapedRadiusPacket(void)
 {
     int     i,j,attr,attrLen;
 
-    if(this->sendbuffer)
+    if(this->sendbufferlen>RADIUS_PACKET_HEADER_LEN)
     {
         i=0;
         fprintf(stdout,"-- sendbuffer --");
@@ -254,8 +272,8 @@ void    RadiusPacket::dumpShapedRadiusPacket(void)
 
         fprintf(stdout,"\n\tcode\t\t:\t%02x",(this->sendbuffer)[i++]);
         fprintf(stdout,"\n\tidentifier\t:\t%02x",(this->sendbuffer)[i++]);
-        Octet length1=(this->recvbuffer)[i++];
-        Octet length2=(this->recvbuffer)[i++];
+        Octet length1=(this->sendbuffer)[i++];
+        Octet length2=(this->sendbuffer)[i++];
         fprintf(stdout,"\n\tlength\t\t:\t%02x %02x",length1,length2);
         fprintf(stdout,"\n\tauthenticator\t:\t");
         for(j=0;j<RADIUS_PACKET_AUTHENTICATOR_LEN;j++)
@@ -275,7 +293,7 @@ void    RadiusPacket::dumpShapedRadiusPacket(void)
 
         fprintf(stdout,"\n---------------------------------\n");
     }
-    if(this->recvbuffer)
+    if(this->recvbufferlen>0)
     {
         i=0;
         fprintf(stdout,"-- recvbuffer --");
@@ -307,18 +325,18 @@ void    RadiusPacket::dumpShapedRadiusPacket(void)
 }
 
 
-/** Formats a UDP-received buffer radiusPacket structure
+/** Decodes the header of a UDP-received buffer and checks that the attributes
+ *  fit in the buffer. The attributes are not copied, they are read in place with
+ *  nextAttribute() and findAttribute().
  *  @return A error number. Returns 0 is everything is ok, NO_BUFFER_TO_UNSHAPE
- * or ALLOC_ERROR or TO_BIG_ATTRIBUTE_LENGTH in case of error.
+ * or TO_BIG_ATTRIBUTE_LENGTH in case of error.
  */
 int RadiusPacket::unShapeRadiusPacket(void)
 {
-    RadiusAttribute     *ra;
-    int                 pos,i;
-    char                *value;
+    int                 pos;
 
     //if the buffer is empty
-    if(!this->recvbuffer||this->recvbufferlen<=0)
+    if(this->recvbufferlen<RADIUS_PACKET_HEADER_LEN)
     {
         return NO_BUFFER_TO_UNSHAPE;
     }
@@ -332,51 +350,14 @@ int RadiusPacket::unShapeRadiusPacket(void)
     memcpy(this->authenticator,recvbuffer+4,RADIUS_PACKET_AUTHENTICATOR_LEN);
 
 
-    //  RADIUS packet attributes decoding
-    pos=20;
-
-    while(pos<this->recvbufferlen)
+    //  every attribute must fit in the received packet
+    for(pos=RADIUS_PACKET_HEADER_LEN; pos<this->recvbufferlen; pos+=recvbuffer[pos+1])
     {
-        //for every turn create a new attribute
-      try {
-        if(!(ra=new RadiusAttribute)) {
-            return ALLOC_ERROR;
-        }
-      } catch (...) {
-        return ALLOC_ERROR;
-      }
-
-        ra->setType(recvbuffer[pos++]);
-        ra->setLength(recvbuffer[pos++]);
-
-        //the maximum attribute size can be
-        //RADIUS_MAX_PACKET_LEN-20, 20: bytes of the
-        //packet header.
-        if(ra->getLength()>(RADIUS_MAX_PACKET_LEN-20))
+        if(pos+2>this->recvbufferlen || recvbuffer[pos+1]<2 || pos+recvbuffer[pos+1]>this->recvbufferlen)
         {
-          delete ra;
+          this->recvbufferlen=0;
           return TO_BIG_ATTRIBUTE_LENGTH;
         }
-        else
-        {
-          try {
-            value=new char [ra->getLength()-2];
-          } catch (...) {
-            delete ra;
-            return ALLOC_ERROR;
-          }
-            for(i=0;i<(ra->getLength()-2);i++)
-            {
-                value[i]=recvbuffer[pos++];
-            }
-            ra->setRecvValue(value);
-            this->addRadiusAttribute(ra);
-            this->length+=ra->getLength();
-            delete [] value;
-
-        }
-        //free the attribute, it was inserted in the list
-        delete ra;
     }
     //set the right length
     this->length=this->recvbufferlen;
@@ -385,7 +366,52 @@ int RadiusPacket::unShapeRadiusPacket(void)
     return 0;
 }
 
-/** The method sends the packet to a radius server.
+/** The method returns a view of the next received attribute. The value
+ * points into the receive buffer, nothing is copied.
+ * @param pos The position in the receive buffer, 0 for the first attribute.
+ * It is moved behind the attribute.
+ * @param view The view of the attribute.
+ * @return True if there was an attribute, false at the end of the packet.
+ */
+bool RadiusPacket::nextAttribute(int *pos, RadiusAttributeView *view)
+{
+    if (*pos<RADIUS_PACKET_HEADER_LEN)
+    {
+        *pos=RADIUS_PACKET_HEADER_LEN;
+    }
+    if (*pos+2>this->recvbufferlen || this->recvbuffer[*pos+1]<2 ||
+        *pos+this->recvbuffer[*pos+1]>this->recvbufferlen)
+    {
+        return false;
+    }
+    view->type=this->recvbuffer[*pos];
+    view->length=this->recvbuffer[*pos+1]-2;
+    view->value=this->recvbuffer+*pos+2;
+    *pos+=this->recvbuffer[*pos+1];
+    return true;
+}
+
+/** The method returns a view of the next received attribute with the given type.
+ * It can be called in a loop for attributes which are in the packet more than once.
+ * @param type The attribute type to find.
+ * @param pos The position in the receive buffer, 0 to start at the first attribute.
+ * @param view The view of the attribute.
+ * @return True if an attribute was found.
+ */
+bool RadiusPacket::findAttribute(int type, int *pos, RadiusAttributeView *view)
+{
+    while (this->nextAttribute(pos, view))
+    {
+        if (view->type==type)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** The method sends the packet to a radius server. The socket is connected
+ * to the server, radiusReceive() sends the retransmissions on it.
  * @param server A iterator to a server.
  * @return Returns the number of bytes successfully sent,
  * SOCKET_ERROR or UNKNOWN_HOST in case of error.
@@ -394,13 +420,14 @@ int RadiusPacket::radiusSend(list<RadiusServer>::iterator server)
 {
 
     int                 socket2Radius;
-    struct hostent      *h;
-    struct sockaddr_in  cliAddr,remoteServAddr;
+    struct sockaddr_in  cliAddr;
+    struct sockaddr_storage remoteServAddr;
+    socklen_t           remoteServAddrLen;
 
     //the packet is shaped here, the authenticator gets
     //a new random value and then the buffer must be shaped again
     //the password field depends on the authenticator field
-    if(this->shapeRadiusPacket(server->getSharedSecret().c_str())!=0)
+    if(this->shapeRadiusPacket(&(*server))!=0)
     {
         return SHAPE_ERROR;
     }
@@ -413,28 +440,14 @@ int RadiusPacket::radiusSend(list<RadiusServer>::iterator server)
 
     }
 
-    //save the authenticator field for packet authentication on receiving a packet
-    memcpy(this->authenticator, this->req_authenticator, 16);
-
-    //  Get server IP address (no check if input is IP address or DNS name
-    if(!(h=gethostbyname(server->getName().c_str())))
+    //get the address which was resolved when the configuration was read,
+    //the ports are differnt for accounting and authentication
+    if(server->getAddress(&remoteServAddr, &remoteServAddrLen,
+        this->code==ACCOUNTING_REQUEST ? server->getAcctPort() : server->getAuthPort())!=0)
     {
         return UNKNOWN_HOST;
     }
 
-    remoteServAddr.sin_family=h->h_addrtype;
-    memcpy((char*)&(remoteServAddr.sin_addr.s_addr),h->h_addr_list[0],h->h_length);
-
-    //set the port, they are differnt for accounting and authentication
-    if (this->code==ACCOUNTING_REQUEST)
-    {
-        remoteServAddr.sin_port=htons(server->getAcctPort());
-    }
-    else
-    {
-        remoteServAddr.sin_port=htons(server->getAuthPort());
-    }
-
     //  Socket creation
     if((socket2Radius = socket(AF_INET, SOCK_DGRAM, 0))<0)
     {
@@ -451,83 +464,105 @@ int RadiusPacket::radiusSend(list<RadiusServer>::iterator server)
     if(bind(socket2Radius,(struct sockaddr*)&cliAddr,sizeof(struct sockaddr))<0)
     {
         cerr << "Cannot bind port: " << strerror(errno) << "\n";
-        socket2Radius=-1;
+        close(socket2Radius);
         return BIND_ERROR;
     }
 
+    //only the server can answer on a connected socket
+    if(connect(socket2Radius,(struct sockaddr*)&remoteServAddr,remoteServAddrLen)<0)
+    {
+        cerr << "Cannot connect socket: " << strerror(errno) << "\n";
+        close(socket2Radius);
+        return SOCKET_ERROR;
+    }
+
     //safe the socket for receiving packets
     this->sock=socket2Radius;
     //sent the buffer
-    return sendto(socket2Radius,this->sendbuffer,this->sendbufferlen,0,(struct sockaddr*)&remoteServAddr,sizeof(struct sockaddr));
+    return send(socket2Radius,this->sendbuffer,this->sendbufferlen,0);
 }
 
 
 /** Receives a packet from a radius server, and copies it into recvbuffer.
  * If there is no response the packet is send again if the server->retry
  * is bigger than 0. 1 means the packet is send
- * one more time. If a packet is received the received data is write to the recvbuffer
+ * one more time. A retransmission sends the same bytes on the same socket,
+ * so a late response to the first transmission is accepted too. Then the
+ * next server is tried, the packet is shaped again with its secret.
+ * If a packet is received the received data is write to the recvbuffer
  * and the length is written to recvbufferlen.
- * The attributes are cleared if a packet is received.
- * @param serverlist : A list of radius server.
- * @return Returns 0 if everything is ok, else ALLOC_ERROR,  UNKNOWN_HOST, WRONG_AUTHENTICATOR_IN_RECV_PACKET or NO_RESPONSE in case of error.
+ * @param serverlist : A list of radius server, the packet was sent to the first one with radiusSend().
+ * @return Returns 0 if everything is ok, else UNSHAPE_ERROR, WRONG_AUTHENTICATOR_IN_RECV_PACKET or NO_RESPONSE in case of error.
  */
 int RadiusPacket::radiusReceive(list<RadiusServer> *serverlist)
 {
 
     list<RadiusServer>::iterator server;
 
-    int             result, retries=1; //for the first try retries=1, because the first packet was send in radiusSend()
-    socklen_t       len;
-    struct hostent  *h;
+    int             result, retries, plen;
     fd_set          set;
     struct timeval  tv;
-    struct sockaddr_in  remoteServAddr;
-    int i_server=serverlist->size(),i=0;
+    int i_server=serverlist->size(),i;
     server=serverlist->begin();
 
-    while (i<i_server)
+    for (i=0; i<i_server; i++, server++)
     {
-        //  Get server IP address (no check if input is IP address or DNS name
-        if(!(h=gethostbyname(server->getName().c_str())))
+        //the first server got the packet from the caller
+        if (i>0 && this->radiusSend(server)<0)
         {
-            return UNKNOWN_HOST;
+            continue;
+        }
+        if (this->sock<=0)
+        {
+            continue;
         }
 
-        remoteServAddr.sin_family=h->h_addrtype;
-
-        remoteServAddr.sin_port=htons(server->getAuthPort());
-
-
-        //retry the sending if there is no result
-        while (retries<=server->getRetry())
+        for (retries=0; retries<=server->getRetry(); retries++)
         {
+            //retry the sending if there is no result
+            if (retries>0 && send(this->sock,this->sendbuffer,this->sendbufferlen,0)<0)
+            {
+                cerr << "RADIUS-PLUGIN: Packet was not sent again: " << strerror(errno) << "\n";
+            }
+
             // wait for the specified time for a response
             tv.tv_sec = server->getWait();
             tv.tv_usec = 0;
-            FD_ZERO(&set);              // clear out the set
-            FD_SET(this->sock, &set);   // wait only for the RADIUS UDP socket
-            result = select(FD_SETSIZE, &set, NULL, NULL, &tv);
-
-            if (result>0)
+            while (1)
             {
+                FD_ZERO(&set);              // clear out the set
+                FD_SET(this->sock, &set);   // wait only for the RADIUS UDP socket
+                result = select(FD_SETSIZE, &set, NULL, NULL, &tv);
+                if (result<=0)
+                {
+                    break;
+                }
 
-                //clear the attributes
-                attribs.clear();
-
-
-                //allocate enough space for the buffer (RFC says
-                //maximum 4096=RADIUS_MAX_PACKET_LEN Bytes)
-                try {
-                  if(!(this->recvbuffer=new Octet[RADIUS_MAX_PACKET_LEN])) {
-                    return (ALLOC_ERROR);
-                  }
-                } catch (...) {
-                  return ALLOC_ERROR;
+                //the buffer has space for the maximum packet
+                //length of the RFC, 4096=RADIUS_MAX_PACKET_LEN Bytes
+                this->recvbufferlen=recv(this->sock,this->recvbuffer,RADIUS_MAX_PACKET_LEN,0);
+                //the connected socket gets the ICMP errors, e.g. if the port is unreachable
+                if (this->recvbufferlen<0)
+                {
+                    this->recvbufferlen=0;
+                    continue;
+                }
+                //a response to another packet is dropped, the packet waits again
+                if (this->recvbufferlen<RADIUS_PACKET_HEADER_LEN || this->recvbuffer[1]!=this->identifier)
+                {
+                    cerr << "RADIUS-PLUGIN: Response with a wrong identifier dropped.\n";
+                    this->recvbufferlen=0;
+                    continue;
+                }
+                //the length field of the packet, octets behind it are padding
+                plen=(this->recvbuffer[2]<<8) | this->recvbuffer[3];
+                if (plen<RADIUS_PACKET_HEADER_LEN || plen>this->recvbufferlen)
+                {
+                    cerr << "RADIUS-PLUGIN: Response with a wrong length dropped.\n";
+                    this->recvbufferlen=0;
+                    continue;
                 }
-                //set the buffer to 0
-                memset(this->recvbuffer,0,RADIUS_MAX_PACKET_LEN);
-                len=sizeof(struct sockaddr_in);
-                this->recvbufferlen=recvfrom(this->sock,this->recvbuffer,RADIUS_MAX_PACKET_LEN,0,(struct sockaddr*)&remoteServAddr,&len);
+                this->recvbufferlen=plen;
                 close(this->sock);
                 this->sock=0;
                 //unshape the packet
@@ -543,24 +578,9 @@ int RadiusPacket::radiusReceive(list<RadiusServer> *serverlist)
                 }
                 return 0;
             }
-            else
-            {
-                close(this->sock);
-                this->sock=0;
-                //retry only if the retries are less than
-                //the server retries
-                if(retries <= server->getRetry())
-                {
-                    this->radiusSend(server);
-                }
-            }
-            retries++;
         }
-
-        server++;
-        i++;
-        //set the retries=0, for the new server
-        retries=0;
+        close(this->sock);
+        this->sock=0;
     }
 
     return NO_RESPONSE;
@@ -577,36 +597,39 @@ int RadiusPacket::radiusReceive(list<RadiusServer> *serverlist)
  */
 void RadiusPacket::calcacctdigest(const char *secret)
 {
-    //Octet     digest[MD5_DIGEST_LENGTH];
-    gcry_md_hd_t    context;
-
-    //Zero out the auth_vector in the received packet.
-    //Then append the shared secret to the received packet,
-    //and calculate the MD5 sum. This must be the same
-    //as the original MD5 sum (packet->vector).
-
-    memset((this->sendbuffer+4), 0, 16);
-    //build the hash
-    if (!gcry_control (GCRYCTL_ANY_INITIALIZATION_P))
-    { /* No other library has already initialized libgcrypt. */
+    RadiusPacket * packet=this;
+    calcacctdigests(&packet, 1, secret);
+}
 
-      gcry_control(GCRYCTL_SET_THREAD_CBS,&gcry_threads_pthread);
+/** Sets the authenticator field of many accounting requests at once,
+ * see calcacctdigest(). The hashes are computed side by side with
+ * Md5::digests(), so the requests of one accounting tick are signed
+ * in one batch.
+ * @param packets The accounting requests, they are shaped.
+ * @param n The number of requests.
+ * @param secret The shared secret of the server in plaintext.
+ */
+void RadiusPacket::calcacctdigests(RadiusPacket ** packets, int n, const char *secret)
+{
+    vector<const Octet *> data(n);
+    vector<size_t> len(n);
+    vector<Octet *> digest(n);
+    int i;
 
-      if (!gcry_check_version (NEED_LIBGCRYPT_VERSION) )
-        {
-        cerr << "libgcrypt is too old (need " << NEED_LIBGCRYPT_VERSION << ", have " << gcry_check_version (NULL) << ")\n";
-        }
-        /* Disable secure memory.  */
-          gcry_control (GCRYCTL_DISABLE_SECMEM, 0);
-      gcry_control (GCRYCTL_INITIALIZATION_FINISHED);
+    //the authenticator field is zero while the hash is built
+    for (i=0; i<n; i++)
+    {
+        memset(packets[i]->sendbuffer+4, 0, 16);
+        data[i]=packets[i]->sendbuffer;
+        len[i]=packets[i]->sendbufferlen;
+        digest[i]=packets[i]->authenticator;
     }
-    gcry_md_open (&context, GCRY_MD_MD5, 0);
-    gcry_md_write(context, this->sendbuffer, this->length);
-    gcry_md_write(context, secret, strlen(secret));
+    Md5::digests(n, &data[0], &len[0], secret, strlen(secret), &digest[0]);
     //copy the digest to the paket
-    memcpy(this->sendbuffer+4, gcry_md_read(context, GCRY_MD_MD5), 16);
-    memcpy(this->authenticator, this->sendbuffer+4, 16);
-    gcry_md_close(context);
+    for (i=0; i<n; i++)
+    {
+        memcpy(packets[i]->sendbuffer+4, packets[i]->authenticator, 16);
+    }
 }
 
 
@@ -626,34 +649,16 @@ int RadiusPacket::getCode(void)
     return ((int)this->code);
 }
 
-/** Generates real random data with the device "/dev/random".
- * Windows doesn'h have this device!. The method generates
- * random data with the length len and copies it to the
- * field num. In the num field must be enough space!
+/** Generates random data with the ChaCha20 generator of the process,
+ * see RadiusRandom. The method generates random data with the length len
+ * and copies it to the field num. In the num field must be enough space!
  * @param len  The length of the random data.
  * @param num  A pointer to an array where the random data is written to.
+ * @return 0 if the random data was written, else RANDOM_ERROR.
  */
-void RadiusPacket::getRandom(int len, Octet *num)
+int RadiusPacket::getRandom(int len, Octet *num)
 {
-
-  int fd = open("/dev/urandom",O_RDONLY);
-  if (fd >= 0 && (read(fd, num, len) > 0))
-  {
-    // read(fd, num, len);
-  }
-  close(fd);
-}
-
-/**The method finds attributes with the given type in the packet and returns iterator pair.
- * This can be looped for the attributes.
- * @param type The attribute type to find.
- * @return A pair of the datatype pair<multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::iterator>
- */
-pair<multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::iterator> RadiusPacket::findAttributes(int type)
-{
-    pair<multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::iterator> p;
-    p=attribs.equal_range((Octet) type);
-    return p;
+  return RadiusRandom::random(num, len);
 }
 
 /**The method checks the authenticator field from a received packet,
@@ -664,54 +669,42 @@ pair<multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::
 
 int RadiusPacket::authenticateReceivedPacket(const char *secret)
 {
-    gcry_md_hd_t    context;
-
-    Octet * cpy_recvpacket;
-    //make a copy of the received packet
-    if(this->recvbufferlen > 20) {
-      cpy_recvpacket=new Octet [this->recvbufferlen];
-    } else {
-      cpy_recvpacket=new Octet [32];
-    }
-
-    memcpy(cpy_recvpacket, this->recvbuffer, this->recvbufferlen);
-
-    //copy the authenticator of the sent packet to the received packet
-    memcpy(cpy_recvpacket+4, this->sendbuffer+4, 16);
-
-    //bulid the hash of the copy
-    //build the hash
-    if (!gcry_control (GCRYCTL_ANY_INITIALIZATION_P))
-    { /* No other library has already initialized libgcrypt. */
+    //the request authenticator is in the send buffer
+    return verifyResponse(this->recvbuffer, this->recvbufferlen, this->sendbuffer+4, secret);
+}
 
-      gcry_control(GCRYCTL_SET_THREAD_CBS,&gcry_threads_pthread);
+/**The method checks the Response Authenticator of a response, an Access-Accept,
+ * Access-Reject, Access-Challenge or Accounting-Response. It is the MD5 hash over the
+ * code, the identifier and the length, the Request Authenticator of the sent packet,
+ * the attributes and the shared secret (RFC 2865, RFC 2866). The hash is built in
+ * pieces from the response and the Request Authenticator, nothing is copied.
+ * @param response The received response.
+ * @param len The length of the response.
+ * @param reqauth The Request Authenticator of the sent packet.
+ * @param secret The shared secret.
+ * @return A an integer, 0 if the authenticator field is ok, else WRONG_AUTHENTICATOR_IN_RECV_PACKET.
+ */
+int RadiusPacket::verifyResponse(const Octet *response, int len, const Octet *reqauth, const char *secret)
+{
+    Md5     context;
+    Octet   digest[MD5_DIGEST_LENGTH];
 
-      if (!gcry_check_version (NEED_LIBGCRYPT_VERSION) )
-        {
-        cerr << "libgcrypt is too old (need " << NEED_LIBGCRYPT_VERSION << ", have " << gcry_check_version (NULL) << ")\n";
-        }
-        /* Disable secure memory.  */
-          gcry_control (GCRYCTL_DISABLE_SECMEM, 0);
-      gcry_control (GCRYCTL_INITIALIZATION_FINISHED);
+    if (len<RADIUS_PACKET_HEADER_LEN)
+    {
+        return WRONG_AUTHENTICATOR_IN_RECV_PACKET;
     }
-    gcry_md_open (&context, GCRY_MD_MD5, 0);
-    gcry_md_write(context, cpy_recvpacket, this->recvbufferlen);
-    gcry_md_write(context, secret, strlen(secret));
-
-    delete[] cpy_recvpacket;
+    context.update(response, 4);
+    context.update(reqauth, RADIUS_PACKET_AUTHENTICATOR_LEN);
+    context.update(response+RADIUS_PACKET_HEADER_LEN, len-RADIUS_PACKET_HEADER_LEN);
+    context.update(secret, strlen(secret));
+    context.final(digest);
 
     //compare the received and the built authenticator
-    if (memcmp(this->recvbuffer+4, gcry_md_read(context, GCRY_MD_MD5), 16)!=0)
+    if (memcmp(response+4, digest, RADIUS_PACKET_AUTHENTICATOR_LEN)!=0)
     {
-        gcry_md_close(context);
         return WRONG_AUTHENTICATOR_IN_RECV_PACKET;
     }
-    else
-    {
-        gcry_md_close(context);
-        return 0;
-    }
-
+    return 0;
 }
 
 
@@ -42,22 +42,22 @@
 #include "radius.h"
 #include "RadiusAttribute.h"
 #include "RadiusServer.h"
+#include "RadiusRandom.h"
 
 
-#include <map>
 #include <list>
+#include <vector>
 #include <utility> 
 
 using namespace std;
-using std::multimap;
 
 /** The class represents a radius packet with additional variables*/
 
 class RadiusPacket
 {
+	friend class RadiusClient;
 private:
 	
-	multimap<Octet,RadiusAttribute> attribs; 	/**The multimap for the radius attributes.*/
 	int					sock; 					/**<The socket which is used.*/
 	Octet				code; 					/**< The code of the packet, see the Radius RFC or radius.h*/
 	Octet				identifier; 			/**<The identifier of the packet, it is generated randomly.*/			
@@ -66,21 +66,23 @@ private:
 	In ACCEPT-Request packets it is a random number, 
 	in Accounting-Request it is a hash over whole packet and shared secret. The send-method
 	generates it, when the code is an Accounting-Request*/ 
-	Octet				req_authenticator[RADIUS_PACKET_AUTHENTICATOR_LEN]; /**<A copy of the authenticator. 
-	The server sends in the authenticator field: code + idntifier + length + request authenticator + attribute and secret.
-	So you can authenticate the packet, if it is the real response on the request.>*/
 	
-	
-	Octet				*sendbuffer;  			/**<Buffer for sending the packet over the network.*/
-	int					sendbufferlen; 			/**<Length of the buffer.*/
-	Octet				*recvbuffer;  			/**<Buffer for recveing the packet over the network.*/
-	int					recvbufferlen; 			/**<Length of the buffer.*/
+	Octet				sendbuffer[RADIUS_MAX_PACKET_LEN]; /**<Buffer for sending the packet over the network. The attributes
+	are appended behind the header in the order they are added, so building and shaping the packet needs no heap memory.*/
+	int					sendbufferlen; 			/**<Length of the buffer, the header and the attributes.*/
+	Octet				password[RADIUS_MAX_PASSWORD_LEN]; /**<The plaintext of the User-Password attribute, it is hashed into the send buffer.*/
+	int					passwordoffset;			/**<The offset of the value of the User-Password attribute in the send buffer, 0 if there is none.*/
+	int					msgauthoffset;			/**<The offset of the value of the Message-Authenticator attribute in the send buffer, 0 if there is none.*/
+	Octet				recvbuffer[RADIUS_MAX_PACKET_LEN]; /**<Buffer for recveing the packet over the network. The
+	received attributes are read in place with nextAttribute() and findAttribute().*/
+	int					recvbufferlen; 			/**<Length of the buffer, 0 if nothing was received.*/
 	void            	calcacctdigest(const char *secret); /**Method to generate the hash 
 	for the authenticator in Accounting-Requests.*/
+	static void			calcacctdigests(RadiusPacket **, int, const char *secret);
 	
 	//private functions
-	void 			getRandom(int len, Octet *num);
-	int				shapeRadiusPacket(const char *);
+	int 			getRandom(int len, Octet *num);
+	int				shapeRadiusPacket(RadiusServer *);
 	int				unShapeRadiusPacket(void);
 	
 public:
@@ -89,6 +91,8 @@ public:
 					RadiusPacket(Octet code);
 					
 	int				addRadiusAttribute(RadiusAttribute *);
+	int				addRadiusAttributes(const Octet *, int);
+	int				addMessageAuthenticator(void);
 		
 	void			dumpRadiusPacket(void);
 	void			dumpShapedRadiusPacket(void);
@@ -102,8 +106,10 @@ public:
 	int				getCode(void);
 	
 	int				authenticateReceivedPacket(const char *secret);
+	static int		verifyResponse(const Octet *, int, const Octet *, const char *secret);
 	
-	pair<multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::iterator> findAttributes(int type);
+	bool			nextAttribute(int *, RadiusAttributeView *);
+	bool			findAttribute(int, int *, RadiusAttributeView *);
 	
 };
 
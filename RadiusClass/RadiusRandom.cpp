@@ -0,0 +1,258 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "RadiusRandom.h"
+#include "error.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+//the quarter round of ChaCha20
+#define CHACHA_ROTATE(x, n) (((x) << (n)) | ((x) >> (32-(n))))
+#define CHACHA_QUARTER(a, b, c, d) \
+	(a) += (b); (d) ^= (a); (d) = CHACHA_ROTATE((d), 16); \
+	(c) += (d); (b) ^= (c); (b) = CHACHA_ROTATE((b), 12); \
+	(a) += (b); (d) ^= (a); (d) = CHACHA_ROTATE((d),  8); \
+	(c) += (d); (b) ^= (c); (b) = CHACHA_ROTATE((b),  7);
+
+static RadiusRandom generator;								/**<The generator of the process.*/
+static pthread_mutex_t generatormutex=PTHREAD_MUTEX_INITIALIZER;	/**<Protects the generator of the process.*/
+
+/** The constructor, the key is taken when the first random data is needed.*/
+RadiusRandom::RadiusRandom(void)
+{
+	memset(this->key, 0, sizeof(this->key));
+	memset(this->buffer, 0, sizeof(this->buffer));
+	this->used=RADIUS_RANDOM_BUFFER_LEN;
+	this->pid=0;
+}
+
+/** The destructor erases the key and the buffer.*/
+RadiusRandom::~RadiusRandom(void)
+{
+	memset(this->key, 0, sizeof(this->key));
+	memset(this->buffer, 0, sizeof(this->buffer));
+}
+
+/** The method computes one block of ChaCha20 (RFC 8439), the generator uses the nonce 0.
+ * @param key The 8 words of the key.
+ * @param counter The block counter.
+ * @param nonce The 3 words of the nonce.
+ * @param out An array for the 64 octets of the block.
+ */
+void RadiusRandom::block(const uint32_t * key, uint32_t counter, const uint32_t * nonce, Octet * out)
+{
+	uint32_t in[16], x[16];
+	int i;
+
+	//"expand 32-byte k"
+	in[0]=0x61707865;
+	in[1]=0x3320646e;
+	in[2]=0x79622d32;
+	in[3]=0x6b206574;
+	for (i=0; i<8; i++)
+	{
+		in[4+i]=key[i];
+	}
+	in[12]=counter;
+	in[13]=nonce[0];
+	in[14]=nonce[1];
+	in[15]=nonce[2];
+	memcpy(x, in, sizeof(x));
+
+	//20 rounds, a column round and a diagonal round at a time
+	for (i=0; i<10; i++)
+	{
+		CHACHA_QUARTER(x[0], x[4], x[ 8], x[12])
+		CHACHA_QUARTER(x[1], x[5], x[ 9], x[13])
+		CHACHA_QUARTER(x[2], x[6], x[10], x[14])
+		CHACHA_QUARTER(x[3], x[7], x[11], x[15])
+		CHACHA_QUARTER(x[0], x[5], x[10], x[15])
+		CHACHA_QUARTER(x[1], x[6], x[11], x[12])
+		CHACHA_QUARTER(x[2], x[7], x[ 8], x[13])
+		CHACHA_QUARTER(x[3], x[4], x[ 9], x[14])
+	}
+
+	//the words are little endian
+	for (i=0; i<16; i++)
+	{
+		x[i]+=in[i];
+		out[i*4]=(Octet) x[i];
+		out[i*4+1]=(Octet) (x[i] >> 8);
+		out[i*4+2]=(Octet) (x[i] >> 16);
+		out[i*4+3]=(Octet) (x[i] >> 24);
+	}
+}
+
+/** The method reads random data from the kernel. It uses the getrandom
+ * system call if it exists, else the device "/dev/urandom".
+ * @param buf An array for the random data.
+ * @param len The length of the random data.
+ * @return 0 if the array is filled, else RANDOM_ERROR.
+ */
+int RadiusRandom::entropy(Octet * buf, int len)
+{
+	int n, fd;
+
+#if defined(__linux__) && defined(SYS_getrandom)
+	while (len > 0)
+	{
+		n=syscall(SYS_getrandom, buf, len, 0);
+		if (n < 0 && errno==EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			//the kernel is too old, read the device
+			break;
+		}
+		buf+=n;
+		len-=n;
+	}
+	if (len==0)
+	{
+		return 0;
+	}
+#endif
+	fd=open("/dev/urandom", O_RDONLY);
+	if (fd < 0)
+	{
+		return RANDOM_ERROR;
+	}
+	while (len > 0)
+	{
+		n=read(fd, buf, len);
+		if (n < 0 && errno==EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			close(fd);
+			return RANDOM_ERROR;
+		}
+		buf+=n;
+		len-=n;
+	}
+	close(fd);
+	return 0;
+}
+
+/** The method takes a new key from the kernel.
+ * @return 0 if the key was taken, else RANDOM_ERROR.
+ */
+int RadiusRandom::seed(void)
+{
+	Octet k[RADIUS_RANDOM_KEY_LEN];
+	int i;
+
+	if (entropy(k, RADIUS_RANDOM_KEY_LEN)!=0)
+	{
+		return RANDOM_ERROR;
+	}
+	for (i=0; i<8; i++)
+	{
+		this->key[i]=((uint32_t) k[i*4]) | ((uint32_t) k[i*4+1] << 8) |
+			((uint32_t) k[i*4+2] << 16) | ((uint32_t) k[i*4+3] << 24);
+	}
+	memset(k, 0, sizeof(k));
+	this->used=RADIUS_RANDOM_BUFFER_LEN;
+	this->pid=getpid();
+	return 0;
+}
+
+/** The method fills the buffer with new blocks. The first octets of the
+ * blocks are the next key, they are never served.
+ */
+void RadiusRandom::refill(void)
+{
+	static const uint32_t nonce[3]={0, 0, 0};
+	int i;
+
+	for (i=0; i<RADIUS_RANDOM_BUFFER_LEN/RADIUS_RANDOM_BLOCK_LEN; i++)
+	{
+		block(this->key, i, nonce, this->buffer+i*RADIUS_RANDOM_BLOCK_LEN);
+	}
+	for (i=0; i<8; i++)
+	{
+		this->key[i]=((uint32_t) this->buffer[i*4]) | ((uint32_t) this->buffer[i*4+1] << 8) |
+			((uint32_t) this->buffer[i*4+2] << 16) | ((uint32_t) this->buffer[i*4+3] << 24);
+	}
+	memset(this->buffer, 0, RADIUS_RANDOM_KEY_LEN);
+	this->used=RADIUS_RANDOM_KEY_LEN;
+}
+
+/** The method writes random data.
+ * @param num An array for the random data.
+ * @param len The length of the random data.
+ * @return 0 if the array is filled, else RANDOM_ERROR.
+ */
+int RadiusRandom::get(Octet * num, int len)
+{
+	int n;
+
+	if (this->pid!=getpid() && this->seed()!=0)
+	{
+		return RANDOM_ERROR;
+	}
+	while (len > 0)
+	{
+		if (this->used==RADIUS_RANDOM_BUFFER_LEN)
+		{
+			this->refill();
+		}
+		n=RADIUS_RANDOM_BUFFER_LEN-this->used;
+		if (n > len)
+		{
+			n=len;
+		}
+		memcpy(num, this->buffer+this->used, n);
+		//the served octets are erased
+		memset(this->buffer+this->used, 0, n);
+		this->used+=n;
+		num+=n;
+		len-=n;
+	}
+	return 0;
+}
+
+/** The method writes random data from the generator of the process,
+ * it can be called from every thread.
+ * @param num An array for the random data.
+ * @param len The length of the random data.
+ * @return 0 if the array is filled, else RANDOM_ERROR.
+ */
+int RadiusRandom::random(Octet * num, int len)
+{
+	int ret;
+
+	pthread_mutex_lock(&generatormutex);
+	ret=generator.get(num, len);
+	pthread_mutex_unlock(&generatormutex);
+	return ret;
+}
@@ -0,0 +1,62 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _RADIUSRANDOM_H_
+#define _RADIUSRANDOM_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "radius.h"
+
+#define RADIUS_RANDOM_KEY_LEN		32		/**<The length of the ChaCha20 key.*/
+#define RADIUS_RANDOM_BLOCK_LEN		64		/**<The length of a ChaCha20 block.*/
+#define RADIUS_RANDOM_BUFFER_LEN	1024	/**<The length of the buffer, it holds 16 blocks.*/
+
+/** The class implements a random generator with the ChaCha20 stream cipher.
+ * The key is taken once from the kernel, after that the random data is
+ * served from a buffer which is refilled with 16 blocks at a time. Every refill
+ * takes a new key from its own output and the served octets are erased, so
+ * old output can not be computed again from the state. A forked process
+ * takes a new key, so it does not repeat the output of its parent.
+ */
+class RadiusRandom
+{
+private:
+	uint32_t	key[8];								/**<The current key.*/
+	Octet		buffer[RADIUS_RANDOM_BUFFER_LEN];	/**<The random data which was not served so far.*/
+	int			used;								/**<The number of served octets in the buffer.*/
+	pid_t		pid;								/**<The process which took the key, 0 if there is no key.*/
+
+	static int	entropy(Octet *, int);
+	int			seed(void);
+	void		refill(void);
+
+public:
+	RadiusRandom(void);
+	~RadiusRandom(void);
+
+	int			get(Octet *, int);
+
+	static int	random(Octet *, int);
+	static void	block(const uint32_t *, uint32_t, const uint32_t *, Octet *);
+};
+
+#endif //_RADIUSRANDOM_H_
@@ -0,0 +1,109 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Benchmark of the random data of a packet, the identifier (1 octet) and
+ * the authenticator (16 octets).
+ * - urandom:  the old RadiusPacket::getRandom(), open(), read() and close()
+ *             of "/dev/urandom" for every draw.
+ * - chacha20: RadiusRandom::random(), the generator of the process.
+ *
+ * Build and run it with: make bench
+ * Usage: RadiusRandomBench [packets]
+ */
+
+#include "RadiusRandom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** The old RadiusPacket::getRandom().
+ * @param len The length of the random data.
+ * @param num An array for the random data.
+ * @return The number of read octets, -1 if the device could not be opened.
+ */
+static ssize_t urandom(int len, Octet * num)
+{
+	ssize_t size=-1;
+	int fd = open("/dev/urandom", O_RDONLY);
+	if (fd >= 0)
+	{
+		size=read(fd, num, len);
+		close(fd);
+	}
+	return size;
+}
+
+/** Returns the time in nanoseconds.*/
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+/** Prints the result of a mode.
+ * @param mode The name of the mode.
+ * @param n The number of packets.
+ * @param ns The time of all packets.
+ * @param check An octet of the output, so the draws are not optimized away.
+ */
+static void report(const char * mode, int n, double ns, Octet check)
+{
+	printf("%-9s %9d packets  %7.0f ns/packet  %10.0f packets/s  (%02x)\n",
+		   mode, n, ns/n, n/(ns/1e9), check);
+}
+
+int main(int argc, char ** argv)
+{
+	const int n=(argc > 1) ? atoi(argv[1]) : 1000000;
+	Octet identifier, authenticator[16], check;
+	double start;
+	int i;
+
+	check=0;
+	start=now();
+	for (i=0; i<n; i++)
+	{
+		urandom(1, &identifier);
+		urandom(16, authenticator);
+		check^=identifier^authenticator[15];
+	}
+	report("urandom", n, now()-start, check);
+
+	//the key is taken before the measurement
+	if (RadiusRandom::random(&identifier, 1)!=0)
+	{
+		fprintf(stderr, "RadiusRandomBench: The generator got no key.\n");
+		return 1;
+	}
+	check=0;
+	start=now();
+	for (i=0; i<n; i++)
+	{
+		RadiusRandom::random(&identifier, 1);
+		RadiusRandom::random(authenticator, 16);
+		check^=identifier^authenticator[15];
+	}
+	report("chacha20", n, now()-start, check);
+	return 0;
+}
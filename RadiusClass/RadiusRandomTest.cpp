@@ -0,0 +1,159 @@
+/*
+ *  RadiusClass -- An C++-Library for radius authentication
+ *                  and accounting.
+ *
+ *  Copyright (C) 2005 EWE TEL GmbH/Ralf Luebben <ralfluebben@gmx.de>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Test of the random generator. The ChaCha20 block function is checked
+ * against the test vector of RFC 8439, section 2.3.2. The generator must
+ * fill the arrays and a forked process must not repeat the output of its
+ * parent.
+ *
+ * Build and run it with: make check
+ */
+
+#include "RadiusRandom.h"
+#include <iostream>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+/** Checks the block function with the test vector of RFC 8439, section 2.3.2.
+ * @return 0 if the block is correct, else 1.
+ */
+static int checkBlock(void)
+{
+	//the key 00:01:02:...:1f and the nonce 00:00:00:09:00:00:00:4a:00:00:00:00 as little endian words
+	static const uint32_t key[8]={0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c,
+								  0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c};
+	static const uint32_t nonce[3]={0x09000000, 0x4a000000, 0x00000000};
+	static const Octet expected[RADIUS_RANDOM_BLOCK_LEN]={
+		0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+		0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+		0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+		0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e};
+	Octet out[RADIUS_RANDOM_BLOCK_LEN];
+
+	RadiusRandom::block(key, 1, nonce, out);
+	if (memcmp(out, expected, RADIUS_RANDOM_BLOCK_LEN)!=0)
+	{
+		cerr << "RadiusRandomTest: The ChaCha20 block differs from RFC 8439, section 2.3.2.\n";
+		return 1;
+	}
+	return 0;
+}
+
+/** Checks that the generator serves different data for every call, also
+ * across a refill of the buffer.
+ * @return The number of errors.
+ */
+static int checkGenerator(void)
+{
+	Octet a[RADIUS_RANDOM_BUFFER_LEN], b[RADIUS_RANDOM_BUFFER_LEN], zero[RADIUS_RANDOM_BUFFER_LEN];
+	int errors=0;
+
+	memset(zero, 0, sizeof(zero));
+	if (RadiusRandom::random(a, 16)!=0 || RadiusRandom::random(b, 16)!=0)
+	{
+		cerr << "RadiusRandomTest: The generator got no key.\n";
+		return 1;
+	}
+	if (memcmp(a, b, 16)==0 || memcmp(a, zero, 16)==0)
+	{
+		cerr << "RadiusRandomTest: The generator repeats its output.\n";
+		errors++;
+	}
+	//more than the buffer, so it is refilled in the call
+	if (RadiusRandom::random(a, sizeof(a))!=0 || RadiusRandom::random(b, sizeof(b))!=0)
+	{
+		cerr << "RadiusRandomTest: The generator failed on a refill.\n";
+		return errors+1;
+	}
+	if (memcmp(a, b, sizeof(a))==0 || memcmp(a+sizeof(a)-16, zero, 16)==0)
+	{
+		cerr << "RadiusRandomTest: The generator repeats its output after a refill.\n";
+		errors++;
+	}
+	return errors;
+}
+
+/** Checks that a forked process takes a new key. The parent and the child
+ * draw after the fork, the child sends its data through a pipe.
+ * @return 0 if the outputs differ, else 1.
+ */
+static int checkFork(void)
+{
+	Octet parent[16], child[16];
+	int fd[2], status;
+	pid_t pid;
+
+	//the parent has a key before the fork
+	RadiusRandom::random(parent, sizeof(parent));
+	if (pipe(fd)!=0)
+	{
+		cerr << "RadiusRandomTest: pipe failed.\n";
+		return 1;
+	}
+	pid=fork();
+	if (pid==0)
+	{
+		close(fd[0]);
+		RadiusRandom::random(child, sizeof(child));
+		if (write(fd[1], child, sizeof(child))!=sizeof(child))
+		{
+			_exit(1);
+		}
+		_exit(0);
+	}
+	close(fd[1]);
+	RadiusRandom::random(parent, sizeof(parent));
+	if (read(fd[0], child, sizeof(child))!=sizeof(child))
+	{
+		cerr << "RadiusRandomTest: The child sent no data.\n";
+		close(fd[0]);
+		waitpid(pid, &status, 0);
+		return 1;
+	}
+	close(fd[0]);
+	waitpid(pid, &status, 0);
+	if (memcmp(parent, child, sizeof(parent))==0)
+	{
+		cerr << "RadiusRandomTest: The forked process repeats the output of its parent.\n";
+		return 1;
+	}
+	return 0;
+}
+
+int main(void)
+{
+	int errors=0;
+
+	errors+=checkBlock();
+	errors+=checkGenerator();
+	errors+=checkFork();
+
+	if (errors!=0)
+	{
+		cerr << "RadiusRandomTest: " << errors << " errors.\n";
+		return 1;
+	}
+	cout << "RadiusRandomTest: ok\n";
+	return 0;
+}
@@ -20,7 +20,15 @@
  */
 
 #include "RadiusServer.h"
+#include "error.h"
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 
 /** The constructer of the class.
@@ -40,6 +48,19 @@ RadiusServer::RadiusServer(const std::string &name, const std::string &secret,
     this->retry=retry;
     this->wait=wait;
     this->sharedsecret=secret;
+    this->setSecretDigests();
+    this->sockets=2;
+    this->maxsockets=8;
+    this->minrto=100;
+    this->maxrto=0;
+    this->statusserver=true;
+    this->statusinterval=10;
+    this->weight=1;
+    this->sourceip="";
+    this->sourceport=0;
+    memset(&this->address, 0, sizeof(this->address));
+    this->addresslen=0;
+    this->resolvettl=300;
 
 
 }
@@ -63,6 +84,21 @@ RadiusServer &RadiusServer::operator=(const RadiusServer &s)
     this->acctport=s.acctport;
     this->authport=s.authport;
     this->sharedsecret=s.sharedsecret;
+    this->secretdigest=s.secretdigest;
+    this->hmacinner=s.hmacinner;
+    this->hmacouter=s.hmacouter;
+    this->sockets=s.sockets;
+    this->maxsockets=s.maxsockets;
+    this->minrto=s.minrto;
+    this->maxrto=s.maxrto;
+    this->statusserver=s.statusserver;
+    this->statusinterval=s.statusinterval;
+    this->weight=s.weight;
+    this->sourceip=s.sourceip;
+    this->sourceport=s.sourceport;
+    this->address=s.address;
+    this->addresslen=s.addresslen;
+    this->resolvettl=s.resolvettl;
     return (*this);
 }
 
@@ -151,6 +187,46 @@ int RadiusServer::getRetry()
 void RadiusServer::setSharedSecret(const std::string &secret)
 {
     this->sharedsecret=secret;
+    this->setSecretDigests();
+}
+
+/** The method computes the MD5 states after the sharedsecret, they are
+ * copied for every packet, so the secret is not hashed again.
+ */
+void RadiusServer::setSecretDigests(void)
+{
+    Octet key[MD5_BLOCK_LENGTH], pad[MD5_BLOCK_LENGTH];
+    int i;
+
+    this->secretdigest.reset();
+    this->secretdigest.update(this->sharedsecret.data(), this->sharedsecret.length());
+
+    //a key longer than a block is hashed first (RFC 2104)
+    memset(key, 0, sizeof(key));
+    if (this->sharedsecret.length()>MD5_BLOCK_LENGTH)
+    {
+        Md5 digest;
+        digest.update(this->sharedsecret.data(), this->sharedsecret.length());
+        digest.final(key);
+    }
+    else
+    {
+        memcpy(key, this->sharedsecret.data(), this->sharedsecret.length());
+    }
+    for (i=0; i<MD5_BLOCK_LENGTH; i++)
+    {
+        pad[i]=key[i] ^ 0x36;
+    }
+    this->hmacinner.reset();
+    this->hmacinner.update(pad, MD5_BLOCK_LENGTH);
+    for (i=0; i<MD5_BLOCK_LENGTH; i++)
+    {
+        pad[i]=key[i] ^ 0x5c;
+    }
+    this->hmacouter.reset();
+    this->hmacouter.update(pad, MD5_BLOCK_LENGTH);
+    memset(key, 0, sizeof(key));
+    memset(pad, 0, sizeof(pad));
 }
 
 /** The getter method for the  sharedsecret
@@ -161,6 +237,33 @@ const std::string &RadiusServer::getSharedSecret(void)
     return this->sharedsecret;
 }
 
+/** The getter method for the MD5 state after the sharedsecret.
+ * The password hash and the authenticators copy the state, so the
+ * secret is not hashed again for every packet.
+ * @return A reference to the MD5 state.
+ */
+const Md5 &RadiusServer::getSecretDigest(void)
+{
+    return this->secretdigest;
+}
+
+/** The method computes the HMAC-MD5 of data with the sharedsecret as key,
+ * like it is needed for the Message-Authenticator attribute (RFC 3579).
+ * @param data The data.
+ * @param len The length of the data.
+ * @param digest An array for the 16 octets of the HMAC.
+ */
+void RadiusServer::hmac(const Octet *data, int len, Octet *digest)
+{
+    Md5 inner=this->hmacinner, outer=this->hmacouter;
+    Octet d[MD5_DIGEST_LENGTH];
+
+    inner.update(data, len);
+    inner.final(d);
+    outer.update(d, MD5_DIGEST_LENGTH);
+    outer.final(digest);
+}
+
 
 /** The getter method for the private member wait*
  * @return A interger of the time to wait for a resopnse.
@@ -186,6 +289,349 @@ void RadiusServer::setWait(int w)
     }
 }
 
+/** The getter method for the number of sockets per port.
+ * @return The number of sockets.
+ */
+int RadiusServer::getSockets(void)
+{
+    return this->sockets;
+}
+
+
+/** The setter method for the number of sockets per port.
+ * @param n The number of sockets. If n is less or equal 0 it is set to 1.
+ */
+void RadiusServer::setSockets(int n)
+{
+    if (n>0)
+    {
+        this->sockets=n;
+    }
+    else
+    {
+        this->sockets=1;
+    }
+}
+
+
+/** The getter method for the maximum number of sockets per port. More sockets
+ * than getSockets() are only opened if the ports are ephemeral, the sockets with
+ * fixed source ports would share the ports of the other sockets.
+ * @return The maximum number of sockets, at least getSockets().
+ */
+int RadiusServer::getMaxSockets(void)
+{
+    if (this->sourceport>0 || this->maxsockets<this->sockets)
+    {
+        return this->sockets;
+    }
+    return this->maxsockets;
+}
+
+
+/** The setter method for the maximum number of sockets per port.
+ * @param n The maximum number of sockets.
+ */
+void RadiusServer::setMaxSockets(int n)
+{
+    this->maxsockets=n;
+}
+
+
+/** The getter method for the lower bound of the retransmission timeout.
+ * @return The time in milliseconds, at most getMaxRto().
+ */
+int RadiusServer::getMinRto(void)
+{
+    if (this->minrto>this->getMaxRto())
+    {
+        return this->getMaxRto();
+    }
+    return this->minrto;
+}
+
+
+/** The setter method for the lower bound of the retransmission timeout.
+ * @param ms The time in milliseconds. If ms is less than 1 it is set to 1.
+ */
+void RadiusServer::setMinRto(int ms)
+{
+    this->minrto=(ms>0) ? ms : 1;
+}
+
+
+/** The getter method for the upper bound of the retransmission timeout.
+ * @return The time in milliseconds, the wait if no bound is set.
+ */
+int RadiusServer::getMaxRto(void)
+{
+    if (this->maxrto>0)
+    {
+        return this->maxrto;
+    }
+    return (this->wait>0) ? this->wait*1000 : 1000;
+}
+
+
+/** The setter method for the upper bound of the retransmission timeout.
+ * @param ms The time in milliseconds, 0 for the wait of the server.
+ */
+void RadiusServer::setMaxRto(int ms)
+{
+    this->maxrto=(ms>0) ? ms : 0;
+}
+
+
+/** The getter method for the probing with Status-Server packets.
+ * @return True if a dead server is probed with Status-Server packets (RFC 5997),
+ * false if it is used again after the status interval.
+ */
+bool RadiusServer::getStatusServer(void)
+{
+    return this->statusserver;
+}
+
+
+/** The setter method for the probing with Status-Server packets.
+ * @param b True to probe a dead server with Status-Server packets.
+ */
+void RadiusServer::setStatusServer(bool b)
+{
+    this->statusserver=b;
+}
+
+
+/** The getter method for the time between the probes of a dead server.
+ * @return The time in seconds.
+ */
+int RadiusServer::getStatusInterval(void)
+{
+    return this->statusinterval;
+}
+
+
+/** The setter method for the time between the probes of a dead server.
+ * @param s The time in seconds. If s is less than 1 it is set to 1.
+ */
+void RadiusServer::setStatusInterval(int s)
+{
+    this->statusinterval=(s>0) ? s : 1;
+}
+
+
+/** The getter method for the weight of the server.
+ * @return The weight, 0 if the server is only used when no server with a weight is alive.
+ */
+int RadiusServer::getWeight(void)
+{
+    return this->weight;
+}
+
+
+/** The setter method for the weight of the server.
+ * @param w The weight. If w is less than 0 it is set to 0.
+ */
+void RadiusServer::setWeight(int w)
+{
+    this->weight=(w>0) ? w : 0;
+}
+
+
+/** The getter method for the local address of the sockets.
+ * @return The address, it is empty if the sockets are bound to any address.
+ */
+const std::string &RadiusServer::getSourceIp(void)
+{
+    return this->sourceip;
+}
+
+
+/** The setter method for the local address of the sockets.
+ * @param ip The address, empty for any address.
+ */
+void RadiusServer::setSourceIp(const std::string &ip)
+{
+    this->sourceip=ip;
+}
+
+
+/** The getter method for the first local port of the sockets.
+ * @return The port, 0 if the ports are ephemeral.
+ */
+int RadiusServer::getSourcePort(void)
+{
+    return this->sourceport;
+}
+
+
+/** The setter method for the first local port of the sockets.
+ * The socket with the index i to the authentication port is bound to port+i,
+ * the socket to the accounting port to port+sockets+i.
+ * @param port The port, 0 for ephemeral ports.
+ */
+void RadiusServer::setSourcePort(int port)
+{
+    this->sourceport=port;
+}
+
+
+/** The getter method for the time after which the name is resolved again.
+ * @return The time in seconds, 0 if the name is resolved only once.
+ */
+int RadiusServer::getResolveTtl(void)
+{
+    return this->resolvettl;
+}
+
+
+/** The setter method for the time after which the name is resolved again.
+ * @param ttl The time in seconds, 0 if the name is resolved only once.
+ */
+void RadiusServer::setResolveTtl(int ttl)
+{
+    if (ttl>=0)
+    {
+        this->resolvettl=ttl;
+    }
+    else
+    {
+        this->resolvettl=0;
+    }
+}
+
+
+/** The method resolves the IPv4 address of a name. getaddrinfo() is
+ * used instead of gethostbyname(), because it is thread safe.
+ * @param name The name or ip address.
+ * @param addr The address, the port is not set.
+ * @param len The length of the address.
+ * @return 0 if everything is ok, else UNKNOWN_HOST.
+ */
+int RadiusServer::lookup(const std::string &name, struct sockaddr_storage *addr, socklen_t *len)
+{
+    struct addrinfo hints, *res;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family=AF_INET;
+    hints.ai_socktype=SOCK_DGRAM;
+    if (getaddrinfo(name.c_str(), NULL, &hints, &res)!=0)
+    {
+        return UNKNOWN_HOST;
+    }
+    memset(addr, 0, sizeof(struct sockaddr_storage));
+    memcpy(addr, res->ai_addr, res->ai_addrlen);
+    *len=res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+
+/** The method resolves the name of the server and saves the address. It is
+ * called when the configuration is parsed, so the packets are sent without
+ * asking the resolver.
+ * @return 0 if everything is ok, else UNKNOWN_HOST.
+ */
+int RadiusServer::resolve(void)
+{
+    return lookup(this->name, &this->address, &this->addresslen);
+}
+
+
+/** The method returns the address of the server with a port. The name is
+ * not resolved here, if it was not resolved so far the resolver thread of
+ * the RadiusClient tries it again.
+ * @param addr The address.
+ * @param len The length of the address.
+ * @param port The port.
+ * @return 0 if everything is ok, else UNKNOWN_HOST.
+ */
+int RadiusServer::getAddress(struct sockaddr_storage *addr, socklen_t *len, int port)
+{
+    if (this->addresslen==0)
+    {
+        return UNKNOWN_HOST;
+    }
+    memcpy(addr, &this->address, sizeof(struct sockaddr_storage));
+    *len=this->addresslen;
+    ((struct sockaddr_in *) addr)->sin_port=htons(port);
+    return 0;
+}
+
+
+/** The method sets a new address of the server, e.g. after the name was resolved again.
+ * @param addr The address, the port is not set.
+ * @param len The length of the address.
+ * @return True if the address changed.
+ */
+bool RadiusServer::setAddress(const struct sockaddr_storage *addr, socklen_t len)
+{
+    if (len==this->addresslen && memcmp(addr, &this->address, len)==0)
+    {
+        return false;
+    }
+    memcpy(&this->address, addr, sizeof(struct sockaddr_storage));
+    this->addresslen=len;
+    return true;
+}
+
+
+/** The method opens a long-lived UDP socket of the pool. The socket
+ * is bound to the source address and port and it is connected to the server,
+ * so it only receives datagrams from the server. The socket is non-blocking.
+ * @param acct True for the accounting port, false for the authentication port.
+ * @param index The index of the socket in the pool, the source port is sourceport+index for the
+ * authentication port and sourceport+sockets+index for the accounting port.
+ * @return The socket, or UNKNOWN_HOST, BAD_IP, SOCKET_ERROR or BIND_ERROR.
+ */
+int RadiusServer::openSocket(bool acct, int index)
+{
+    struct sockaddr_storage addr;
+    struct sockaddr_in local;
+    socklen_t addrlen;
+    int fd, on=1;
+
+    if (this->getAddress(&addr, &addrlen, acct ? this->getAcctPort() : this->getAuthPort())!=0)
+    {
+        return UNKNOWN_HOST;
+    }
+
+    memset(&local, 0, sizeof(local));
+    local.sin_family=AF_INET;
+    local.sin_addr.s_addr=htonl(INADDR_ANY);
+    if (this->sourceip.length()>0 && inet_pton(AF_INET, this->sourceip.c_str(), &local.sin_addr)!=1)
+    {
+        return BAD_IP;
+    }
+    local.sin_port=htons(this->sourceport>0 ? this->sourceport+(acct ? this->sockets : 0)+index : 0);
+
+    if ((fd=socket(AF_INET, SOCK_DGRAM, 0))<0)
+    {
+        cerr << "RadiusServer: Cannot open socket: " << strerror(errno) << "\n";
+        return SOCKET_ERROR;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    //the sockets to different servers share the source ports
+    if (this->sourceport>0)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if ((this->sourceip.length()>0 || this->sourceport>0) &&
+        bind(fd, (struct sockaddr *) &local, sizeof(local))<0)
+    {
+        cerr << "RadiusServer: Cannot bind socket to " << this->sourceip << ":" << ntohs(local.sin_port) << ": " << strerror(errno) << "\n";
+        close(fd);
+        return BIND_ERROR;
+    }
+    if (connect(fd, (struct sockaddr *) &addr, addrlen)<0)
+    {
+        cerr << "RadiusServer: Cannot connect socket: " << strerror(errno) << "\n";
+        close(fd);
+        return SOCKET_ERROR;
+    }
+    return fd;
+}
+
 ostream& operator << (ostream& os, RadiusServer& server)
 {
      os << "\n\nRadiusServer:";
@@ -194,6 +640,12 @@ ostream& operator << (ostream& os, RadiusServer& server)
      os << "\nAccounting-Port: " << server.acctport;
      os << "\nRetries: " << server.retry;
      os << "\nWait: " << server.wait;
+     os << "\nRTO: " << server.getMinRto() << "-" << server.getMaxRto() << "ms";
+     os << "\nSockets: " << server.sockets << " (max " << server.maxsockets << ")";
+     os << "\nSource: " << server.sourceip << ":" << server.sourceport;
+     os << "\nResolve-TTL: " << server.resolvettl;
+     os << "\nStatus-Server: " << (server.statusserver ? "yes" : "no") << ", every " << server.statusinterval << "s";
+     os << "\nWeight: " << server.weight;
      os << "\nSharedSecret: *******";
     return os;
 
@@ -23,6 +23,9 @@
 #define _RADIUSSERVER_H_
 #include <string>
 #include <iostream>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "Md5.h"
 
 using namespace std;
 /** This class represents a radius server.*/
@@ -35,7 +38,24 @@ private:
     string name;                /**< The name or the ip address of the server.*/
     int     retry;              /**< The number of retries how many times a radius ticket is send to the server, if it doesn#t answer.*/
     string sharedsecret;        /**< The sharedsecret, the maximum space is 16 chars.*/
+    Md5 secretdigest;           /**< The MD5 state after the sharedsecret, every digest starts with a copy of it.*/
+    Md5 hmacinner;              /**< The MD5 state after the HMAC-MD5 key XOR ipad, the key is the sharedsecret.*/
+    Md5 hmacouter;              /**< The MD5 state after the HMAC-MD5 key XOR opad.*/
     int     wait;               /**< The time to wait for a response of the server.*/
+    int     sockets;            /**< The number of long-lived UDP sockets per port of the server.*/
+    int     maxsockets;         /**< The number of sockets per port when all identifiers of the sockets are in use.*/
+    int     minrto;             /**< The lower bound of the retransmission timeout in milliseconds.*/
+    int     maxrto;             /**< The upper bound of the retransmission timeout in milliseconds, 0 for the wait.*/
+    bool    statusserver;       /**< True if a dead server is probed with Status-Server packets.*/
+    int     statusinterval;     /**< The time in seconds between the probes of a dead server.*/
+    int     weight;             /**< The share of the requests the server gets when the requests are balanced, 0 for a backup server.*/
+    string  sourceip;           /**< The local address the sockets are bound to, empty for any address.*/
+    int     sourceport;         /**< The first local port of the sockets, 0 for ephemeral ports.*/
+    struct sockaddr_storage address; /**< The resolved address of the server, the port is not set.*/
+    socklen_t addresslen;       /**< The length of the address, 0 if the name is not resolved.*/
+    int     resolvettl;         /**< The time in seconds after which the name is resolved again, 0 for never.*/
+
+    void    setSecretDigests(void);
 
 public:
 
@@ -57,6 +77,8 @@ public:
 
   void setSharedSecret(const std::string&);
   const std::string &getSharedSecret(void);
+  const Md5 &getSecretDigest(void);
+  void hmac(const Octet *, int, Octet *);
 
     int getAuthPort();
     void setAuthPort(short int);
@@ -67,6 +89,43 @@ public:
   const std::string &getName();
   void setName(const std::string&);
 
+    int getSockets(void);
+    void setSockets(int);
+
+    int getMaxSockets(void);
+    void setMaxSockets(int);
+
+    int getMinRto(void);
+    void setMinRto(int);
+
+    int getMaxRto(void);
+    void setMaxRto(int);
+
+    bool getStatusServer(void);
+    void setStatusServer(bool);
+
+    int getStatusInterval(void);
+    void setStatusInterval(int);
+
+    int getWeight(void);
+    void setWeight(int);
+
+  const std::string &getSourceIp(void);
+  void setSourceIp(const std::string&);
+
+    int getSourcePort(void);
+    void setSourcePort(int);
+
+    int getResolveTtl(void);
+    void setResolveTtl(int);
+
+    static int lookup(const std::string &, struct sockaddr_storage *, socklen_t *);
+    int resolve(void);
+    int getAddress(struct sockaddr_storage *, socklen_t *, int);
+    bool setAddress(const struct sockaddr_storage *, socklen_t);
+
+    int openSocket(bool, int);
+
     friend ostream& operator << (ostream& os, RadiusServer& server);
 };
 
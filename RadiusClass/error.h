@@ -41,4 +41,5 @@
 #define UNSHAPE_ERROR -15
 #define NO_VALUE_IN_ATTRIBUTE -16
 #define WRONG_AUTHENTICATOR_IN_RECV_PACKET -17
+#define RANDOM_ERROR -18
 #endif //_ERROR_H_
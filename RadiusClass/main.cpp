@@ -702,42 +702,34 @@ void parseResponsePacket(RadiusPacket *packet)
 {
 	cout << "\n ---- Parse Response Packet ----";
 	
-	pair <multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::iterator> range;
-	multimap<Octet,RadiusAttribute>::iterator iter1, iter2;
+	RadiusAttributeView view;
+	int pos;
 	
-		
-	range=packet->findAttributes(22);
-	iter1=range.first;
-	iter2=range.second;	
 	string froutes;
 	string ip;
-	int acct_interval;
+	int acct_interval=0;
 	RadiusVendorSpecificAttribute vsa;
 	
-	while (iter1!=iter2)
+	pos=0;
+	while (packet->findAttribute(ATTRIB_Framed_Route, &pos, &view))
 	{
-		froutes.append((char *) iter1->second.getValue(),iter1->second.getLength()-2);
+		froutes.append((char *) view.value,view.length);
 		froutes.append(";");
-		iter1++;
 	}
 	cout << "\nFramed Routs: " << froutes;
 		
-	range=packet->findAttributes(ATTRIB_Framed_IP_Address);
-	iter1=range.first;
-	iter2=range.second;	
-	if (iter1!=iter2)
+	pos=0;
+	if (packet->findAttribute(ATTRIB_Framed_IP_Address, &pos, &view))
 	{
-		ip=iter1->second.ipFromBuf();
+		ip=view.ipFromBuf();
 	}
 	cout << "\nFramed IP: " << ip;
 		
 	
-	range=packet->findAttributes(85);
-	iter1=range.first;
-	iter2=range.second;		
-	if (iter1!=iter2)
+	pos=0;
+	if (packet->findAttribute(ATTRIB_Acct_Interim_Interval, &pos, &view))
 	{
-		acct_interval=iter1->second.intFromBuf();
+		acct_interval=view.intFromBuf();
 	}
 	else
 	{
@@ -745,22 +737,20 @@ void parseResponsePacket(RadiusPacket *packet)
 	}
 	cout << "\nAcct-Interim-Interval: " << acct_interval;
 	
-	range=packet->findAttributes(26);
-	iter1=range.first;
-	iter2=range.second;		
-	if (iter1!=iter2)
+	pos=0;
+	if (packet->findAttribute(ATTRIB_Vendor_Specific, &pos, &view))
 	{
-		while(iter1!=iter2)
+		do
 		{
-			vsa.decodeRecvAttribute(iter1->second.getValue());
+			vsa.decodeRecvAttribute(view.value);
 			if (vsa.getId() == 111 && vsa.getType()==1)
 			{
 				
 				cout << "\nVendorSpecificAttribute OpenVPN IRoute: " << vsa.stringFromBuf() << " \n";
-				iter1++;
 				
 			}
 		}
+		while (packet->findAttribute(ATTRIB_Vendor_Specific, &pos, &view));
 	}
 	else
 	{
@@ -43,6 +43,9 @@ typedef	unsigned char	Octet;
 /** Some length definitions */
 #define	RADIUS_PACKET_AUTHENTICATOR_LEN	16
 #define	RADIUS_MAX_PACKET_LEN			4096
+#define	RADIUS_PACKET_HEADER_LEN		20
+#define	RADIUS_MAX_ATTRIBUTE_LEN		253	//the maximum length of a value
+#define	RADIUS_MAX_PASSWORD_LEN			128
 #define RADIUS_PACKET_IDENTIFIER_LEN	1
 #define MD5_DIGEST_LENGTH 16
 
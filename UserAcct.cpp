@@ -22,6 +22,52 @@
 #include "UserAcct.h"
 #include "radiusplugin.h"
 
+/** The callback for an accounting packet which was submitted
+ * to the radius client. It logs the result and frees the packet.
+ */
+class AcctCallback : public RadiusRequestCallback
+{
+private:
+    PluginContext * context;    /**<The context of the plugin.*/
+    RadiusPacket * packet;      /**<The accounting packet.*/
+    string commonname;          /**<The commonname of the user for the log.*/
+    string tag;                 /**<The tag for the log.*/
+    string ticket;              /**<The name of the packet for the log, like "Stop".*/
+
+public:
+    AcctCallback(PluginContext * context, RadiusPacket * packet, const string &commonname,
+                 const string &tag, const string &ticket)
+    {
+      this->context=context;
+      this->packet=packet;
+      this->commonname=commonname;
+      this->tag=tag;
+      this->ticket=ticket;
+    }
+
+    void complete(RadiusPacket * response, int result)
+    {
+      StdLogger log(this->tag, context->getVerbosity());
+      if (result >= 0 && response->getCode()==ACCOUNTING_RESPONSE)
+      {
+        log.debug() << "Get ACCOUNTING_RESPONSE-Packet.\n";
+        log.debug() << this->ticket << " packet was sent. CN: " << this->commonname << ".\n";
+      }
+      else if (result >= 0)
+      {
+        log.debug() << "No response on accounting request.\n";
+        log() << "Error on sending " << this->ticket << " packet. CN: " << this->commonname << ".\n";
+      }
+      else
+      {
+        log() << "Fail to receive radius response, code: " << result << endl;
+        log() << "Error on sending " << this->ticket << " packet. CN: " << this->commonname << ".\n";
+      }
+      delete this->packet;
+      delete this;
+    }
+};
+
 /** The constructor calls the super constructor of the class User and the variables
  * sessionid, bytesin, bytesout, nextupdate and starttime are set to 0.*/
 UserAcct::UserAcct():User()
@@ -74,7 +120,7 @@ UserAcct::UserAcct(const UserAcct &u):User(u)
 
 }
 
-/** The method sends an accounting update packet for the user to the radius server.
+/** The method builds an accounting update packet for the user.
  * The accounting information are read from the OpenVpn
  * status file. The following attributes are sent to the radius server:
  * - User_Name,
@@ -94,28 +140,17 @@ UserAcct::UserAcct(const UserAcct &u):User(u)
  * - Acct_Input_Gigawords,
  * - Acct_Output_Gigawords
  * @param context The context of the plugin.
- * @return An integer, 0 is everything is ok, else 1.*/
-int UserAcct::sendUpdatePacket(PluginContext *context)
+ * @param packet The packet which gets the attributes.*/
+void UserAcct::shapeUpdatePacket(PluginContext *context, RadiusPacket *packet)
 {
   StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-UPDTICKET]", context->getVerbosity());
 
-    list<RadiusServer> * serverlist;
-    list<RadiusServer>::iterator server;
-
-    log.debug() << "prepare to send... \n";
-
-    RadiusPacket        packet(ACCOUNTING_REQUEST);
     RadiusAttribute     ra1(ATTRIB_User_Name,this->getUsername()),
                 ra2(ATTRIB_Framed_IP_Address,this->getFramedIp()),
                 ra3(ATTRIB_NAS_Port,this->getPortnumber()),
                 ra4(ATTRIB_Calling_Station_Id,this->getCallingStationId()),
-                ra5(ATTRIB_NAS_Identifier),
-                ra6(ATTRIB_NAS_IP_Address),
-                ra7(ATTRIB_NAS_Port_Type),
-                ra8(ATTRIB_Service_Type),
                 ra9(ATTRIB_Acct_Session_ID, this->getSessionId()),
                         ra10(ATTRIB_Acct_Status_Type,string("3")), // "Alive"
-                ra11(ATTRIB_Framed_Protocol),
                 ra12(ATTRIB_Acct_Input_Octets, this->bytesin),
                 ra13(ATTRIB_Acct_Output_Octets, this->bytesout),
                 ra14(ATTRIB_Acct_Session_Time),
@@ -124,109 +159,73 @@ int UserAcct::sendUpdatePacket(PluginContext *context)
 
 
 
-    //get the server list
-    serverlist=context->radiusconf.getRadiusServer();
-
-    if(!serverlist) {
-      log() << "radius server addresses corrupted or not inited\n";
-    }
-
-    //set server on the first server
-    server=serverlist->begin();
-
     //add the attributes to the radius packet
-    if(packet.addRadiusAttribute(&ra1)) {
+    if(packet->addRadiusAttribute(&ra1)) {
       log() << "Fail to add attribute ATTRIB_User_Name.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra2)) {
+    if (packet->addRadiusAttribute(&ra2)) {
       log() << "Fail to add attribute ATTRIB_User_Password.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra3)) {
+    if (packet->addRadiusAttribute(&ra3)) {
       log() << "Fail to add attribute ATTRIB_NAS_Port.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra4)) {
+    if (packet->addRadiusAttribute(&ra4)) {
       log() << "Fail to add attribute ATTRIB_Calling_Station_Id.\n";
     }
 
-    //get the values from the config and add them to the packet
-    if(strcmp(context->radiusconf.getNASIdentifier(),"")) {
-        ra5.setValue(context->radiusconf.getNASIdentifier());
-        if (packet.addRadiusAttribute(&ra5)) {
-          log() << "Fail to add attribute ATTRIB_NAS_Identifier.\n";
-        }
-    }
-
-    if(strcmp(context->radiusconf.getNASIpAddress(),""))
-    {
-            if(ra6.setValue(context->radiusconf.getNASIpAddress())!=0) {
-              log() << "Fail to set value ATTRIB_NAS_Ip_Address.\n";
-            }
-            if (packet.addRadiusAttribute(&ra6)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Ip_Address.\n";
-            }
-    }
-
-    if(strcmp(context->radiusconf.getNASPortType(),""))
-    {
-            ra7.setValue(context->radiusconf.getNASPortType());
-            if (packet.addRadiusAttribute(&ra7)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Port_Type.\n";
-            }
+    //the NAS attributes were encoded when the config was read
+    if (packet->addRadiusAttributes(context->radiusconf.getNasAttributes(),
+                                   context->radiusconf.getNasAttributesLen(true))) {
+      log() << "Fail to add the NAS attributes.\n";
     }
 
-    if(strcmp(context->radiusconf.getServiceType(),"")) {
-            ra8.setValue(context->radiusconf.getServiceType());
-            if (packet.addRadiusAttribute(&ra8)) {
-              log() << "Fail to add attribute ATTRIB_Service_Type.\n";
-            }
-    }
-
-    if (packet.addRadiusAttribute(&ra9)) {
+    if (packet->addRadiusAttribute(&ra9)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra10)) {
+    if (packet->addRadiusAttribute(&ra10)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
 
-    if(strcmp(context->radiusconf.getFramedProtocol(),"")) {
-            ra11.setValue(context->radiusconf.getFramedProtocol());
-            if (packet.addRadiusAttribute(&ra11)) {
-              log() << "Fail to add attribute ATTRIB_Framed_Protocol.\n";
-            }
-    }
-
-    if (packet.addRadiusAttribute(&ra12)) {
+    if (packet->addRadiusAttribute(&ra12)) {
       log() << "Fail to add attribute ATTRIB_Acct_Input_Packets.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra13)) {
+    if (packet->addRadiusAttribute(&ra13)) {
       log() << "Fail to add attribute ATTRIB_Acct_Output_Packets.\n";
     }
     //calculate the session time
     ra14.setValue((time(NULL)-this->starttime));
-    if (packet.addRadiusAttribute(&ra14)) {
+    if (packet->addRadiusAttribute(&ra14)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_Time.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra15)) {
+    if (packet->addRadiusAttribute(&ra15)) {
       log() << "Fail to add attribute ATTRIB_Acct_Input_Gigawords.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra16)) {
+    if (packet->addRadiusAttribute(&ra16)) {
       log() << "Fail to add attribute ATTRIB_Acct_Output_Gigawords.\n";
     }
+}
 
-    //send the packet to the server
-    if (packet.radiusSend(server)<0) {
-      log() << "Packet was not sent, Trying to get response?\n";
-    }
+/** The method sends an accounting update packet for the user to the radius server and
+ * waits for the response. The packet is built by shapeUpdatePacket().
+ * @param context The context of the plugin.
+ * @return An integer, 0 is everything is ok, else 1.*/
+int UserAcct::sendUpdatePacket(PluginContext *context)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-UPDTICKET]", context->getVerbosity());
+  log.debug() << "prepare to send... \n";
+
+    RadiusPacket        packet(ACCOUNTING_REQUEST);
+    this->shapeUpdatePacket(context, &packet);
 
-    //get the response
-    int resCode = packet.radiusReceive(serverlist);
+    //send the packet and get the response
+    int resCode = context->radiusclient.send(&packet);
     if (resCode >= 0)
     {
         //is the packet a ACCOUNTING_RESPONSE?
@@ -245,8 +244,35 @@ int UserAcct::sendUpdatePacket(PluginContext *context)
     return 1;
 }
 
-/** The method sends an accounting start packet for the user to the radius server.
- *  The following attributes are sent to the radius server:
+/** The method submits an accounting update packet for the user to the radius client and
+ * returns at once. The radius client signs all update packets which are submitted
+ * together in one batch and the response is logged by the radius client thread.
+ * If the radius client is not running the packet is sent by sendUpdatePacket().
+ * @param context The context of the plugin.
+ * @param wakeup If false the radius client takes the packet when it is woken up
+ * by RadiusClient::wakeUp() or another request, so more packets can be submitted first.
+ * @return An integer, 0 is everything is ok, else 1.*/
+int UserAcct::submitUpdatePacket(PluginContext * context, bool wakeup)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-UPDTICKET]", context->getVerbosity());
+  log.debug() << "prepare to submit...\n";
+
+    RadiusPacket * packet = new RadiusPacket(ACCOUNTING_REQUEST);
+    this->shapeUpdatePacket(context, packet);
+
+    AcctCallback * callback = new AcctCallback(context, packet, this->getCommonname(),
+                                               "RADIUS-PLUGIN [PLUGIN-SEND-UPDTICKET]", "Update");
+    if (context->radiusclient.submit(packet, callback, wakeup) != 0)
+    {
+      delete callback;
+      delete packet;
+      return this->sendUpdatePacket(context);
+    }
+    return 0;
+}
+
+/** The method adds the attributes of the accounting start packet for the user to a packet.
+ *  The following attributes are added:
  * - User_Name,
  * - Framed_IP_Address,
  * - NAS_Port,
@@ -258,108 +284,65 @@ int UserAcct::sendUpdatePacket(PluginContext *context)
  * - Acct_Session_ID,
  * - Acct_Status_Type,
  * - Framed_Protocol,
- * @param  context The context of the plugin.
- * @return An integer, 0 is everything is ok, else 1.*/
-int UserAcct::sendStartPacket(PluginContext * context)
+ * @param context The context of the plugin.
+ * @param packet The packet, it must be an Accounting-Request.*/
+void UserAcct::shapeStartPacket(PluginContext * context, RadiusPacket * packet)
 {
   StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-STARTTICKET]", context->getVerbosity());
-  log.debug() << "prepare to send... \n";
 
-    list<RadiusServer>* serverlist;
-    list<RadiusServer>::iterator server;
-    RadiusPacket        packet(ACCOUNTING_REQUEST);
     RadiusAttribute     ra1(ATTRIB_User_Name,this->getUsername()),
                         ra2(ATTRIB_Framed_IP_Address,this->getFramedIp()),
                         ra3(ATTRIB_NAS_Port,this->getPortnumber()),
                         ra4(ATTRIB_Calling_Station_Id,this->getCallingStationId()),
-                        ra5(ATTRIB_NAS_Identifier),
-                        ra6(ATTRIB_NAS_IP_Address),
-                        ra7(ATTRIB_NAS_Port_Type),
-                        ra8(ATTRIB_Service_Type),
                         ra9(ATTRIB_Acct_Session_ID, this->getSessionId()),
-                                        ra10(ATTRIB_Acct_Status_Type,string("1")), // "Start"
-                        ra11(ATTRIB_Framed_Protocol);
+                                        ra10(ATTRIB_Acct_Status_Type,string("1")); // "Start"
 
 
 
-    //get the radius server from the config
-    serverlist=context->radiusconf.getRadiusServer();
-
-    if(!serverlist) {
-      log() << "radius server addresses corrupted or not inited\n";
-    }
-
-    //set server to the first from the list
-    server=serverlist->begin();
-
     //add the attributes to the packet
-    if(packet.addRadiusAttribute(&ra1)) {
+    if(packet->addRadiusAttribute(&ra1)) {
       log() << "Fail to add attribute ATTRIB_User_Name.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra2)) {
+    if (packet->addRadiusAttribute(&ra2)) {
       log() << "Fail to add attribute ATTRIB_User_Password.\n";
     }
-    if (packet.addRadiusAttribute(&ra3)) {
+    if (packet->addRadiusAttribute(&ra3)) {
       log() << "Fail to add attribute ATTRIB_NAS_Port.\n";
     }
-    if (packet.addRadiusAttribute(&ra4)) {
+    if (packet->addRadiusAttribute(&ra4)) {
       log() << "Fail to add attribute ATTRIB_Calling_Station_Id.\n";
     }
 
-    //get information from the config and add the attributes to the packet
-    if(strcmp(context->radiusconf.getNASIdentifier(),"")) {
-            ra5.setValue(context->radiusconf.getNASIdentifier());
-            if (packet.addRadiusAttribute(&ra5)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Identifier.\n";
-            }
-    }
-
-    if(strcmp(context->radiusconf.getNASIpAddress(),"")) {
-            if(ra6.setValue(context->radiusconf.getNASIpAddress())!=0) {
-              log() << "Fail to set value ATTRIB_NAS_Ip_Address.\n";
-            }
-
-            if (packet.addRadiusAttribute(&ra6)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Ip_Address.\n";
-            }
-    }
-    if(strcmp(context->radiusconf.getNASPortType(),"")) {
-            ra7.setValue(context->radiusconf.getNASPortType());
-            if (packet.addRadiusAttribute(&ra7)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Port_Type.\n";
-            }
-    }
-
-    if(strcmp(context->radiusconf.getServiceType(),"")) {
-            ra8.setValue(context->radiusconf.getServiceType());
-            if (packet.addRadiusAttribute(&ra8)) {
-              log() << "Fail to add attribute ATTRIB_Service_Type.\n";
-            }
+    //the NAS attributes were encoded when the config was read
+    if (packet->addRadiusAttributes(context->radiusconf.getNasAttributes(),
+                                    context->radiusconf.getNasAttributesLen(true))) {
+      log() << "Fail to add the NAS attributes.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra9)) {
+    if (packet->addRadiusAttribute(&ra9)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra10)) {
+    if (packet->addRadiusAttribute(&ra10)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
+}
 
-    if(strcmp(context->radiusconf.getFramedProtocol(),"")) {
-            ra11.setValue(context->radiusconf.getFramedProtocol());
-            if (packet.addRadiusAttribute(&ra11)) {
-              log() << "Fail to add attribute ATTRIB_Framed_Protocol.\n";
-            }
-    }
+/** The method sends an accounting start packet for the user to the radius server and
+ * waits for the response. The packet is built by shapeStartPacket().
+ * @param  context The context of the plugin.
+ * @return An integer, 0 is everything is ok, else 1.*/
+int UserAcct::sendStartPacket(PluginContext * context)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-STARTTICKET]", context->getVerbosity());
+  log.debug() << "prepare to send... \n";
 
-    //send the packet
-    if (packet.radiusSend(server) < 0) {
-      log() << "Packet was not sent, trying to get response?\n";
-    }
+    RadiusPacket        packet(ACCOUNTING_REQUEST);
+    this->shapeStartPacket(context, &packet);
 
-    //receive the response
-    int ret=packet.radiusReceive(serverlist);
+    //send the packet and get the response
+    int ret = context->radiusclient.send(&packet);
     if (ret>=0) {
         //is is a accounting resopnse ?
         if(packet.getCode()==ACCOUNTING_RESPONSE) {
@@ -378,10 +361,30 @@ int UserAcct::sendStartPacket(PluginContext * context)
     return 1;
 }
 
+/** The method submits an accounting start packet for the user to the radius client and
+ * returns at once. The callback gets the response from the thread of the radius client,
+ * the client retries and tries the other servers like for sendStartPacket(). If the radius
+ * client is not running the packet is sent at once and the callback is called before
+ * the method returns.
+ * @param context The context of the plugin.
+ * @param packet An empty Accounting-Request, it must exist until the callback is called.
+ * @param callback The callback for the response.*/
+void UserAcct::submitStartPacket(PluginContext * context, RadiusPacket * packet, RadiusRequestCallback * callback)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-STARTTICKET]", context->getVerbosity());
+  log.debug() << "prepare to submit...\n";
+
+    this->shapeStartPacket(context, packet);
+    if (context->radiusclient.submit(packet, callback) != 0)
+    {
+      callback->complete(packet, context->radiusclient.send(packet));
+    }
+}
+
 
-/** The method sends an accounting stop packet for the user to the radius server.
+/** The method adds the attributes of the accounting stop packet for the user to a packet.
  * The accounting information are read from the OpenVpn
- * status file. The following attributes are sent to the radius server:
+ * status file before. The following attributes are added:
  * - User_Name,
  * - Framed_IP_Address,
  * - NAS_Port,
@@ -397,128 +400,87 @@ int UserAcct::sendStartPacket(PluginContext * context)
  * - Acct_Output_Octets,
  * - Acct_Session_Time
  * @param context The context of the plugin.
- * @return An integer, 0 is everything is ok, else 1.*/
-int UserAcct::sendStopPacket(PluginContext * context)
+ * @param packet The packet, it must be an Accounting-Request.*/
+void UserAcct::shapeStopPacket(PluginContext * context, RadiusPacket * packet)
 {
   StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-STOPTICKET]", context->getVerbosity());
-  log.debug() << "prepare to send...\n";
 
-    list<RadiusServer> * serverlist;
-    list<RadiusServer>::iterator server;
-    RadiusPacket        packet(ACCOUNTING_REQUEST);
     RadiusAttribute     ra1(ATTRIB_User_Name,this->getUsername()),
                 ra2(ATTRIB_Framed_IP_Address,this->getFramedIp()),
                 ra3(ATTRIB_NAS_Port,this->portnumber),
                 ra4(ATTRIB_Calling_Station_Id,this->getCallingStationId()),
-                ra5(ATTRIB_NAS_Identifier),
-                ra6(ATTRIB_NAS_IP_Address),
-                ra7(ATTRIB_NAS_Port_Type),
-                ra8(ATTRIB_Service_Type),
                 ra9(ATTRIB_Acct_Session_ID, this->getSessionId()),
                         ra10(ATTRIB_Acct_Status_Type,string("2")), // "Stop"
-                ra11(ATTRIB_Framed_Protocol),
                 ra12(ATTRIB_Acct_Input_Octets, this->bytesin),
                 ra13(ATTRIB_Acct_Output_Octets, this->bytesout),
                 ra14(ATTRIB_Acct_Session_Time),
                 ra15(ATTRIB_Acct_Input_Gigawords, this->gigain),
                 ra16(ATTRIB_Acct_Output_Gigawords, this->gigaout);
 
-    //get the server from the config
-    serverlist=context->radiusconf.getRadiusServer();
-    if(!serverlist) {
-      log() << "radius server addresses corrupted or not inited\n";
-    }
-    //set server to the first server
-    server=serverlist->begin();
-
     //add the attributes to the packet
-    if(packet.addRadiusAttribute(&ra1)) {
+    if(packet->addRadiusAttribute(&ra1)) {
       log() << "Fail to add attribute ATTRIB_User_Name.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra2)) {
+    if (packet->addRadiusAttribute(&ra2)) {
       log() << "Fail to add attribute ATTRIB_FramedIP_Address.\n";
     }
-    if (packet.addRadiusAttribute(&ra3)) {
+    if (packet->addRadiusAttribute(&ra3)) {
       log() << "Fail to add attribute ATTRIB_NAS_Port.\n";
     }
-    if (packet.addRadiusAttribute(&ra4)) {
+    if (packet->addRadiusAttribute(&ra4)) {
       log() << "Fail to add attribute ATTRIB_Calling_Station_Id.\n";
     }
 
-    //get information from th config and ad it to the packet
-    if(strcmp(context->radiusconf.getNASIdentifier(),"")) {
-            ra5.setValue(context->radiusconf.getNASIdentifier());
-            if (packet.addRadiusAttribute(&ra5)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Identifier.\n";
-            }
+    //the NAS attributes were encoded when the config was read
+    if (packet->addRadiusAttributes(context->radiusconf.getNasAttributes(),
+                                    context->radiusconf.getNasAttributesLen(true))) {
+      log() << "Fail to add the NAS attributes.\n";
     }
 
-    if(strcmp(context->radiusconf.getNASIpAddress(),"")) {
-            if(ra6.setValue(context->radiusconf.getNASIpAddress())!=0) {
-              log() << "Fail to set value ATTRIB_NAS_Ip_Address.\n";
-            }
-            else if (packet.addRadiusAttribute(&ra6))
-            {
-              log() << "Fail to add attribute ATTRIB_NAS_Ip_Address.\n";
-            }
-    }
-    if(strcmp(context->radiusconf.getNASPortType(),"")) {
-            ra7.setValue(context->radiusconf.getNASPortType());
-            if (packet.addRadiusAttribute(&ra7)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Port_Type.\n";
-            }
-    }
-
-    if(strcmp(context->radiusconf.getServiceType(),"")) {
-            ra8.setValue(context->radiusconf.getServiceType());
-            if (packet.addRadiusAttribute(&ra8)) {
-              log() << "Fail to add attribute ATTRIB_Service_Type.\n";
-            }
-    }
-    if (packet.addRadiusAttribute(&ra9)) {
+    if (packet->addRadiusAttribute(&ra9)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
-    if (packet.addRadiusAttribute(&ra10)) {
+    if (packet->addRadiusAttribute(&ra10)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
 
-    if(strcmp(context->radiusconf.getFramedProtocol(),"")) {
-            ra11.setValue(context->radiusconf.getFramedProtocol());
-            if (packet.addRadiusAttribute(&ra11)) {
-              log() << "Fail to add attribute ATTRIB_Framed_Protocol.\n";
-            }
-    }
-
-    if (packet.addRadiusAttribute(&ra12)) {
+    if (packet->addRadiusAttribute(&ra12)) {
       log() << "Fail to add attribute ATTRIB_Acct_Input_Packets.\n";
     }
-    if (packet.addRadiusAttribute(&ra13)) {
+    if (packet->addRadiusAttribute(&ra13)) {
       log() << "Fail to add attribute ATTRIB_Acct_Output_Packets.\n";
     }
 
     //calculate the session time
     ra14.setValue(time(NULL)-this->starttime);
-    if (packet.addRadiusAttribute(&ra14)) {
+    if (packet->addRadiusAttribute(&ra14)) {
       log() << "Fail to add attribute ATTRIB_Acct_Session_Time.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra15)) {
+    if (packet->addRadiusAttribute(&ra15)) {
       log() << "Fail to add attribute ATTRIB_Acct_Input_Gigawords.\n";
     }
 
-    if (packet.addRadiusAttribute(&ra16)) {
+    if (packet->addRadiusAttribute(&ra16)) {
       log() << "Fail to add attribute ATTRIB_Acct_Output_Gigawords.\n";
     }
+}
 
-    //send the packet
-    if (packet.radiusSend(server)<0) {
-      log() << "Packet was not sent, trying to get response?.\n";
-      // return 1;
-    }
+/** The method sends an accounting stop packet for the user to the radius server and
+ * waits for the response. The packet is built by shapeStopPacket().
+ * @param context The context of the plugin.
+ * @return An integer, 0 is everything is ok, else 1.*/
+int UserAcct::sendStopPacket(PluginContext * context)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-STOPTICKET]", context->getVerbosity());
+  log.debug() << "prepare to send...\n";
+
+    RadiusPacket        packet(ACCOUNTING_REQUEST);
+    this->shapeStopPacket(context, &packet);
 
-    //get the response
-    int resCode = packet.radiusReceive(serverlist);
+    //send the packet and get the response
+    int resCode = context->radiusclient.send(&packet);
     if (resCode >= 0)
     {
         //is it an accounting response
@@ -535,6 +497,31 @@ int UserAcct::sendStopPacket(PluginContext * context)
     return 1;
 }
 
+/** The method submits an accounting stop packet for the user to the radius client and
+ * returns at once. The response is logged by the radius client thread, the client
+ * retries and tries the other servers like for sendStopPacket(). If the radius
+ * client is not running the packet is sent by sendStopPacket().
+ * @param context The context of the plugin.
+ * @return An integer, 0 is everything is ok, else 1.*/
+int UserAcct::submitStopPacket(PluginContext * context)
+{
+  StdLogger log("RADIUS-PLUGIN [PLUGIN-SEND-STOPTICKET]", context->getVerbosity());
+  log.debug() << "prepare to submit...\n";
+
+    RadiusPacket * packet = new RadiusPacket(ACCOUNTING_REQUEST);
+    this->shapeStopPacket(context, packet);
+
+    AcctCallback * callback = new AcctCallback(context, packet, this->getCommonname(),
+                                               "RADIUS-PLUGIN [PLUGIN-SEND-STOPTICKET]", "Stop");
+    if (context->radiusclient.submit(packet, callback) != 0)
+    {
+      delete callback;
+      delete packet;
+      return this->sendStopPacket(context);
+    }
+    return 0;
+}
+
 /** The method deletes ths systemroutes of the user.
  * @param context The context of the plugin.
  */
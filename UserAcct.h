@@ -78,9 +78,15 @@ public:
 	
 	UserAcct(const UserAcct &);
 	
+	void shapeUpdatePacket(PluginContext *, RadiusPacket *);
 	int sendUpdatePacket(PluginContext *);
+	int submitUpdatePacket(PluginContext *, bool);
+	void shapeStartPacket(PluginContext *, RadiusPacket *);
 	int sendStartPacket(PluginContext *);
+	void submitStartPacket(PluginContext *, RadiusPacket *, RadiusRequestCallback *);
+	void shapeStopPacket(PluginContext *, RadiusPacket *);
 	int sendStopPacket(PluginContext *);
+	int submitStopPacket(PluginContext *);
 	void addSystemRoutes(PluginContext * );
 	void delSystemRoutes(PluginContext * context);	
 	int deleteCcdFile(PluginContext *);
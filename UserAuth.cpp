@@ -46,28 +46,17 @@ UserAuth::~UserAuth()
  * @return An integer, 0 if the authentication succeeded, else 1.*/
 int UserAuth::sendAcceptRequestPacket(PluginContext * context)
 {
-    list<RadiusServer> * serverlist;
-    list<RadiusServer>::iterator server;
     RadiusPacket        packet(ACCESS_REQUEST);
     RadiusAttribute     ra1(ATTRIB_User_Name,this->getUsername().c_str()),
                 ra2(ATTRIB_User_Password),
                 ra3(ATTRIB_NAS_Port,this->getPortnumber()),
                 ra4(ATTRIB_Calling_Station_Id,this->getCallingStationId()),
-                ra5(ATTRIB_NAS_Identifier),
-                ra6(ATTRIB_NAS_IP_Address),
-                ra7(ATTRIB_NAS_Port_Type),
-                ra8(ATTRIB_Service_Type),
                 ra9(ATTRIB_Framed_IP_Address),
                 ra10(ATTRIB_Acct_Session_ID, this->getSessionId());
     StdLogger log("RADIUS-PLUGIN [PLUGIN-AUTH-PACKET]", context->getVerbosity());
 
     log.debug() << "radius_server().\n";
 
-    //get the server list
-    serverlist=context->radiusconf.getRadiusServer();
-    //set server to the first server
-    server=serverlist->begin();
-
     log.debug() << "Build password packet\n";
 
     //add the attributes
@@ -85,41 +74,16 @@ int UserAuth::sendAcceptRequestPacket(PluginContext * context)
     if (packet.addRadiusAttribute(&ra4)) {
       log() << "Fail to add attribute ATTRIB_Calling_Station_Id.\n";
     }
-    //get information from the config and add it to the packet
-    if(strcmp(context->radiusconf.getNASIdentifier(),"")) {
-            ra5.setValue(context->radiusconf.getNASIdentifier());
-            if (packet.addRadiusAttribute(&ra5)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Identifier.\n";
-            }
-    }
-
-    if(strcmp(context->radiusconf.getNASIpAddress(),"")) {
-            if(ra6.setValue(context->radiusconf.getNASIpAddress())!=0) {
-              log() << "Fail to set value ATTRIB_NAS_Ip_Address.\n";
-            }
-            else if (packet.addRadiusAttribute(&ra6))
-            {
-              log() << "Fail to add attribute ATTRIB_NAS_Ip_Address.\n";
-            }
-    }
-    if(strcmp(context->radiusconf.getNASPortType(),"")) {
-            ra7.setValue(context->radiusconf.getNASPortType());
-            if (packet.addRadiusAttribute(&ra7)) {
-              log() << "Fail to add attribute ATTRIB_NAS_Port_Type.\n";
-            }
+    //the NAS attributes were encoded when the config was read
+    if (packet.addRadiusAttributes(context->radiusconf.getNasAttributes(),
+                                   context->radiusconf.getNasAttributesLen(false))) {
+      log() << "Fail to add the NAS attributes.\n";
     }
 
     if (packet.addRadiusAttribute(&ra10)) {
         log() << "Fail to add attribute ATTRIB_Acct_Session_ID.\n";
     }
 
-    if(strcmp(context->radiusconf.getServiceType(),"")) {
-            ra8.setValue(context->radiusconf.getServiceType());
-            if (packet.addRadiusAttribute(&ra8)) {
-              log() << "Fail to add attribute ATTRIB_Service_Type.\n";
-            }
-    }
-
     if(this->getFramedIp().compare("") != 0) {
         if (DEBUG (context->getVerbosity()))
           log() << "Send packet Re-Auth packet for framedIP = " << this->getFramedIp() << ".\n";
@@ -129,13 +93,10 @@ int UserAuth::sendAcceptRequestPacket(PluginContext * context)
             }
     }
 
-    log() << "Send packet to " << server->getName() <<".\n";
-    //send the packet
-    if (packet.radiusSend(server) < 0) {
-      log() << "Packet was not sent.\n";
-    }
-    //receive the packet
-    int rc=packet.radiusReceive(serverlist);
+    //the radius client chooses the server from the authentication pool
+    log() << "Send packet to the authentication servers.\n";
+    //send the packet and receive the response
+    int rc=context->radiusclient.send(&packet);
     if (rc==0)
     {
         //is it a accept?
@@ -172,64 +133,50 @@ int UserAuth::sendAcceptRequestPacket(PluginContext * context)
  */
 void UserAuth::parseResponsePacket(RadiusPacket *packet, PluginContext * context)
 {
-    pair <multimap<Octet,RadiusAttribute>::iterator,multimap<Octet,RadiusAttribute>::iterator> range;
-    multimap<Octet,RadiusAttribute>::iterator iter1, iter2;
-    RadiusVendorSpecificAttribute vsa;
+    RadiusAttributeView view;
+    int pos;
 
     StdLogger log("RADIUS-PLUGIN [PLUGIN-AUTH-RESPONSE]", context->getVerbosity());
 
     log.debug() << __func__ << "\n";
 
-    range=packet->findAttributes(22);
-    iter1=range.first;
-    iter2=range.second;
+    //the attributes are read in place from the receive buffer of the packet
+    pos=0;
     string froutes;
-    while (iter1!=iter2) {
-        froutes.append((char *) iter1->second.getValue(),iter1->second.getLength()-2);
+    while (packet->findAttribute(ATTRIB_Framed_Route, &pos, &view)) {
+        froutes.append((char *) view.value, view.length);
         froutes.append(";");
-        iter1++;
     }
     this->setFramedRoutes(froutes);
 
     log.debug() << "RADIUS-PLUGIN: BACKGROUND AUTH: routes: " << this->getFramedRoutes() <<".\n";
 
-    range=packet->findAttributes(8);
-    iter1=range.first;
-    iter2=range.second;
-
-    if (iter1!=iter2) {
-        this->setFramedIp(iter1->second.ipFromBuf());
+    pos=0;
+    if (packet->findAttribute(ATTRIB_Framed_IP_Address, &pos, &view)) {
+        this->setFramedIp(view.ipFromBuf());
     }
 
     log.debug() << "framed ip: " << this->getFramedIp() <<".\n";
 
-    range=packet->findAttributes(85);
-    iter1=range.first;
-    iter2=range.second;
-    if (iter1!=iter2) {
-        this->setAcctInterimInterval(iter1->second.intFromBuf());
+    pos=0;
+    if (packet->findAttribute(ATTRIB_Acct_Interim_Interval, &pos, &view) && view.length==4) {
+        this->setAcctInterimInterval(view.intFromBuf());
     } else {
       log() << "No attributes Acct Interim Interval or bad length.\n";
     }
 
     log.debug() << "Acct Interim Interval: " << this->getAcctInterimInterval() << ".\n";
 
-    range=packet->findAttributes(26);
-    iter1=range.first;
-    iter2=range.second;
-    while (iter1!=iter2) {
-        this->appendVsaBuf(iter1->second.getValue(), iter1->second.getLength()-2);
-        iter1++;
+    pos=0;
+    while (packet->findAttribute(ATTRIB_Vendor_Specific, &pos, &view)) {
+        this->appendVsaBuf(view.value, view.length);
     }
 
-    range=packet->findAttributes(18);
-    iter1=range.first;
-    iter2=range.second;
+    pos=0;
     string msg;
-    while (iter1!=iter2) {
-        msg.append((char*)iter1->second.getValue(),iter1->second.getLength()-2);
+    while (packet->findAttribute(ATTRIB_Reply_Message, &pos, &view)) {
+        msg.append((char *) view.value, view.length);
         cerr << getTime() <<"RADIUS-PLUGIN: BACKGROUND AUTH: Reply-Message:" << msg << "\n";
-        iter1++;
     }
 }
 
@@ -1430,10 +1377,12 @@ int UserAuth::createCcdFile(PluginContext *context)
     ofstream ccdfile;
 
     char * route;
+    char * saveptr;
     char framedip[16];
     char ipstring[100];
     in_addr_t ip2;
     in_addr ip3;
+    char ip3string[INET_ADDRSTRLEN];
     string filename;
     char framedroutes[4096];
     char framednetmask_cidr[3]; // ->/24
@@ -1516,7 +1465,7 @@ int UserAuth::createCcdFile(PluginContext *context)
                     //copy from one unsigned int to another (casting don't work with these struct!?)
                     memcpy(&ip3, &ip2, 4);
                     // append the new ip address to the string
-                    strncat(ipstring, inet_ntoa(ip3), 15);
+                    strncat(ipstring, inet_ntop(AF_INET, &ip3, ip3string, sizeof(ip3string)), 15);
                     if (DEBUG (context->getVerbosity()))
                         cerr << getTime() << "RADIUS-PLUGIN: BACKGROUND AUTH: Create ifconfig-push for topology net30.\n";
 
@@ -1534,7 +1483,7 @@ int UserAuth::createCcdFile(PluginContext *context)
                 if (DEBUG (context->getVerbosity()))
                     cerr << getTime() << "RADIUS-PLUGIN: BACKGROUND AUTH: Write framed routes to ccd-file.\n";
 
-                route=strtok(framedroutes,";");
+                route=strtok_r(framedroutes,";",&saveptr);
                 len=strlen(route);
                 if (len > 50) //this is too big! but the length is variable
                 {
@@ -1699,7 +1648,7 @@ int UserAuth::createCcdFile(PluginContext *context)
                             //write iroute to client file
                             ccdfile << "iroute " << framedip << " "<< framednetmask << "\n";
 
-                            route=strtok(NULL,";");
+                            route=strtok_r(NULL,";",&saveptr);
                     }
                 }
             }
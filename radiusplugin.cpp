@@ -61,6 +61,8 @@ extern "C"
     pid_t                   pid;        /**<process number*/
     int                     fd_auth[2]; /**<An array for the socket pair of the authentication process.*/
     int                     fd_acct[2]; /**<An array for the socket pair of the accounting process.*/
+    IpcRing *               authrings[2]={NULL, NULL}; /**<The rings in shared memory to and from the authentication process.*/
+    IpcRing *               acctrings[2]={NULL, NULL}; /**<The rings in shared memory to and from the accounting process.*/
     AccountingProcess       Acct;       /**<The accounting background process object.*/
     AuthenticationProcess   Auth;       /**<The authentication background process object.*/
     PluginContext *context = NULL;        /**<The context for this
@@ -137,6 +139,8 @@ extern "C"
         goto error;
       }
     }
+    context->authcache.setTtl(context->conf.getAuthCacheTtl());
+    context->loginthrottle.setLimits(context->conf.getFailMaxAttempts(), context->conf.getFailWindow(), context->conf.getFailCooldown());
 
     // Intercept the --auth-user-pass-verify, --client-connect and --client-disconnect callback.
     if (context->conf.getAccountingOnly()==false)
@@ -162,6 +166,17 @@ extern "C"
       log()<< " socketpair call failed for accounting process\n";
       goto error;
     }
+    //the rings in shared memory must be created before the fork
+    if ( context->conf.getShmIpc() )
+    {
+      if ( create_ipc_rings ( authrings ) != 0 || create_ipc_rings ( acctrings ) != 0 )
+      {
+        log() << " shared memory could not be created, the sockets are used\n";
+        delete authrings[0]; delete authrings[1];
+        delete acctrings[0]; delete acctrings[1];
+        authrings[0]=authrings[1]=acctrings[0]=acctrings[1]=NULL;
+      }
+    }
 
     //  Fork off the privileged processes.  It will remain privileged
     //  even after the foreground process drops its privileges.
@@ -189,6 +204,11 @@ extern "C"
 
       //save the socket number in the context
       context->authsocketbackgr.setSocket ( fd_auth[0] );
+      if ( authrings[0] )
+      {
+        authrings[0]->setPeer ( pid );
+        context->authsocketbackgr.setRings ( authrings[0], authrings[1] );
+      }
 
       //wait for background child process to initialize */
       status = context->authsocketbackgr.recvInt();
@@ -204,15 +224,20 @@ extern "C"
     else
     { //Background Process
 
+      //save the socket number in the context
+      context->authsocketforegr.setSocket ( fd_auth[1] );
+      if ( authrings[0] )
+      {
+        authrings[1]->setPeer ( getppid() );
+        context->authsocketforegr.setRings ( authrings[1], authrings[0] );
+      }
+
       // close all parent fds except our socket back to parent
-      close_fds_except ( fd_auth[1] );
+      close_fds_except ( &context->authsocketforegr );
 
       // Ignore most signals (the parent will receive them)
       set_signals ();
 
-      //save the socket number in the context
-      context->authsocketforegr.setSocket ( fd_auth[1] );
-
       //start the backgroung event loop for accounting
       Auth.Authentication ( context );
 
@@ -246,6 +271,11 @@ extern "C"
 
       //save the socket number in the context
       context->acctsocketbackgr.setSocket ( fd_acct[0] );
+      if ( acctrings[0] )
+      {
+        acctrings[0]->setPeer ( pid );
+        context->acctsocketbackgr.setRings ( acctrings[0], acctrings[1] );
+      }
 
       // wait for background child process to initialize */
       status = context->acctsocketbackgr.recvInt();
@@ -261,17 +291,22 @@ extern "C"
     else
     { //Background Process
 
+      // save the socket in the context
+      context->acctsocketforegr.setSocket ( fd_acct[1] );
+      if ( acctrings[0] )
+      {
+        acctrings[1]->setPeer ( getppid() );
+        context->acctsocketforegr.setRings ( acctrings[1], acctrings[0] );
+      }
+
       // close all parent fds except our socket back to parent
-      close_fds_except ( fd_acct[1] );
+      close_fds_except ( &context->acctsocketforegr );
 
       // Ignore most signals (the parent will receive them)
       set_signals ();
 
       log() << "Start BACKGROUND Process for accounting\n";
 
-      // save the socket in the context
-      context->acctsocketforegr.setSocket ( fd_acct[1] );
-
       //start the backgroung event loop for accounting
       Acct.Accounting ( context );
 
@@ -334,13 +369,12 @@ extern "C"
 
     if (context->getStartThread())
     {
-      pthread_cond_init (context->getCondSend(), NULL);
-      pthread_mutex_init (context->getMutexSend(), NULL);
       pthread_cond_init (context->getCondRecv(), NULL);
       pthread_mutex_init (context->getMutexRecv(), NULL);
 
       if (context->conf.getAccountingOnly() == false &&
-          pthread_create(context->getThread(), NULL, &auth_user_pass_verify, (void *) context) != 0)
+          (pthread_create(context->getThread(), NULL, &auth_user_pass_verify, (void *) context) != 0 ||
+           pthread_create(context->getRecvThread(), NULL, &auth_user_pass_receive, (void *) context) != 0))
       {
         cerr << getTime() << "RADIUS-PLUGIN: Auth thread creation failed.\n";
         return OPENVPN_PLUGIN_FUNC_ERROR;
@@ -355,6 +389,13 @@ extern "C"
                   << (long)context->getThread() << "]\n" << std::dec;
       }
 
+      //the responses of the acct background process are received by an own thread
+      if (pthread_create(context->getAcctRecvThread(), NULL, &acct_user_receive, (void *) context) != 0)
+      {
+        cerr << getTime() << "RADIUS-PLUGIN: Acct receive thread creation failed.\n";
+        return OPENVPN_PLUGIN_FUNC_ERROR;
+      }
+
       pthread_mutex_lock(context->getMutexRecv());
       context->setStartThread(false);
       pthread_mutex_unlock(context->getMutexRecv());
@@ -380,20 +421,29 @@ extern "C"
         if (newuser->getAuthControlFile().length() > 0 &&
             context->conf.getUseAuthControlFile())
         {
-          pthread_mutex_lock(context->getMutexSend());
-          context->addNewUser(newuser);
-          pthread_cond_signal( context->getCondSend( ));
-          pthread_mutex_unlock (context->getMutexSend());
-          return OPENVPN_PLUGIN_FUNC_DEFERRED;
+          if (context->addNewUser(newuser))
+          {
+            return OPENVPN_PLUGIN_FUNC_DEFERRED;
+          }
+          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Too many users wait for authentication.\n";
+          delete newuser;
+          return OPENVPN_PLUGIN_FUNC_ERROR;
         }
         else
         {
           pthread_mutex_lock(context->getMutexRecv());
-          pthread_mutex_lock(context->getMutexSend());
-          context->addNewUser(newuser);
-          pthread_cond_signal( context->getCondSend( ));
-          pthread_mutex_unlock (context->getMutexSend());
-          pthread_cond_wait( context->getCondRecv(), context->getMutexRecv());
+          context->setResult(OPENVPN_PLUGIN_FUNC_DEFERRED);
+          if (!context->addNewUser(newuser))
+          {
+            pthread_mutex_unlock (context->getMutexRecv());
+            cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Too many users wait for authentication.\n";
+            delete newuser;
+            return OPENVPN_PLUGIN_FUNC_ERROR;
+          }
+          //the receive thread sets the result
+          while (context->getResult() == OPENVPN_PLUGIN_FUNC_DEFERRED) {
+            pthread_cond_wait( context->getCondRecv(), context->getMutexRecv());
+          }
           pthread_mutex_unlock (context->getMutexRecv());
           return context->getResult();
         }
@@ -412,7 +462,6 @@ extern "C"
         cerr << getTime() << "Unknown Exception!";
       }
 
-      pthread_mutex_unlock (context->getMutexSend());
       pthread_mutex_unlock (context->getMutexRecv());
       return OPENVPN_PLUGIN_FUNC_ERROR;
       /////////////////////////// CLIENT_CONNECT
@@ -423,19 +472,25 @@ extern "C"
         cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: OPENVPN_PLUGIN_CLIENT_CONNECT is called.\n";
       }
 
+      //the user is only used while mutexUsers is held, the other threads can remove him
+      bool locked=false;
       try
       {
+        UserPlugin snapshot;   /**<A copy of the user for the accounting background process.*/
         tmpuser=new UserPlugin();
         get_user_env(context,type,envp, tmpuser);
         //find the user in the context, he was added at the OPENVPN_PLUGIN_AUTH_USER_PASS_VERIFY
         //string key=common_name + string ( "," ) +untrusted_ip+string ( ":" ) + string ( get_env ( "untrusted_port", envp ) );
 
+        pthread_mutex_lock(context->getMutexUsers());
+        locked=true;
         newuser=context->findUser(tmpuser->getKey());
         if (newuser == NULL)
         {
           if (context->conf.getAccountingOnly()==true) //Authentication part is missing, where this is done else
           {
             newuser=tmpuser;
+            tmpuser=NULL;
             newuser->setAuthenticated(true); //the plugin does not care about it
             newuser->setPortnumber ( context->addNasPort() );
             newuser->setSessionId ( createSessionId ( newuser ) );
@@ -444,11 +499,14 @@ extern "C"
           }
           else
           {
+            delete tmpuser;
+            tmpuser=NULL;
             throw Exception ( "RADIUS-PLUGIN: FOREGROUND: User should be accounted but is unknown, should only occur if accountingonly=true.\n" );
           }
         }
         else {
           delete tmpuser;
+          tmpuser=NULL;
         }
 
         //set the assigned ip as Framed-IP-Attribute of the user (see RFC2866, chapter 4.1 for more information)
@@ -467,25 +525,34 @@ extern "C"
           if ( DEBUG ( context->getVerbosity() ) )
             cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Add user for accounting: username: " << newuser->getUsername() << ", commonname: " << newuser->getCommonname() << "\n";
 
-          //send information to the background process
-          context->acctsocketbackgr.send ( ADD_USER );
-          context->acctsocketbackgr.send ( newuser->getUsername() );
-          context->acctsocketbackgr.send ( newuser->getSessionId() );
-          context->acctsocketbackgr.send ( newuser->getPortnumber() );
-          context->acctsocketbackgr.send ( newuser->getCallingStationId() );
-          context->acctsocketbackgr.send ( newuser->getFramedIp() );
-          context->acctsocketbackgr.send ( newuser->getCommonname() );
-          context->acctsocketbackgr.send ( newuser->getAcctInterimInterval() );
-          context->acctsocketbackgr.send ( newuser->getFramedRoutes() );
-          context->acctsocketbackgr.send ( newuser->getKey() );
-          context->acctsocketbackgr.send ( newuser->getStatusFileKey());
-          context->acctsocketbackgr.send ( newuser->getUntrustedPort() );
-          context->acctsocketbackgr.send ( newuser->getVsaBuf(), newuser->getVsaBufLen() );
-          //get the response
-          const int status = context->acctsocketbackgr.recvInt();
+          //the command is built from the copy, the users are not locked while the command is sent
+          snapshot=*newuser;
+          newuser=NULL;
+          locked=false;
+          pthread_mutex_unlock(context->getMutexUsers());
+
+          //OpenVPN doesn't wait for the accounting, the receive thread writes the result into the deferred file
+          if ( context->conf.getDeferredClientConnect() && get_env ( "client_connect_deferred_file", envp ) != NULL )
+          {
+            acct_add_user ( context, &snapshot, get_env ( "client_connect_deferred_file", envp ) );
+            return OPENVPN_PLUGIN_FUNC_DEFERRED;
+          }
+
+          //send information to the background process and get the response
+          const int status = context->waitAcctResult ( acct_add_user ( context, &snapshot, "" ) );
+
+          //the user may be removed in the meantime
+          pthread_mutex_lock(context->getMutexUsers());
+          locked=true;
+          newuser=context->findUser(snapshot.getKey());
           if ( status == RESPONSE_SUCCEEDED )
           {
-            newuser->setAccounted ( true );
+            if (newuser != NULL)
+            {
+              newuser->setAccounted ( true );
+            }
+            locked=false;
+            pthread_mutex_unlock(context->getMutexUsers());
 
             if ( DEBUG ( context->getVerbosity() ) )
               cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Accounting succeeded!\n";
@@ -494,19 +561,27 @@ extern "C"
           }
           else
           {
-            //free the nasport
-            context->delNasPort ( newuser->getPortnumber() );
+            if (newuser != NULL)
+            {
+              //free the nasport
+              context->delNasPort ( newuser->getPortnumber() );
+              //delete user from context
+              context->cancelPendingAuths ( newuser );
+              context->delUser ( newuser->getKey() );
+            }
+            locked=false;
+            pthread_mutex_unlock(context->getMutexUsers());
             string error;
             error="RADIUS-PLUGIN: FOREGROUND: OPENVPN_PLUGIN_CLIENT_CONNECT: Accounting failed for user:";
-            error+=newuser->getUsername();
+            error+=snapshot.getUsername();
             error+="!\n";
-            //delete user from context
-            context->delUser ( newuser->getKey() );
             throw Exception ( error );
           }
         }
         else
         {
+          locked=false;
+          pthread_mutex_unlock(context->getMutexUsers());
           string error;
           error="RADIUS-PLUGIN: FOREGROUND: No user with this commonname or he is already authenticated: ";
           error+=common_name;
@@ -515,13 +590,19 @@ extern "C"
         }
       }
       catch ( Exception &e ) {
+        if (locked)
+          pthread_mutex_unlock(context->getMutexUsers());
         cerr << getTime() << e;
       }
       catch (std::exception &e) {
+        if (locked)
+          pthread_mutex_unlock(context->getMutexUsers());
         cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Exception while do OPENVPN_PLUGIN_CLIENT_CONNECT: "
              << e.what() << "\n";
       }
       catch ( ... ) {
+        if (locked)
+          pthread_mutex_unlock(context->getMutexUsers());
         cerr << getTime() << "Unknown Exception while do OPENVPN_PLUGIN_CLIENT_CONNECT:!";
       }
       return OPENVPN_PLUGIN_FUNC_ERROR;
@@ -534,60 +615,67 @@ extern "C"
       if ( DEBUG ( context->getVerbosity() ) ) {
         cerr << getTime() << "\n\nRADIUS-PLUGIN: FOREGROUND: OPENVPN_PLUGIN_CLIENT_DISCONNECT is called.\n";
       }
+      //the user is only used while mutexUsers is held, the other threads can remove him
+      bool locked=false;
       try
       {
         tmpuser=new UserPlugin();
         get_user_env(context,type,envp, tmpuser);
         //find the user in the context, he was added at the OPENVPN_PLUGIN_AUTH_USER_PASS_VERIFY
         //string key=common_name + string ( "," ) +untrusted_ip+string ( ":" ) + string ( get_env ( "untrusted_port", envp ) );
-
-        newuser=context->findUser(tmpuser->getKey());
+        const string key=tmpuser->getKey();
         delete(tmpuser);
+
+        pthread_mutex_lock(context->getMutexUsers());
+        locked=true;
+        newuser=context->findUser(key);
+        locked=false;
+        pthread_mutex_unlock(context->getMutexUsers());
         if ( newuser!=NULL )
         {
+          newuser=NULL;
           if ( DEBUG ( context->getVerbosity() ) )
-            cerr << getTime() <<  "RADIUS-PLUGIN: FOREGROUND: Delete user from accounting: commonname: " << newuser->getKey() << "\n";
+            cerr << getTime() <<  "RADIUS-PLUGIN: FOREGROUND: Delete user from accounting: commonname: " << key << "\n";
 
-          //send the information to the background process
-          context->acctsocketbackgr.send ( DEL_USER );
-          context->acctsocketbackgr.send ( newuser->getKey() );
+          //send the information to the background process, OpenVPN doesn't wait
+          //for the response, it is logged by the thread acct_user_receive
+          acct_del_user ( context, key );
 
-          //get the response
-          const int status = context->acctsocketbackgr.recvInt();
-          if ( status == RESPONSE_SUCCEEDED )
-          {
-            if ( DEBUG ( context->getVerbosity() ) )
-              cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Accounting for user with key" << newuser->getKey()  << " stopped!\n";
-
-            //free the nasport
-            context->delNasPort ( newuser->getPortnumber() );
-
-            //delete user from context
-            context->delUser ( newuser->getKey() );
-            return OPENVPN_PLUGIN_FUNC_SUCCESS;
-          }
-          else
+          //the user may be removed in the meantime
+          pthread_mutex_lock(context->getMutexUsers());
+          locked=true;
+          newuser=context->findUser(key);
+          if (newuser != NULL)
           {
             //free the nasport
             context->delNasPort ( newuser->getPortnumber() );
 
             //delete user from context
-            context->delUser ( newuser->getKey() );
-            cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: OPENVPN_PLUGIN_CLIENT_DISCONNECT: Error in ACCT Background Process!\n";
+            context->cancelPendingAuths ( newuser );
+            context->delUser ( key );
           }
+          locked=false;
+          pthread_mutex_unlock(context->getMutexUsers());
+          return OPENVPN_PLUGIN_FUNC_SUCCESS;
         }
         else {
           throw Exception ( "OPENVPN_PLUGIN_CLIENT_DISCONNECT: No user with this common_name!\n" );
         }
       }
       catch ( Exception &e ) {
+        if (locked)
+          pthread_mutex_unlock(context->getMutexUsers());
         cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND:" << e;
       }
       catch (std::exception &e) {
+        if (locked)
+          pthread_mutex_unlock(context->getMutexUsers());
         cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Exception while OPENVPN_PLUGIN_CLIENT_DISCONNECT: "
              << e.what() << "\n";
       }
       catch ( ... ) {
+        if (locked)
+          pthread_mutex_unlock(context->getMutexUsers());
         cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: OPENVPN_PLUGIN_CLIENT_DISCONNECT: Unknown Exception!\n";
       }
     }
@@ -610,6 +698,24 @@ extern "C"
     if ( DEBUG ( context->getVerbosity() ) )
       cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: close\n";
 
+    //the threads are running
+    const bool threads = context->getStartThread() == false && context->conf.getAccountingOnly() == false;
+    if (threads)
+    {
+      if ( DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Stop auth thread .\n";
+
+      //stop the thread
+      context->setStopThread(true);
+
+      //wait for the thread to exit
+      pthread_join(*context->getThread(),NULL);
+    }
+    else
+    {
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Auth thread was not started so far.\n";
+    }
+
     if ( context->authsocketbackgr.getSocket() >= 0 )
     {
       if ( DEBUG ( context->getVerbosity() ) )
@@ -635,6 +741,18 @@ extern "C"
 
     }
 
+    if (threads)
+    {
+      //the background process has sent all responses, wake up the receive thread
+      context->authsocketbackgr.shutdown();
+      pthread_join(*context->getRecvThread(),NULL);
+    }
+    if (context->getStartThread()==false)
+    {
+      pthread_cond_destroy(context->getCondRecv( ));
+      pthread_mutex_destroy(context->getMutexRecv());
+    }
+
     if ( context->acctsocketbackgr.getSocket() >= 0 )
     {
       if ( DEBUG ( context->getVerbosity() ) )
@@ -659,31 +777,12 @@ extern "C"
         waitpid ( context->getAcctPid(), NULL, 0 );
 
     }
-    if (context->getStartThread()==false) //means the thread is running
+    if (context->getStartThread()==false)
     {
-      if ( DEBUG ( context->getVerbosity() ) )
-        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Stop auth thread .\n";
-
-      //stop the thread
-      pthread_mutex_lock(context->getMutexSend());
-      context->setStopThread(true);
-      pthread_cond_signal( context->getCondSend( ));
-      pthread_mutex_unlock(context->getMutexSend());
-
-
-      //wait for the thread to exit
-      pthread_join(*context->getThread(),NULL);
-      pthread_cond_destroy(context->getCondSend( ));
-      pthread_cond_destroy(context->getCondRecv( ));
-      pthread_mutex_destroy(context->getMutexSend());
-      pthread_mutex_destroy(context->getMutexRecv());
-
+      //the background process has sent all responses, wake up the receive thread
+      context->acctsocketbackgr.shutdown();
+      pthread_join(*context->getAcctRecvThread(),NULL);
     }
-    else
-    {
-      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: Auth thread was not started so far.\n";
-    }
-
     delete context;
     cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND: DONE.\n";
 
@@ -752,19 +851,35 @@ int string_array_len ( const char *array[] )
  * but posix doesn't give us a kind
  * of FD_CLOEXEC which will stop
  * fds from crossing a fork().
- * @param The socket number which should not be closed.
+ * @param keep The socket to the parent, its descriptors are not closed.
  */
-void close_fds_except ( int keep )
+void close_fds_except ( IpcSocket * keep )
 {
   int i;
   closelog ();
   for ( i = 3; i <= 100; ++i )
   {
-    if ( i != keep )
+    if ( !keep->usesFd ( i ) )
       close ( i );
   }
 }
 
+/** The function creates the rings in shared memory for the communication
+ * with a background process, one ring for each direction.
+ * @param rings The rings, the first is for the commands to the background process.
+ * @return 0 on success, else -1.
+ */
+int create_ipc_rings ( IpcRing * rings[2] )
+{
+  rings[0]=new IpcRing;
+  rings[1]=new IpcRing;
+  if ( rings[0]->create() != 0 || rings[1]->create() != 0 )
+  {
+    return -1;
+  }
+  return 0;
+}
+
 /** Original function from the openvpn auth-pam plugin.
  * Usually we ignore signals, because our parent will
  * deal with them.
@@ -844,9 +959,9 @@ string createSessionId ( UserPlugin * user )
 }
 
 
-/** The function implements the thread for authentication. If the auth_control_file is specified the thread writes the results in the
- * auth_control_file, if the file is not specified the thread forward the OPENVPN_PLUGIN_FUNC_SUCCESS or OPENVPN_PLUGIN_FUNC_ERROR
- * to the main process.
+/** The function implements the thread which sends the users to the authentication background process. It does not
+ * wait for the responses, they are handled by the thread auth_user_pass_receive. So many verifications can be pending
+ * at the same time and the deferred authentication is not slowed down by the round trip time to the radius server.
  * @param _context The context pointer from OpenVPN.
  */
 
@@ -854,7 +969,7 @@ void  * auth_user_pass_verify(void * c)
 {
   cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Auth_user_pass_verify thread started."<< endl;
   PluginContext * context = (PluginContext *) c;
-  //pthread_mutex_lock(context->getMutexSend());
+  IpcMessage msg;
   //main thread loop for authentication
 
   //ignore signals
@@ -871,31 +986,29 @@ void  * auth_user_pass_verify(void * c)
 
   while (!context->getStopThread())
   {
+    bool locked=false; /**<True while the thread holds mutexUsers.*/
     try{
-    if (context->UserWaitingtoAuth() == false)
-    {
-      if ( DEBUG ( context->getVerbosity() ) ) {
-        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Waiting for new user." << endl;
-      }
-      cout.flush(); cerr.flush();
-      pthread_mutex_lock(context->getMutexSend());
-      while(context->UserWaitingtoAuth() == false) {
-        pthread_cond_wait(context->getCondSend(),context->getMutexSend());
-      }
-      pthread_mutex_unlock(context->getMutexSend());
+    UserPlugin  *olduser;  /**<A context for an already known user.*/
+    UserPlugin  *newuser;  /**<A context for the new user.*/
+
+    if ( DEBUG ( context->getVerbosity() ) ) {
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Waiting for new user, " << context->getNewUserDepth() << " queued." << endl;
     }
+    newuser = context->getNewUser();
+
     if (context->getStopThread() == true) {
       cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Stop signal received." << endl;
+      delete newuser;
       break;
     }
-    if ( DEBUG ( context->getVerbosity() ) ) cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: New user from OpenVPN!" << endl;
-    //is the user already known?
-    UserPlugin  *olduser;  /**<A context for an already known user.*/
-    UserPlugin  *newuser;  /**<A context for the new user.*/
-    newuser = context->getNewUser();
     if(!newuser) {
       continue;
     }
+    if ( DEBUG ( context->getVerbosity() ) ) cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: New user from OpenVPN!" << endl;
+
+    //is the user already known?
+    pthread_mutex_lock(context->getMutexUsers());
+    locked=true;
     olduser = context->findUser(newuser->getKey());
 
     if ( olduser!=NULL )  //probably key renegotiation
@@ -915,11 +1028,8 @@ void  * auth_user_pass_verify(void * c)
       olduser->setUsername(newuser->getUsername());
       olduser->setAuthControlFile(newuser->getAuthControlFile());
       //delete the newuser and use the olduser
-      if(newuser) {
-        delete newuser;
-      }
+      delete newuser;
       newuser=olduser;
-      //TODO: for threading check if the user is already accounted (He must be for renegotiation)
     }
     else //new user for authentication, no renegotiation
     {
@@ -936,162 +1046,505 @@ void  * auth_user_pass_verify(void * c)
            << ", newuser ip: " << newuser->getCallingStationId()
            << ", newuser port: " << newuser->getUntrustedPort() << " ." << endl;
 
-    //there must be a username
-    if ( newuser->getUsername().size() > 0 )  //&& olduser==NULL)
+    //the result is written to the auth control file or OpenVPN waits for it
+    PendingAuth pending;
+    pending.user=newuser;
+    pending.username=newuser->getUsername();
+    pending.source=newuser->getCallingStationId();
+    if (newuser->getAuthControlFile().length()>0 && context->conf.getUseAuthControlFile())
     {
-      //send the informations to the background process
-      context->authsocketbackgr.send ( COMMAND_VERIFY );
-      context->authsocketbackgr.send ( newuser->getUsername() );
-      context->authsocketbackgr.send ( newuser->getPassword() );
-      context->authsocketbackgr.send ( newuser->getPortnumber() );
-      context->authsocketbackgr.send ( newuser->getSessionId() );
-      context->authsocketbackgr.send ( newuser->getCallingStationId() );
-      context->authsocketbackgr.send ( newuser->getCommonname() );
-      context->authsocketbackgr.send ( newuser->getFramedIp() );
-
-      //get the response
-      const int status = context->authsocketbackgr.recvInt();
-      if ( status == RESPONSE_SUCCEEDED )
-      {
-        if ( DEBUG ( context->getVerbosity() ) )
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Authentication succeeded!\n";
+      pending.authcontrolfile=newuser->getAuthControlFile();
+    }
 
-        //get the routes from background process
-        newuser->setFramedRoutes ( context->authsocketbackgr.recvStr() );
-        if ( DEBUG ( context->getVerbosity() ) )
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Received routes for user: "
-               << newuser->getFramedRoutes() << ".\n";
-        //get the framed ip
-        newuser->setFramedIp ( context->authsocketbackgr.recvStr() );
-        if ( DEBUG ( context->getVerbosity() ) )
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Received framed ip for user: "
-               << newuser->getFramedIp() << ".\n";
+    //there must be a username
+    if ( newuser->getUsername().size() == 0 )
+    {
+      locked=false;
+      pthread_mutex_unlock(context->getMutexUsers());
+      auth_user_pass_failed(context, &pending);
+      continue;
+    }
 
+    //a renegotiation with the same username and password is answered from the cache
+    pending.digest=context->authcache.digest(newuser->getUsername(), newuser->getPassword());
+    if ( olduser!=NULL && olduser->isAuthenticated() && context->authcache.find(olduser->getKey(), pending.digest) )
+    {
+      if ( DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Renegotiation accepted from the authentication cache.\n";
+      locked=false;
+      pthread_mutex_unlock(context->getMutexUsers());
+      auth_user_pass_result(context, &pending, true);
+      continue;
+    }
 
-        // get the interval from the background process
-        newuser->setAcctInterimInterval ( context->authsocketbackgr.recvInt() );
-        if ( DEBUG ( context->getVerbosity() ) )
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Receive acctinteriminterval " << newuser->getAcctInterimInterval() <<" sec from backgroundprocess." << endl;
+    //too many failed logins of the username or from the source address
+    if ( context->loginthrottle.isBlocked(pending.username, pending.source) )
+    {
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Too many failed logins, rejected without radius request: username: "
+           << pending.username << ", source: " << pending.source << ".\n";
+      locked=false;
+      pthread_mutex_unlock(context->getMutexUsers());
+      auth_user_pass_failed(context, &pending);
+      continue;
+    }
 
-        //clear the buffer if it isn't empty
-        if ( newuser->getVsaBuf() !=NULL )
-        {
-          delete [] newuser->getVsaBuf();
-          newuser->setVsaBuf ( NULL );
-        }
-        // get the vendor specific attribute buffer from the background process
-        context->authsocketbackgr.recvBuf ( newuser );
+    //the response is handled by the receive thread
+    const int requestid = context->newRequestId();
+    context->addPendingAuth(requestid, pending);
+
+    //the informations for the background process, the user may be deleted after the unlock
+    msg.clear();
+    msg.add ( COMMAND_VERIFY );
+    msg.add ( requestid );
+    msg.add ( newuser->getUsername() );
+    msg.add ( newuser->getPassword() );
+    msg.add ( newuser->getPortnumber() );
+    msg.add ( newuser->getSessionId() );
+    msg.add ( newuser->getCallingStationId() );
+    msg.add ( newuser->getCommonname() );
+    msg.add ( newuser->getFramedIp() );
+    locked=false;
+    pthread_mutex_unlock(context->getMutexUsers());
+
+    //the send can block when the background process is busy, the users are not locked meanwhile
+    context->authsocketbackgr.send ( msg );
+  }
+    catch(std::exception &e) {
+      if (locked)
+        pthread_mutex_unlock(context->getMutexUsers());
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got exception: " << e.what() << "\n";
+      break;
+    }
+    catch(Exception &e) {
+      if (locked)
+        pthread_mutex_unlock(context->getMutexUsers());
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got exception: " << e << "\n";
+      break;
+    }
+    catch(...) {
+      if (locked)
+        pthread_mutex_unlock(context->getMutexUsers());
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got unknown exception\n";
+      break;
+    }
+  }
+  cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Thread finished.\n";
+  pthread_exit(NULL);
+}
 
-        //add the user to the context
-        // if the is already in the map, addUser will throw an exception
-        // only add the user if he it not known already
+/** The function implements the thread which receives the responses from the authentication background process.
+ * The responses carry the request id, so they are matched to the pending verifications in the order the
+ * radius server answers. If the auth_control_file is specified the thread writes the results in the
+ * auth_control_file, if the file is not specified the thread forward the OPENVPN_PLUGIN_FUNC_SUCCESS or OPENVPN_PLUGIN_FUNC_ERROR
+ * to the main process. The thread exits when the socket is shut down.
+ * @param _context The context pointer from OpenVPN.
+ */
 
-        if ( newuser->isAuthenticated() ==false )
-        {
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Add user to map." << endl;
-          //save the success
-          newuser->setAuthenticated ( true );
-        }
-        else if ( newuser->isAuthenticated() && olduser!=NULL )
-        {
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Don't add the user to the map, it is a rekeying." << endl;
-        }
+void  * auth_user_pass_receive(void * c)
+{
+  PluginContext * context = (PluginContext *) c;
+  PendingAuth pending;
+  IpcMessage msg;
 
-        if (newuser->getAuthControlFile().length()>0 && context->conf.getUseAuthControlFile())
-        {
-          write_auth_control_file(context, newuser->getAuthControlFile(), '1');
-        }
-        else
-        {
-          pthread_mutex_lock(context->getMutexRecv());
-          context->setResult(OPENVPN_PLUGIN_FUNC_SUCCESS);
-          pthread_cond_signal( context->getCondRecv( ));
-          pthread_mutex_unlock (context->getMutexRecv());
-        }
-      }
-      else //AUTH failed
-      {
-        if ( newuser->isAccounted() ) //user is already known, delete him from the accounting
-        {
-          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Error ar rekeying!" << endl;
-          //error on authenticate user at rekeying -> delete the user!
-          //send the information to the background process
-          context->acctsocketbackgr.send ( DEL_USER );
-          context->acctsocketbackgr.send ( newuser->getKey() );
-
-          //get the response
-          const int status = context->acctsocketbackgr.recvInt();
-          if ( status == RESPONSE_SUCCEEDED )
-          {
-            if ( DEBUG ( context->getVerbosity() ) )
-              cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Accounting for user with key" << newuser->getKey()  << " stopped!\n";
-          }
-          else
-          {
-            cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Error in ACCT Background Process!\n";
-            cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: User is deleted from the user map!\n";
-          }
-        }
-        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Error receiving auth confirmation from background process." << endl;
-        // clean up: nas port, context, memory
-        context->delNasPort(newuser->getPortnumber());
-        context->delUser(newuser->getKey());
+  //ignore signals
+  static sigset_t   signal_mask;
+  sigemptyset (&signal_mask);
+  sigaddset (&signal_mask, SIGINT);
+  sigaddset (&signal_mask, SIGTERM);
+  sigaddset (&signal_mask, SIGHUP);
+  sigaddset (&signal_mask, SIGUSR1);
+  sigaddset (&signal_mask, SIGUSR2);
+  sigaddset (&signal_mask, SIGPIPE);
+  pthread_sigmask (SIG_BLOCK, &signal_mask, NULL);
 
-        if (newuser->getAuthControlFile().length()>0 && context->conf.getUseAuthControlFile())
-        {
-          write_auth_control_file(context, newuser->getAuthControlFile(), '0');
-        }
-        else
-        {
-          pthread_mutex_lock(context->getMutexRecv());
-          context->setResult(OPENVPN_PLUGIN_FUNC_ERROR);
-          pthread_cond_signal( context->getCondRecv( ));
-          pthread_mutex_unlock (context->getMutexRecv());
-        }
-        delete newuser;
-      }
+  while (1)
+  {
+    UserPlugin  *newuser=NULL;
+    UserPlugin  *dropped=NULL;
+    bool        locked=false;   /**<True while the thread holds mutexUsers.*/
+    bool        taken=false;    /**<True while the pending verification is taken but not answered.*/
+    try{
+    //get the response, the background process tags it with the request id
+    context->authsocketbackgr.recv ( msg );
+    const int requestid = msg.getInt();
+    const int status = msg.getInt();
+
+    pthread_mutex_lock(context->getMutexUsers());
+    locked=true;
+    if (!context->takePendingAuth(requestid, &pending))
+    {
+      //a stray response, the next ones are still answered
+      locked=false;
+      pthread_mutex_unlock(context->getMutexUsers());
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Response for an unknown request " << requestid << " from the auth background process.\n";
+      continue;
     }
-    else
+    taken=true;
+    newuser=pending.user;
+    if (newuser==NULL)
     {
-      //clean up: nas port, context, memory
-      context->delNasPort(newuser->getPortnumber());
-      context->delUser (newuser->getKey());
+      //the user was removed in the meantime, read the response anyway
+      dropped=new UserPlugin();
+      newuser=dropped;
+    }
+
+    if ( status == RESPONSE_SUCCEEDED )
+    {
+      if ( DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Authentication succeeded!\n";
+
+      //get the routes from background process
+      newuser->setFramedRoutes ( msg.getStr() );
+      if ( DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Received routes for user: "
+             << newuser->getFramedRoutes() << ".\n";
+      //get the framed ip
+      newuser->setFramedIp ( msg.getStr() );
+      if ( DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Received framed ip for user: "
+             << newuser->getFramedIp() << ".\n";
 
-      //return OPENVPN_PLUGIN_FUNC_ERROR;
-      if (newuser->getAuthControlFile().length()>0 && context->conf.getUseAuthControlFile())
+
+      // get the interval from the background process
+      newuser->setAcctInterimInterval ( msg.getInt() );
+      if ( DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Receive acctinteriminterval " << newuser->getAcctInterimInterval() <<" sec from backgroundprocess." << endl;
+
+      // get the vendor specific attribute buffer from the background process, the old buffer is freed
+      msg.getBuf ( newuser );
+
+      if ( newuser->isAuthenticated() ==false )
       {
-        write_auth_control_file(context, newuser->getAuthControlFile(), '0');
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Add user to map." << endl;
+        //save the success
+        newuser->setAuthenticated ( true );
       }
       else
       {
-        pthread_mutex_lock(context->getMutexRecv());
-        context->setResult(OPENVPN_PLUGIN_FUNC_ERROR);
-        pthread_cond_signal( context->getCondRecv( ));
-        pthread_mutex_unlock (context->getMutexRecv());
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Don't add the user to the map, it is a rekeying." << endl;
       }
-      delete newuser;
+      //renegotiations with the same username and password are answered from the cache
+      if ( dropped==NULL )
+      {
+        context->authcache.add(newuser->getKey(), pending.digest);
+      }
+      locked=false;
+      pthread_mutex_unlock(context->getMutexUsers());
+      context->loginthrottle.addSuccess(pending.username);
+      delete dropped;
+      dropped=NULL;
+
+      taken=false;
+      auth_user_pass_result(context, &pending, true);
+    }
+    else //AUTH failed
+    {
+      locked=false;
+      pthread_mutex_unlock(context->getMutexUsers());
+      delete dropped;
+      dropped=NULL;
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Error receiving auth confirmation from background process." << endl;
+      context->loginthrottle.addFailure(pending.username, pending.source);
+      taken=false;
+      auth_user_pass_failed(context, &pending);
     }
   }
     catch(std::exception &e) {
+      if (locked)
+        pthread_mutex_unlock(context->getMutexUsers());
       cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got exception: " << e.what() << "\n";
-      break;
+      delete dropped;
+      //the verification is answered, the thread goes on with the next response
+      if (taken)
+        auth_user_pass_result(context, &pending, false);
+      continue;
     }
     catch(Exception &e) {
-      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got exception: " << e << "\n";
-      break;
+      if (locked)
+        pthread_mutex_unlock(context->getMutexUsers());
+      //the socket is shut down when the plugin is closed
+      if ( e.getErrnum() != Exception::SOCKETRECV || DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got exception: " << e << "\n";
+      delete dropped;
+      if (taken)
+        auth_user_pass_result(context, &pending, false);
+      //only an error of the socket ends the thread
+      if ( e.getErrnum() == Exception::SOCKETRECV || e.getErrnum() == Exception::SOCKETSEND )
+        break;
+      continue;
     }
     catch(...) {
+      if (locked)
+        pthread_mutex_unlock(context->getMutexUsers());
       cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Got unknown exception\n";
+      delete dropped;
+      if (taken)
+        auth_user_pass_result(context, &pending, false);
+      continue;
+    }
+  }
+
+  //there will be no responses for the pending verifications
+  while (context->takeNextPendingAuth(&pending))
+  {
+    auth_user_pass_result(context, &pending, false);
+  }
+  cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Receive thread finished.\n";
+  pthread_exit(NULL);
+}
+
+/** The function removes a user whose authentication failed. If the user is accounted (rekeying) he is deleted
+ * from the accounting. The user is not removed if another verification for him is pending.
+ * At last the result is given to OpenVPN.
+ * @param context The context of the plugin.
+ * @param pending The failed verification.
+ */
+void auth_user_pass_failed(PluginContext * context, PendingAuth * pending)
+{
+  UserPlugin * newuser=pending->user;
+
+  pthread_mutex_lock(context->getMutexUsers());
+  if ( newuser!=NULL )
+  {
+    context->authcache.remove(newuser->getKey());
+  }
+  if ( newuser!=NULL && context->isPendingAuth(newuser) == false && context->findUser(newuser->getKey()) == newuser )
+  {
+    // clean up: nas port, context, memory
+    context->delNasPort(newuser->getPortnumber());
+    context->delUser(newuser->getKey());
+    pthread_mutex_unlock(context->getMutexUsers());
+
+    if ( newuser->isAccounted() ) //user is already known, delete him from the accounting
+    {
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Error ar rekeying!" << endl;
+      //error on authenticate user at rekeying -> delete the user!
+      //send the information to the background process, the response is logged by the thread acct_user_receive
+      try
+      {
+        acct_del_user ( context, newuser->getKey() );
+      }
+      catch (Exception &e)
+      {
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Error in ACCT Background Process: " << e << "\n";
+      }
+    }
+    delete newuser;
+  }
+  else
+  {
+    pthread_mutex_unlock(context->getMutexUsers());
+  }
+  auth_user_pass_result(context, pending, false);
+}
+
+/** The function gives the result of a verification to OpenVPN. If the auth_control_file is specified the result
+ * is written into it, else the waiting OpenVPN thread is woken up.
+ * @param context The context of the plugin.
+ * @param pending The verification.
+ * @param success The result of the verification.
+ */
+void auth_user_pass_result(PluginContext * context, PendingAuth * pending, bool success)
+{
+  if (pending->authcontrolfile.length()>0)
+  {
+    write_auth_control_file(context, pending->authcontrolfile, success ? '1' : '0');
+  }
+  else
+  {
+    pthread_mutex_lock(context->getMutexRecv());
+    context->setResult(success ? OPENVPN_PLUGIN_FUNC_SUCCESS : OPENVPN_PLUGIN_FUNC_ERROR);
+    pthread_cond_signal( context->getCondRecv( ));
+    pthread_mutex_unlock (context->getMutexRecv());
+  }
+}
+
+/** The function sends the command ADD_USER to the accounting background process. The command is saved as pending
+ * before it is sent, the response is handled by the thread acct_user_receive.
+ * @param context The context of the plugin.
+ * @param user The user.
+ * @param deferredfile The client_connect_deferred_file for the result, empty if the caller waits for the result with PluginContext::waitAcctResult().
+ * @return The request id of the command.
+ */
+int acct_add_user(PluginContext * context, UserPlugin * user, const string &deferredfile)
+{
+  const int requestid = context->newRequestId();
+  PendingAcct pending;
+
+  context->addPendingAcct(requestid, user->getKey(), deferredfile);
+  try
+  {
+    IpcMessage msg;
+    msg.add ( ADD_USER );
+    msg.add ( requestid );
+    msg.add ( user->getUsername() );
+    msg.add ( user->getSessionId() );
+    msg.add ( user->getPortnumber() );
+    msg.add ( user->getCallingStationId() );
+    msg.add ( user->getFramedIp() );
+    msg.add ( user->getCommonname() );
+    msg.add ( user->getAcctInterimInterval() );
+    msg.add ( user->getFramedRoutes() );
+    msg.add ( user->getKey() );
+    msg.add ( user->getStatusFileKey());
+    msg.add ( user->getUntrustedPort() );
+    msg.add ( user->getVsaBuf(), user->getVsaBufLen() );
+    context->acctsocketbackgr.send ( msg );
+  }
+  catch (...)
+  {
+    context->takePendingAcct(requestid, &pending);
+    throw;
+  }
+  return requestid;
+}
+
+/** The function sends the command DEL_USER to the accounting background process. Nobody
+ * waits for the result, it is logged by the thread acct_user_receive.
+ * @param context The context of the plugin.
+ * @param key The key of the user.
+ * @return The request id of the command.
+ */
+int acct_del_user(PluginContext * context, const string &key)
+{
+  const int requestid = context->newRequestId();
+  PendingAcct pending;
+
+  context->addPendingAcct(requestid, key, "", true);
+  try
+  {
+    IpcMessage msg;
+    msg.add ( DEL_USER );
+    msg.add ( requestid );
+    msg.add ( key );
+    context->acctsocketbackgr.send ( msg );
+  }
+  catch (...)
+  {
+    context->takePendingAcct(requestid, &pending);
+    throw;
+  }
+  return requestid;
+}
+
+/** The function implements the thread which receives the responses from the accounting background process.
+ * The responses carry the request id. A response for a deferred client connect is written into the
+ * client_connect_deferred_file, a response to DEL_USER is logged, other responses are handed to the waiting threads.
+ * The thread exits when the socket is shut down.
+ * @param _context The context pointer from OpenVPN.
+ */
+void  * acct_user_receive(void * c)
+{
+  PluginContext * context = (PluginContext *) c;
+  PendingAcct pending;
+  IpcMessage msg;
+
+  //ignore signals
+  static sigset_t   signal_mask;
+  sigemptyset (&signal_mask);
+  sigaddset (&signal_mask, SIGINT);
+  sigaddset (&signal_mask, SIGTERM);
+  sigaddset (&signal_mask, SIGHUP);
+  sigaddset (&signal_mask, SIGUSR1);
+  sigaddset (&signal_mask, SIGUSR2);
+  sigaddset (&signal_mask, SIGPIPE);
+  pthread_sigmask (SIG_BLOCK, &signal_mask, NULL);
+
+  while (1)
+  {
+    try
+    {
+      context->acctsocketbackgr.recv ( msg );
+      const int requestid = msg.getInt();
+      const int status = msg.getInt();
+
+      if (!context->takePendingAcct(requestid, &pending))
+      {
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Response for an unknown request " << requestid << ".\n";
+      }
+      else if (pending.deferredfile.length() > 0)
+      {
+        acct_user_connected(context, &pending, status);
+      }
+      else if (pending.detached)
+      {
+        if ( status == RESPONSE_SUCCEEDED )
+        {
+          if ( DEBUG ( context->getVerbosity() ) )
+            cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Accounting for user with key " << pending.key << " stopped!\n";
+        }
+        else
+        {
+          cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Error in ACCT Background Process while stopping the accounting for user with key " << pending.key << "!\n";
+        }
+      }
+      else
+      {
+        context->setAcctResult(requestid, status);
+      }
+    }
+    catch(Exception &e) {
+      //the socket is shut down when the plugin is closed
+      if ( e.getErrnum() != Exception::SOCKETRECV || DEBUG ( context->getVerbosity() ) )
+        cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Got exception: " << e << "\n";
+      break;
+    }
+    catch(...) {
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Got unknown exception\n";
       break;
     }
   }
-  pthread_mutex_unlock(context->getMutexRecv());
-  pthread_mutex_unlock(context->getMutexSend());
-  cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND THREAD: Thread finished.\n";
-  context->setStartThread(false);
+
+  //there will be no responses for the pending commands
+  context->stopAcctResults();
+  while (context->takeNextPendingAcct(&pending))
+  {
+    if (pending.deferredfile.length() > 0)
+    {
+      acct_user_connected(context, &pending, RESPONSE_FAILED);
+    }
+  }
+  cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Thread finished.\n";
   pthread_exit(NULL);
 }
 
+/** The function finishes a deferred client connect. If the accounting succeeded the user is marked as
+ * accounted, else he is removed. The result is written into the client_connect_deferred_file.
+ * @param context The context of the plugin.
+ * @param pending The ADD_USER command.
+ * @param status The response from the accounting background process.
+ */
+void acct_user_connected(PluginContext * context, PendingAcct * pending, int status)
+{
+  UserPlugin * user;
+
+  pthread_mutex_lock(context->getMutexUsers());
+  user=context->findUser(pending->key);
+  if ( status == RESPONSE_SUCCEEDED )
+  {
+    if (user != NULL)
+    {
+      user->setAccounted ( true );
+    }
+    if ( DEBUG ( context->getVerbosity() ) )
+      cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: Accounting succeeded!\n";
+  }
+  else
+  {
+    cerr << getTime() << "RADIUS-PLUGIN: FOREGROUND ACCT THREAD: OPENVPN_PLUGIN_CLIENT_CONNECT: Accounting failed for user with key: " << pending->key << "!\n";
+    if (user != NULL)
+    {
+      //free the nasport
+      context->delNasPort ( user->getPortnumber() );
+      //delete user from context
+      context->cancelPendingAuths ( user );
+      context->delUser ( user->getKey() );
+    }
+  }
+  pthread_mutex_unlock(context->getMutexUsers());
+  write_client_connect_deferred_file(context, pending->deferredfile, status == RESPONSE_SUCCEEDED ? '1' : '0');
+}
+
 
 /** Writes the result of the authentication to the auth control file (0: failure, 1: success).
  * @param filename The auth control file.
@@ -1115,6 +1568,27 @@ void write_auth_control_file(PluginContext * context, string filename, char c)
 
 }
 
+/** Writes the result of the deferred client connect to the client_connect_deferred_file (0: failure, 1: success).
+ * @param filename The client_connect_deferred_file.
+ * @param c The result of the client connect.
+ */
+void write_client_connect_deferred_file(PluginContext * context, string filename, char c)
+{
+  ofstream file;
+  file.open(filename.c_str(),ios::out);
+  if ( DEBUG ( context->getVerbosity() ))
+    cerr << getTime() << "RADIUS-PLUGIN: Write " << c << " to client_connect_deferred_file "<< filename << ".\n";
+  if (file.is_open())
+  {
+    file << c;
+    file.close();
+  }
+  else
+  {
+    cerr << getTime() << "RADIUS-PLUGIN: Could not open client_connect_deferred_file "<< filename << ".\n";
+  }
+}
+
 /** Returns the current time:
  * @return The current time as a string.
  */
@@ -1282,4 +1756,3 @@ const char *StdLogger::time_()
   }
   return buf_;
 }
-
@@ -109,12 +109,21 @@ struct name_value_list {
 
 const char * get_env (const char *name, const char *envp[]);
 int string_array_len (const char *array[]);
-void close_fds_except (int keep);
+void close_fds_except (IpcSocket * keep);
+int create_ipc_rings (IpcRing * rings[2]);
 void set_signals (void);
 string createSessionId (UserPlugin *);
 void get_user_env(PluginContext *, const int type,const char *envp[], UserPlugin *);
 void * auth_user_pass_verify(void *);
+void * auth_user_pass_receive(void *);
+void auth_user_pass_failed(PluginContext *, PendingAuth *);
+void auth_user_pass_result(PluginContext *, PendingAuth *, bool);
 void write_auth_control_file(PluginContext *, string filename, char c);
+void write_client_connect_deferred_file(PluginContext *, string filename, char c);
+int acct_add_user(PluginContext *, UserPlugin *, const string &);
+int acct_del_user(PluginContext *, const string &);
+void * acct_user_receive(void *);
+void acct_user_connected(PluginContext *, PendingAcct *, int);
 string getTime();
 
 